@@ -21,6 +21,8 @@
  * The author may be contacted at info@retronicdesign.com
  */
 #include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/wdt.h>
 #include <util/delay.h>
 #include <avr/pgmspace.h>
 #include <string.h>
@@ -31,9 +33,174 @@ static char ThreeDOInit(void);
 static void ThreeDOUpdate(void);
 static char ThreeDOChanged(char id);
 static char ThreeDOBuildReport(unsigned char *reportBuffer, char id);
+static char ThreeDOPeekReport(unsigned char *reportBuffer, char id);
 
-static unsigned int last_update_state=0;
-static unsigned int last_reported_state=0;
+/* 3DO controllers are daisy chained: each one shifts out its own bits, then
+ * the bits of the controllers plugged behind it, on the same DATA line. A
+ * controller starts with its ID, which gives its length:
+ *
+ *   Joypad       2 bytes  100 D U R L A, B C P X R L 0 0
+ *   Mouse        4 bytes  0x49, L M R Shift dY(10 bits) dX(10 bits)
+ *   Flightstick  9 bytes  0x01 0x7B 0x08, X Y Z (10 bits each, 2 unused),
+ *                         Fire A B C Up Down Right Left, P X L R 0000
+ *
+ * and the end of the chain reads as zeros. All the buttons are active high.
+ *
+ * A joypad alone gets the original single report, a mouse alone a plain
+ * mouse report. Anything else found at boot gets the chain descriptor:
+ * CHAIN_DEVICES game pad report IDs for the pads and flightsticks in chain
+ * order, plus one for the first mouse.
+ */
+#define CHAIN_DEVICES		4
+#define CHAIN_MOUSE_ID		(CHAIN_DEVICES+1)
+#define CHAIN_FEATURE_ID	(CHAIN_DEVICES+2)
+#define CHAIN_BYTES			40		// 4 flightsticks and a mouse
+#define CHAIN_TICK_US		10		// Clock half period
+#define CHAIN_PERIOD		4		// update() calls between two chain reads
+#define PLUG_CHECKS			8		// Consecutive reads of another chain before re-enumerating
+
+#define DEV_PAD				1
+#define DEV_MOUSE			2
+#define DEV_STICK			3
+
+#define MODE_PAD			0		// A lone joypad
+#define MODE_CHAIN			1
+#define MODE_MOUSE			2		// Mice only, the first one is reported
+
+#define CHAIN_IDLE			0
+#define CHAIN_RUN			1
+#define CHAIN_DONE			2
+
+#define SLOT_SIZE			5		// X, Y, Z, buttons 1-8, buttons 9-16
+
+#define CLK_HIGH()			PORTB |= (1<<PB5)
+#define CLK_LOW()			PORTB &= ~(1<<PB5)
+#define PS_HIGH()			PORTB |= (1<<PB4)
+#define PS_LOW()			PORTB &= ~(1<<PB4)
+#define DATA_STATE()		((PINC>>PC2)&1)
+
+static unsigned char mode=MODE_PAD;				// Descriptor enumerated at boot
+static unsigned char slot_state[CHAIN_DEVICES][SLOT_SIZE];
+static unsigned char slot_reported[CHAIN_DEVICES][SLOT_SIZE];
+static unsigned char slot_count;				// Pads and flightsticks in the last read
+static unsigned char first_type;				// Type of the first controller, 0 if none
+static unsigned char mouse_count;
+static int mouse_x, mouse_y;					// Motion not reported yet
+static unsigned char mouse_buttons, mouse_reported;
+static unsigned char plug_count=0;
+static unsigned char chain_period=0;
+
+// Chain engine, run by the Timer1 interrupt
+static volatile unsigned char chain_state=CHAIN_IDLE;
+static volatile unsigned char chain[CHAIN_BYTES];
+static unsigned char chain_count;				// Complete bytes in chain[]
+static unsigned char chain_next;				// Index of the next ID byte
+static unsigned char chain_bit;
+static unsigned char chain_wait;				// Ticks left in the reset pulse
+static unsigned char chain_low;					// CLK was lowered, sample on this tick
+static volatile unsigned char chain_busy=0;
+
+static unsigned char ThreeDOType(unsigned char id)
+{
+	if ((id&0xE0) == 0x80)
+		return DEV_PAD;
+	if (id == 0x49)
+		return DEV_MOUSE;
+	if (id == 0x01)
+		return DEV_STICK;
+	return 0;
+}
+
+static unsigned char ThreeDOLength(unsigned char id)
+{
+	switch (ThreeDOType(id))
+	{
+		case DEV_PAD:	return 2;
+		case DEV_MOUSE:	return 4;
+		case DEV_STICK:	return 9;
+	}
+	return 0;	// End of the chain
+}
+
+static void ThreeDOStop(void)
+{
+	PS_HIGH();
+	TIMSK1 &= ~(1<<OCIE1A);
+	chain_state = CHAIN_DONE;
+}
+
+/* One step of the chain read. The clock is driven a half period at a time,
+ * so reading a long chain never holds up the main loop.
+ */
+static void ThreeDOTick(void)
+{
+	unsigned char id;
+
+	if (chain_wait)	// Reset pulse: 50us high, 50us low, then P/S low
+	{
+		chain_wait--;
+		if (chain_wait == 7)
+			CLK_LOW();
+		else if (chain_wait == 2)
+			CLK_HIGH();
+		else if (chain_wait == 1)
+			PS_LOW();
+		return;
+	}
+
+	if (!chain_low)
+	{
+		CLK_LOW();	// Shifts the next bit out
+		chain_low = 1;
+		return;
+	}
+
+	// The first bit is on DATA as soon as P/S is low
+	chain[chain_count] = (chain[chain_count]<<1) | DATA_STATE();
+	CLK_HIGH();
+	chain_low = 0;
+
+	if (++chain_bit < 8)
+		return;
+	chain_bit = 0;
+
+	if (chain_count == chain_next)	// That was an ID, find where the next one is
+	{
+		id = chain[chain_count];
+		if (!ThreeDOLength(id) || chain_next + ThreeDOLength(id) > CHAIN_BYTES)
+		{
+			ThreeDOStop();
+			return;
+		}
+		chain_next += ThreeDOLength(id);
+	}
+
+	if (++chain_count >= CHAIN_BYTES)
+		ThreeDOStop();
+}
+
+ISR(TIMER1_COMPA_vect, ISR_NOBLOCK)	// Keep V-USB interrupt latency low
+{
+	// USB may hold us longer than a tick, skip the nested one
+	if (chain_busy)
+		return;
+	chain_busy = 1;
+	ThreeDOTick();
+	chain_busy = 0;
+}
+
+static void ThreeDOStart(void)
+{
+	memset((void*)chain, 0, sizeof(chain));
+	chain_count = 0;
+	chain_next = 0;
+	chain_bit = 0;
+	chain_low = 1;
+	chain_wait = 12;
+	chain_state = CHAIN_RUN;
+	PS_HIGH();
+	CLK_HIGH();
+}
 
 static char ThreeDOInit(void)
 {
@@ -61,85 +228,252 @@ static char ThreeDOInit(void)
 	DDRD |= (1<<PD7);
 	PORTD &= ~(1<<PD7); 
 
+	// Timer1 paces the chain engine: CTC, no prescaler, interrupt enabled per read
+	TCCR1A = 0;
+	TCCR1B = (1<<WGM12)|(1<<CS10);
+	OCR1A = (F_CPU/1000000UL)*CHAIN_TICK_US-1;
+
 	return 0;
 }
 
-static void ThreeDOUpdate(void)
+static void ThreeDOPad(unsigned char *s, volatile unsigned char *p)
 {
-	unsigned char button;
+	s[0] = s[1] = s[2] = 0x80;
+	s[3] = s[4] = 0;
 
-	/* Reset clock 50us Up 50us Down */
-	PORTB |= (1<<PB5); //CLK=1
-	_delay_us(50);
-	PORTB &= ~(1<<PB5); //CLK=0
-	_delay_us(50);
-	
-	last_update_state = 0x0000;
-	/* last_update_state format:
-	 * 
-	 * 15 14 13 12 11 10 9 8 7 6 5    4     3  2    1 0
-	 * 1  0  0  L  R  X  P C B A LEFT RIGHT UP DOWN 0 0
-	 */
+	if (p[0]&0x04) { s[0] = 0xff; }	// Right
+	if (p[0]&0x02) { s[0] = 0x00; }	// Left
+	if (p[0]&0x10) { s[1] = 0xff; }	// Down
+	if (p[0]&0x08) { s[1] = 0x00; }	// Up
+
+	if (p[0]&0x01) s[3] |= (1<<0);	// A
+	if (p[1]&0x80) s[3] |= (1<<1);	// B
+	if (p[1]&0x40) s[3] |= (1<<2);	// C
+	if (p[1]&0x20) s[3] |= (1<<3);	// P
+	if (p[1]&0x10) s[3] |= (1<<4);	// X
+	if (p[1]&0x08) s[3] |= (1<<5);	// R
+	if (p[1]&0x04) s[3] |= (1<<6);	// L
+}
+
+// Axes are reported on 8 bits, the 2 LSB are dropped
+static void ThreeDOStick(unsigned char *s, volatile unsigned char *p)
+{
+	s[0] = p[3];
+	s[1] = (p[4]<<2) | (p[5]>>6);
+	s[2] = (p[5]<<4) | (p[6]>>4);
+	s[3] = p[7];		// Fire A B C Up Down Right Left, from bit 7
+	s[4] = p[8]>>4;		// P X L R, from bit 3
+}
+
+static void ThreeDOMouse(volatile unsigned char *p)
+{
+	int x, y;
+
+	y = ((p[1]&0x0F)<<6) | (p[2]>>2);
+	x = ((p[2]&0x03)<<8) | p[3];
+	if (y & 0x200)
+		y -= 0x400;
+	if (x & 0x200)
+		x -= 0x400;
+
+	// Accumulate, nothing is lost when the host polls slower than us
+	if (mouse_x > -1000 && mouse_x < 1000)
+		mouse_x += x;
+	if (mouse_y > -1000 && mouse_y < 1000)
+		mouse_y += y;
+
+	mouse_buttons = 0;
+	if (p[1]&0x80) mouse_buttons |= (1<<0);	// Left
+	if (p[1]&0x20) mouse_buttons |= (1<<1);	// Right
+	if (p[1]&0x40) mouse_buttons |= (1<<2);	// Middle
+	if (p[1]&0x10) mouse_buttons |= (1<<3);	// Shift
+}
+
+static void ThreeDOParse(void)
+{
+	unsigned char i=0, len, type;
+
+	slot_count = 0;
+	mouse_count = 0;
+	first_type = ThreeDOType(chain[0]);
+
+	while (i < chain_count && (len = ThreeDOLength(chain[i])) && i+len <= chain_count)
+	{
+		type = ThreeDOType(chain[i]);
+		if (type == DEV_MOUSE)
+		{
+			if (!mouse_count++)
+				ThreeDOMouse(chain+i);
+		}
+		else if (slot_count < CHAIN_DEVICES)
+		{
+			if (type == DEV_PAD)
+				ThreeDOPad(slot_state[slot_count], chain+i);
+			else
+				ThreeDOStick(slot_state[slot_count], chain+i);
+			slot_count++;
+		}
+		i += len;
+	}
 
-	PORTB |= (1<<PB5); //CLK=1
-	_delay_us(10);	
-	PORTB &= ~(1<<PB4); //P/S=0
+	// Unplugged controllers are released
+	for (i=slot_count; i<CHAIN_DEVICES; i++)
+	{
+		memset(slot_state[i], 0, SLOT_SIZE);
+		slot_state[i][0] = slot_state[i][1] = slot_state[i][2] = 0x80;
+	}
+	if (!mouse_count)
+		mouse_buttons = 0;
+}
 
-	for(button=0;button<15;button++)
+// Descriptor for the controllers of the last read
+static unsigned char ThreeDOMode(void)
+{
+	if (!slot_count && mouse_count)
+		return MODE_MOUSE;
+	if (first_type == DEV_PAD && slot_count == 1 && !mouse_count)
+		return MODE_PAD;
+	return MODE_CHAIN;
+}
+
+/* The descriptor was chosen at boot. When a lone joypad or mouse gets
+ * company, or the other way around, let the watchdog reset us so the host
+ * enumerates the new one.
+ */
+static void ThreeDOCheckPlug(void)
+{
+	if (first_type == 0 || ThreeDOMode() == mode)	// Nothing connected keeps the current one
 	{
-		PORTB &= ~(1<<PB5); //CLK=0
-		_delay_us(10);
-		last_update_state |= (((PINC&(1<<PC2))?1:0)<<(button));
-		PORTB |= (1<<PB5); //CLK=1
-		_delay_us(10);
+		plug_count = 0;
+		return;
 	}
 
-	PORTB |= (1<<PB4); //P/S=1
+	if (++plug_count >= PLUG_CHECKS)
+	{
+		wdt_enable(WDTO_15MS);
+		for(;;);
+	}
+}
+
+static void ThreeDOUpdate(void)
+{
+	if (chain_state == CHAIN_RUN)
+		return;
+
+	if (chain_state == CHAIN_DONE)
+	{
+		ThreeDOParse();
+		ThreeDOCheckPlug();
+		chain_state = CHAIN_IDLE;
+	}
+
+	if (++chain_period < CHAIN_PERIOD)
+		return;
+	chain_period = 0;
+
+	ThreeDOStart();
+	TCNT1 = 0;
+	TIFR1 = (1<<OCF1A);
+	TIMSK1 |= (1<<OCIE1A);
 }
 
 static char ThreeDOChanged(char id)
 {
-	return (last_update_state != last_reported_state);
+	if (id == CHAIN_MOUSE_ID || mode == MODE_MOUSE)
+		return (mouse_buttons != mouse_reported || mouse_x || mouse_y);
+	if (id < 1 || id > CHAIN_DEVICES)
+		return 0;
+
+	return memcmp(slot_state[id-1], slot_reported[id-1], SLOT_SIZE) != 0;
 }
 
 #define REPORT_SIZE 3
 
-static char ThreeDOBuildReport(unsigned char *reportBuffer, char id)
+static signed char ThreeDOClip(int v)
 {
-	int x,y;
-	unsigned int tmp;
-	
+	if (v > 127)
+		return 127;
+	if (v < -127)
+		return -127;
+	return v;
+}
+
+// [buttons, X, Y] of the first mouse
+static void ThreeDOMouseReport(unsigned char *reportBuffer, char consume)
+{
+	signed char x, y;
+
 	if (reportBuffer)
 	{
-		y = x = 0x80;
+		x = ThreeDOClip(mouse_x);
+		y = ThreeDOClip(mouse_y);
+		if (consume)
+		{
+			mouse_x -= x;
+			mouse_y -= y;
+		}
+		reportBuffer[0] = mouse_buttons;
+		reportBuffer[1] = x;
+		reportBuffer[2] = y;
+	}
+	if (consume)
+		mouse_reported = mouse_buttons;
+}
 
-		tmp = last_update_state;
+/* consume: mark the state as reported and take the motion reported away */
+static char ThreeDOReport(unsigned char *reportBuffer, char id, char consume)
+{
+	if (mode == MODE_MOUSE)
+	{
+		ThreeDOMouseReport(reportBuffer, consume);
+		return 3;
+	}
 
-	/* last_update_state format:
-	 * 
-	 * 15 14 13 12 11 10 9 8 7 6 5    4     3  2    1 0
-	 * 1  0  0  L  R  X  P C B A LEFT RIGHT UP DOWN 0 0
-	 */
-		
-		if (tmp&(1<<4)) { x = 0xff; }
-		if (tmp&(1<<5)) { x = 0x00; }
-		if (tmp&(1<<2)) { y = 0xff; }
-		if (tmp&(1<<3)) { y = 0x00; }
+	if (mode == MODE_PAD)	// [X, Y, buttons] of the lone joypad
+	{
+		if (reportBuffer)
+		{
+			reportBuffer[0] = slot_state[0][0];
+			reportBuffer[1] = slot_state[0][1];
+			reportBuffer[2] = slot_state[0][3];
+		}
+		if (consume)
+			memcpy(slot_reported[0], slot_state[0], SLOT_SIZE);
+
+		return REPORT_SIZE;
+	}
 
-		reportBuffer[0] = x;
-		reportBuffer[1] = y;
-		reportBuffer[2] = 0;
-		if (tmp&(1<<6)) reportBuffer[2] |= (1<<0);
-		if (tmp&(1<<7)) reportBuffer[2] |= (1<<1);
-		if (tmp&(1<<8)) reportBuffer[2] |= (1<<2);
-		if (tmp&(1<<9)) reportBuffer[2] |= (1<<3);
-		if (tmp&(1<<10)) reportBuffer[2] |= (1<<4);
-		if (tmp&(1<<11)) reportBuffer[2] |= (1<<5);
-		if (tmp&(1<<12)) reportBuffer[2] |= (1<<6);
+	if (id == CHAIN_MOUSE_ID)	// [report ID, buttons, X, Y]
+	{
+		if (reportBuffer)
+			reportBuffer[0] = id;
+		ThreeDOMouseReport(reportBuffer ? reportBuffer+1 : 0, consume);
+
+		return 4;
+	}
+
+	// [report ID, X, Y, Z, buttons 1-8, buttons 9-16]
+	if (id < 1 || id > CHAIN_DEVICES)
+		id = 1;
+	if (reportBuffer)
+	{
+		reportBuffer[0] = id;
+		memcpy(reportBuffer+1, slot_state[id-1], SLOT_SIZE);
 	}
-	last_reported_state = last_update_state;
+	if (consume)
+		memcpy(slot_reported[id-1], slot_state[id-1], SLOT_SIZE);
+
+	return SLOT_SIZE+1;
+}
 
-	return REPORT_SIZE;
+static char ThreeDOBuildReport(unsigned char *reportBuffer, char id)
+{
+	return ThreeDOReport(reportBuffer, id, 1);
+}
+
+static char ThreeDOPeekReport(unsigned char *reportBuffer, char id)
+{
+	return ThreeDOReport(reportBuffer, id, 0);
 }
 
 const char ThreeDO_usbHidReportDescriptor[] PROGMEM = {
@@ -167,12 +501,163 @@ const char ThreeDO_usbHidReportDescriptor[] PROGMEM = {
     0x15, 0x00,         //          LOGICAL_MINIMUM (0)
     0x26, 0xff, 0x00,   //          LOGICAL_MAXIMUM (255)
     0x75, 0x08,         //          REPORT_SIZE (8)
-    0x95, 0x01,         //          REPORT_COUNT (1)
+    0x95, 0x08,         //          REPORT_COUNT (8)
     0xb2, 0x02, 0x01,   //          FEATURE (Data,Var,Abs,Buf)	
 	0xc0,				//		END_COLLECTION
     0xc0,				// END_COLLECTION
 };
 
+/* Kept without physical collections: V-USB returns descriptors of 255 bytes
+ * at most. Logical minimum 0 is global and carries over the collections.
+ */
+const char ThreeDOChain_usbHidReportDescriptor[] PROGMEM = {
+	0x05, 0x01,			// USAGE_PAGE (Generic Desktop)
+    0x09, 0x05,			// USAGE (Game Pad)
+    0xa1, 0x01,			//	COLLECTION (Application)
+    0x85, 1,			//		REPORT_ID (1)
+	0x09, 0x30,			//		USAGE (X)
+    0x09, 0x31,			//		USAGE (Y)
+    0x09, 0x32,			//		USAGE (Z)
+    0x15, 0x00,			//		LOGICAL_MINIMUM (0)
+    0x26, 0xff, 0x00,	//		LOGICAL_MAXIMUM (255)
+    0x75, 0x08,			//		REPORT_SIZE (8)
+    0x95, 0x03,			//		REPORT_COUNT (3)
+    0x81, 0x02,			//		INPUT (Data,Var,Abs)
+    0x05, 0x09,			//		USAGE_PAGE (Button)
+    0x19, 1,			//		USAGE_MINIMUM (Button 1)
+    0x29, 16,			//		USAGE_MAXIMUM (Button 16)
+    0x25, 0x01,			//		LOGICAL_MAXIMUM (1)
+    0x75, 1,			//		REPORT_SIZE (1)
+    0x95, 16,			//		REPORT_COUNT (16)
+    0x81, 0x02,			//		INPUT (Data,Var,Abs)
+    0xc0,				// END_COLLECTION
+	0x05, 0x01,			// USAGE_PAGE (Generic Desktop)
+    0x09, 0x05,			// USAGE (Game Pad)
+    0xa1, 0x01,			//	COLLECTION (Application)
+    0x85, 2,			//		REPORT_ID (2)
+	0x09, 0x30,			//		USAGE (X)
+    0x09, 0x31,			//		USAGE (Y)
+    0x09, 0x32,			//		USAGE (Z)
+    0x26, 0xff, 0x00,	//		LOGICAL_MAXIMUM (255)
+    0x75, 0x08,			//		REPORT_SIZE (8)
+    0x95, 0x03,			//		REPORT_COUNT (3)
+    0x81, 0x02,			//		INPUT (Data,Var,Abs)
+    0x05, 0x09,			//		USAGE_PAGE (Button)
+    0x19, 1,			//		USAGE_MINIMUM (Button 1)
+    0x29, 16,			//		USAGE_MAXIMUM (Button 16)
+    0x25, 0x01,			//		LOGICAL_MAXIMUM (1)
+    0x75, 1,			//		REPORT_SIZE (1)
+    0x95, 16,			//		REPORT_COUNT (16)
+    0x81, 0x02,			//		INPUT (Data,Var,Abs)
+    0xc0,				// END_COLLECTION
+	0x05, 0x01,			// USAGE_PAGE (Generic Desktop)
+    0x09, 0x05,			// USAGE (Game Pad)
+    0xa1, 0x01,			//	COLLECTION (Application)
+    0x85, 3,			//		REPORT_ID (3)
+	0x09, 0x30,			//		USAGE (X)
+    0x09, 0x31,			//		USAGE (Y)
+    0x09, 0x32,			//		USAGE (Z)
+    0x26, 0xff, 0x00,	//		LOGICAL_MAXIMUM (255)
+    0x75, 0x08,			//		REPORT_SIZE (8)
+    0x95, 0x03,			//		REPORT_COUNT (3)
+    0x81, 0x02,			//		INPUT (Data,Var,Abs)
+    0x05, 0x09,			//		USAGE_PAGE (Button)
+    0x19, 1,			//		USAGE_MINIMUM (Button 1)
+    0x29, 16,			//		USAGE_MAXIMUM (Button 16)
+    0x25, 0x01,			//		LOGICAL_MAXIMUM (1)
+    0x75, 1,			//		REPORT_SIZE (1)
+    0x95, 16,			//		REPORT_COUNT (16)
+    0x81, 0x02,			//		INPUT (Data,Var,Abs)
+    0xc0,				// END_COLLECTION
+	0x05, 0x01,			// USAGE_PAGE (Generic Desktop)
+    0x09, 0x05,			// USAGE (Game Pad)
+    0xa1, 0x01,			//	COLLECTION (Application)
+    0x85, 4,			//		REPORT_ID (4)
+	0x09, 0x30,			//		USAGE (X)
+    0x09, 0x31,			//		USAGE (Y)
+    0x09, 0x32,			//		USAGE (Z)
+    0x26, 0xff, 0x00,	//		LOGICAL_MAXIMUM (255)
+    0x75, 0x08,			//		REPORT_SIZE (8)
+    0x95, 0x03,			//		REPORT_COUNT (3)
+    0x81, 0x02,			//		INPUT (Data,Var,Abs)
+    0x05, 0x09,			//		USAGE_PAGE (Button)
+    0x19, 1,			//		USAGE_MINIMUM (Button 1)
+    0x29, 16,			//		USAGE_MAXIMUM (Button 16)
+    0x25, 0x01,			//		LOGICAL_MAXIMUM (1)
+    0x75, 1,			//		REPORT_SIZE (1)
+    0x95, 16,			//		REPORT_COUNT (16)
+    0x81, 0x02,			//		INPUT (Data,Var,Abs)
+    0xc0,				// END_COLLECTION
+	0x05, 0x01,			// USAGE_PAGE (Generic Desktop)
+    0x09, 0x02,			// USAGE (Mouse)
+    0xa1, 0x01,			//	COLLECTION (Application)
+    0x85, CHAIN_MOUSE_ID,	//		REPORT_ID (5)
+    0x09, 0x01,			//		USAGE (Pointer)
+    0xa1, 0x00,			//		COLLECTION (Physical)
+    0x05, 0x09,			//			USAGE_PAGE (Button)
+    0x19, 0x01,			//			USAGE_MINIMUM (Button 1)
+    0x29, 0x04,			//			USAGE_MAXIMUM (Button 4)
+    0x25, 0x01,			//			LOGICAL_MAXIMUM (1)
+    0x75, 0x01,			//			REPORT_SIZE (1)
+    0x95, 0x04,			//			REPORT_COUNT (4)
+    0x81, 0x02,			//			INPUT (Data,Var,Abs)
+    0x75, 0x04,			//			REPORT_SIZE (4)
+    0x95, 0x01,			//			REPORT_COUNT (1)
+    0x81, 0x03,			//			INPUT (Const,Var,Abs)
+    0x05, 0x01,			//			USAGE_PAGE (Generic Desktop)
+    0x09, 0x30,			//			USAGE (X)
+    0x09, 0x31,			//			USAGE (Y)
+    0x15, 0x81,			//			LOGICAL_MINIMUM (-127)
+    0x25, 0x7f,			//			LOGICAL_MAXIMUM (127)
+    0x75, 0x08,			//			REPORT_SIZE (8)
+    0x95, 0x02,			//			REPORT_COUNT (2)
+    0x81, 0x06,			//			INPUT (Data,Var,Rel)
+    0x85, CHAIN_FEATURE_ID,	//			REPORT_ID (6)
+	0x09, 0x00,         //          USAGE (Undefined) // Used to trig bootloader when SET FEATURE
+    0x15, 0x00,         //          LOGICAL_MINIMUM (0)
+    0x26, 0xff, 0x00,   //          LOGICAL_MAXIMUM (255)
+    0x75, 0x08,         //          REPORT_SIZE (8)
+    0x95, 0x07,         //          REPORT_COUNT (7)
+    0xb2, 0x02, 0x01,   //          FEATURE (Data,Var,Abs,Buf)
+	0xc0,				//		END_COLLECTION
+    0xc0,				// END_COLLECTION
+};
+
+const char ThreeDOMouse_usbHidReportDescriptor[] PROGMEM = {
+    0x05, 0x01,			// USAGE_PAGE (Generic Desktop)
+    0x09, 0x02,			// USAGE (Mouse)
+    0xa1, 0x01,			//	COLLECTION (Application)
+    0x09, 0x01,			//		USAGE (Pointer)
+    0xa1, 0x00,			//		COLLECTION (Physical)
+    0x05, 0x09,			//			USAGE_PAGE (Button)
+    0x19, 0x01,			//			USAGE_MINIMUM (Button 1)
+    0x29, 0x04,			//			USAGE_MAXIMUM (Button 4)
+    0x15, 0x00,			//			LOGICAL_MINIMUM (0)
+    0x25, 0x01,			//			LOGICAL_MAXIMUM (1)
+    0x95, 0x04,			//			REPORT_COUNT (4)
+    0x75, 0x01,			//			REPORT_SIZE (1)
+    0x81, 0x02,			//			INPUT (Data,Var,Abs)
+    0x95, 0x01,			//			REPORT_COUNT (1)
+    0x75, 0x04,			//			REPORT_SIZE (4)
+    0x81, 0x03,			//			INPUT (Const,Var,Abs)
+    0x05, 0x01,			//			USAGE_PAGE (Generic Desktop)
+    0x09, 0x30,			//			USAGE (X)
+    0x09, 0x31,			//			USAGE (Y)
+    0x15, 0x81,			//			LOGICAL_MINIMUM (-127)
+    0x25, 0x7f,			//			LOGICAL_MAXIMUM (127)
+    0x75, 0x08,			//			REPORT_SIZE (8)
+    0x95, 0x02,			//			REPORT_COUNT (2)
+    0x81, 0x06,			//			INPUT (Data,Var,Rel)
+	0x09, 0x00,         //          USAGE (Undefined) // Used to trig bootloader when SET FEATURE
+    0x15, 0x00,         //          LOGICAL_MINIMUM (0)
+    0x26, 0xff, 0x00,   //          LOGICAL_MAXIMUM (255)
+    0x75, 0x08,         //          REPORT_SIZE (8)
+    0x95, 0x08,         //          REPORT_COUNT (8)
+    0xb2, 0x02, 0x01,   //          FEATURE (Data,Var,Abs,Buf)
+	0xc0,				//		END_COLLECTION
+    0xc0,				// END_COLLECTION
+};
+
 #define USBDESCR_DEVICE         1
 
 // This is the same descriptor as in devdesc.c, but the product id is 0x0a99 
@@ -202,6 +687,11 @@ Gamepad ThreeDOJoy = {
 	.update					=	ThreeDOUpdate,
 	.changed				=	ThreeDOChanged,
 	.buildReport			=	ThreeDOBuildReport,
+	.peekReport			=	ThreeDOPeekReport,
+	.buttons_offset			=	2,
+	.buttons_count			=	8,
+	.axes_offset			=	0,
+	.axes_count				=	2,
 };
 
 Gamepad *ThreeDOGetGamepad(void)
@@ -209,6 +699,40 @@ Gamepad *ThreeDOGetGamepad(void)
 	ThreeDOJoy.reportDescriptor = (void*)ThreeDO_usbHidReportDescriptor;
 	ThreeDOJoy.deviceDescriptor = (void*)ThreeDO_usbDescrDevice;
 
+	// Power the chain and see what is plugged, interrupts are not running yet
+	ThreeDOInit();
+	_delay_ms(10);
+	ThreeDOStart();
+	while (chain_state == CHAIN_RUN)
+	{
+		_delay_us(CHAIN_TICK_US);
+		ThreeDOTick();
+	}
+	ThreeDOParse();
+	chain_state = CHAIN_IDLE;
+
+	if (first_type != 0)
+		mode = ThreeDOMode();
+	if (mode == MODE_CHAIN)
+	{
+		ThreeDOJoy.num_reports = CHAIN_MOUSE_ID;
+		ThreeDOJoy.reportDescriptor = (void*)ThreeDOChain_usbHidReportDescriptor;
+		ThreeDOJoy.reportDescriptorSize = sizeof(ThreeDOChain_usbHidReportDescriptor);
+		ThreeDOJoy.buttons_offset = 4;
+		ThreeDOJoy.axes_offset = 1;
+		ThreeDOJoy.buttons_count = 16;
+		ThreeDOJoy.feature_report_id = CHAIN_FEATURE_ID;
+		ThreeDOJoy.mouse_report_id = CHAIN_MOUSE_ID;
+	}
+	else if (mode == MODE_MOUSE)
+	{
+		ThreeDOJoy.reportDescriptor = (void*)ThreeDOMouse_usbHidReportDescriptor;
+		ThreeDOJoy.reportDescriptorSize = sizeof(ThreeDOMouse_usbHidReportDescriptor);
+		ThreeDOJoy.buttons_offset = 0;
+		ThreeDOJoy.buttons_count = 4;
+		ThreeDOJoy.axes_count = 0;
+	}
+
 	return &ThreeDOJoy;
 }
 
@@ -26,6 +26,7 @@
 #include <string.h>
 #include "usbconfig.h"
 #include "amstrad.h"
+#include "debounce.h"
 
 static char amstradInit(void);
 static void amstradUpdate(void);
@@ -35,6 +36,8 @@ static char amstradBuildReport(unsigned char *reportBuffer, char id);
 static unsigned char last_update_state=0;
 static unsigned char last_reported_state=0;
 
+static Debouncer debouncer;
+
 static char amstradInit(void)
 {
 
@@ -59,12 +62,14 @@ static char amstradInit(void)
 	DDRD |= (1<<PD7);
 	PORTD &= ~(1<<PD7);
 
+	debounceInit(&debouncer, 0xff);
+
 	return 0;
 }
 
 static void amstradUpdate(void)
 {
-	last_update_state = ((PINB&0x3F) | ((PINC&(1<<PC3))<<3));
+	last_update_state = debounce(&debouncer, ((PINB&0x3F) | ((PINC&(1<<PC3))<<3)));
 }
 
 static char amstradChanged(char id)
@@ -129,7 +134,7 @@ const char amstrad_usbHidReportDescriptor[] PROGMEM = {
     0x15, 0x00,                    //     LOGICAL_MINIMUM (0)
     0x26, 0xff, 0x00,              //     LOGICAL_MAXIMUM (255)
     0x75, 0x08,                    //     REPORT_SIZE (8)
-    0x95, 0x01,                    //     REPORT_COUNT (1)
+    0x95, 0x08,                    //     REPORT_COUNT (8)
     0xb2, 0x02, 0x01,              //     FEATURE (Data,Var,Abs,Buf)	
     0xc0,                          //   END_COLLECTION
     0xc0                           // END_COLLECTION
@@ -164,6 +169,10 @@ Gamepad amstradJoy = {
 	.update					=	amstradUpdate,
 	.changed				=	amstradChanged,
 	.buildReport			=	amstradBuildReport,
+	.buttons_offset			=	2,
+	.buttons_count			=	8,
+	.axes_offset			=	0,
+	.axes_count				=	2,
 };
 
 Gamepad *amstradGetGamepad(void)
@@ -0,0 +1,24 @@
+#ifndef _turbo_h__
+#define _turbo_h__
+
+/* \brief Start the autofire clock, call after hardwareInit() has set up timer 2.
+ * \param offset index of the first button byte in the report
+ * \param count number of buttons, 0 disables autofire
+ */
+void turboInit(unsigned char offset, unsigned char count);
+
+/* \brief Reload the rate and duty cycle from config, call when it changes. */
+void turboCompile(void);
+
+/* \brief Mask the autofire buttons of a report during the released phase.
+ * Call after remapApply(), config.turbo_mask is in report order.
+ * \param id report ID the report was built for (1 if the descriptor has none)
+ */
+void turboApply(unsigned char *report, unsigned char id);
+
+/* return Once per autofire toggle, the bitmask of the reports (bit id-1)
+ * that hold an autofire button, 0 otherwise
+ */
+unsigned char turboEdge(void);
+
+#endif // _turbo_h__
@@ -25,12 +25,26 @@
 #include <avr/wdt.h>
 #include <avr/pgmspace.h>
 #include <avr/interrupt.h>
+#include <util/atomic.h>
 #include <string.h>
 #include "usbconfig.h"
 #include "apple2joy.h"
+#include "config.h"
+#include "suspend.h"
 
 #define SETUPDELAY 50	// Time to reset the capacitor back to GND
-#define DIVIDER 5	// Divider of the read value to match with 0-255.
+#define DIVIDER config.divider	// Divider of the read value to match with 0-255, see CFG_DEFAULT_DIVIDER
+#define POT_TIMEOUT 0x4000	// Timer1 counts (~87ms) before an axis is taken as disconnected
+
+/* 1 reports each axis on 16 bits, 0-1023 (4 times the 8 bit range), instead
+ * of 8. Set it in usbconfig.h.
+ */
+#ifndef APPLE2_REPORT_16BIT
+#define APPLE2_REPORT_16BIT 0
+#endif
+
+#define POT_DISCHARGE	0
+#define POT_CHARGE		1
 
 void mux(char);
 void resetport(char);
@@ -43,34 +57,52 @@ static char apple2BuildReport(unsigned char *reportBuffer, char id);
 volatile unsigned int potx,poty;
 volatile unsigned int old_potx,old_poty;
 
+static unsigned char pot_phase=POT_DISCHARGE;
+static unsigned int pot_start;				// Timer1 when both axes started charging
+static volatile unsigned int x_time, y_time;	// Timer1 when each one came back up
+static volatile unsigned char x_pending, y_pending;
+static unsigned char last_pind;				// PIND at the previous PCINT2, for suspend.c
+
 static unsigned char button_state;
 static unsigned char button_reported_state;
 
 static char apple2Init(void)
 {
-	/* PIN1 = PB0 = BUT1 (I,0)
-	 * PIN2 = PB1 = VCC  (O,1)
-	 * PIN3 = PB2 = GND  (O,0)
-	 * PIN4 = PB3 = nc
-	 * PIN5 = PC1 = POTX (I,0) PC3 = (I,0)
-	 * PIN6 = PB4 = nc
-	 * PIN7 = PB5 = BUT0 (I,0)
-	 * PIN8 = PD7 = POTY (I,0) PD6 = (I,0)
-	 * PIN9 = PC0 = nc
-	 */
-	
-	DDRB &= ~((1<<PB0)|(1<<PB5));
-	DDRB |= ((1<<PB1)|(1<<PB2));
-	PORTB |= ((1<<PB1));
-	PORTB &= ~((1<<PB0)|(1<<PB2)|(1<<PB5));
-
-	DDRD &= ~((1<<PD7)|(1<<PD6));
-	PORTD &= ~((1<<PD7)|(1<<PD6));
-
-	DDRC &= ~((1<<PC1)|(1<<PC3));
+	/* PIN1 = PB0 = BUT1 (I,0)
+	 * PIN2 = PB1 = VCC  (O,1)
+	 * PIN3 = PB2 = GND  (O,0)
+	 * PIN4 = PB3 = nc
+	 * PIN5 = PC1 = POTX (I,0) PC3 = (I,0)
+	 * PIN6 = PB4 = nc
+	 * PIN7 = PB5 = BUT0 (I,0)
+	 * PIN8 = PD7 = POTY (I,0) PD6 = (I,0)
+	 * PIN9 = PC0 = nc
+	 */
+	
+	DDRB &= ~((1<<PB0)|(1<<PB5));
+	DDRB |= ((1<<PB1)|(1<<PB2));
+	PORTB |= ((1<<PB1));
+	PORTB &= ~((1<<PB0)|(1<<PB2)|(1<<PB5));
+
+	DDRD &= ~((1<<PD7)|(1<<PD6));
+	PORTD &= ~((1<<PD7)|(1<<PD6));
+
+	DDRC &= ~((1<<PC1)|(1<<PC3));
 	PORTC &= ~((1<<PC1)|(1<<PC3));
 
-	TCCR1B |= ((1<<CS10)|(1<<CS11));// CPU/64 @ 12MHz = 187,5KHz
+	TCCR1B = ((1<<CS10)|(1<<CS11));// CPU/64 @ 12MHz = 187,5KHz, free running
+
+	// Discharge both axes, the first poll starts charging them
+	DDRC |= ((1<<(PC1)));
+	DDRD |= ((1<<(PD6)));
+	pot_phase = POT_DISCHARGE;
+
+	// Pin change interrupts on POTX (PCINT9) and POTY (PCINT22)
+	PCMSK1 |= (1<<PCINT9);
+	PCMSK2 |= (1<<PCINT22);
+	PCIFR = (1<<PCIF1)|(1<<PCIF2);
+	PCICR |= (1<<PCIE1)|(1<<PCIE2);
+	suspendSharePCINT2();	// D- (PCINT16) comes through our handler too
 
 	old_potx=potx=0;
 	old_poty=poty=0;
@@ -80,50 +112,89 @@ static char apple2Init(void)
 	return 0;
 }
 
+/* Both axes charge at the same time. Timer1 runs free, the pin change
+ * interrupts timestamp each axis as its pin comes back up, and update()
+ * only checks whether the slower one is done: a reading costs the longest
+ * charge time instead of the sum of both, and nothing waits for it.
+ */
 static void apple2Update(void)
 {
+	unsigned int now;
+	unsigned char pending;
+
 	// Read buttons
 	button_state=(PINB&((1<<PB5)|(1<<PB0)));
 
-	potx=poty=0;
-	// Read X in polling using timer1
-	wdt_reset();
-	DDRC |= ((1<<(PC1)));		// Force port to ground (discharge capacitor)
-	_delay_us(SETUPDELAY);	
-	DDRC &= ~((1<<(PC1)));	// Put back port in read mode
-
-	TCNT1=0;					// Reset timer0 value
-	TIFR1|=(1<<TOV1);			// Clear overflow flag
-
-	while((!(PINC&(1<<(PC1))))&&!(TIFR1&(1<<TOV1)));	// Wait until pin comes back up. This will correspond to the t=RC 
-														// where R is the value of the POT, thus the position.
-														// or if overflow flow trigged.
-		
-	potx=TCNT1;	// Give channel the timer read.
-	
-	// If disconnected, center paddle
-	if(TIFR1&(1<<TOV1))
-		potx=127*DIVIDER;
-	
-	// Read Y in polling using timer1
-	wdt_reset();
-	DDRD |= ((1<<(PD6)));		// Force port to ground (discharge capacitor)
-	_delay_us(SETUPDELAY);
-	DDRD &= ~((1<<(PD6)));	// Put back port in read mode
-
-	TCNT1=0;					// Reset timer0 value
-	TIFR1|=(1<<TOV1);			// Clear overflow flag
-
-	while((!(PIND&(1<<(PD6))))&&!(TIFR1&(1<<TOV1)));	// Wait until pin comes back up. This will correspond to the t=RC
-														// where R is the value of the POT, thus the position.
-														// or if overflow flow trigged.
-	
-	poty=TCNT1;	// Give channel the timer read.
+	if (pot_phase == POT_DISCHARGE)
+	{
+		// Grounded since the last poll, much longer than SETUPDELAY
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			DDRC &= ~((1<<(PC1)));	// Put back ports in read mode
+			DDRD &= ~((1<<(PD6)));
+			pot_start = TCNT1;
+			x_pending = y_pending = 1;
+		}
+		pot_phase = POT_CHARGE;
+		return;
+	}
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		now = TCNT1;
+	}
+	pending = x_pending | y_pending;
+
+	if (pending && (unsigned int)(now - pot_start) < POT_TIMEOUT)
+		return;	// Slower axis still charging
+
+	// The time to come back up corresponds to t=RC, where R is the value of
+	// the POT, thus the position. If disconnected, center paddle.
+	potx = x_pending ? 127*DIVIDER : x_time - pot_start;
+	poty = y_pending ? 127*DIVIDER : y_time - pot_start;
+
+	// Force ports to ground (discharge capacitors) until the next poll
+	x_pending = y_pending = 0;
+	DDRC |= ((1<<(PC1)));
+	DDRD |= ((1<<(PD6)));
+	pot_phase = POT_DISCHARGE;
+}
 
-	// If disconnected, center paddle
-	if(TIFR1&(1<<TOV1))
-		poty=127*DIVIDER;
+ISR(PCINT1_vect, ISR_NOBLOCK)	// POTX, keep V-USB interrupt latency low
+{
+	unsigned int t;
 
+	ATOMIC_BLOCK(ATOMIC_FORCEON)	// The other axis may read TCNT1 too
+	{
+		t = TCNT1;
+	}
+	if (x_pending && (PINC&(1<<PC1)))
+	{
+		x_time = t;
+		x_pending = 0;
+	}
+}
+
+ISR(PCINT2_vect, ISR_NOBLOCK)	// POTY, and D- for suspend.c
+{
+	unsigned int t;
+	unsigned char pind;
+
+	ATOMIC_BLOCK(ATOMIC_FORCEON)
+	{
+		t = TCNT1;
+	}
+	pind = PIND;
+	if (y_pending && (pind&(1<<PD6)))
+	{
+		y_time = t;
+		y_pending = 0;
+	}
+
+	// POTY is where it was, the change was on D-: the bus is not suspended
+	if (((pind ^ last_pind) & (1<<PD6)) == 0)
+		suspendBusEdge();
+	last_pind = pind;
 }
 
 static char apple2Changed(char id)
@@ -131,38 +202,55 @@ static char apple2Changed(char id)
 	return ((button_state != button_reported_state)||(old_potx != potx)||(old_poty != poty));		
 }
 
+#if APPLE2_REPORT_16BIT
+#define REPORT_SIZE 5
+#define AXIS_MAX 1023
+#define AXIS_SCALE 4
+#else
 #define REPORT_SIZE 3
+#define AXIS_MAX 255
+#define AXIS_SCALE 1
+#endif
+
+// Calculate the channel value relative to the report range
+static unsigned int apple2Axis(unsigned int pot)
+{
+	unsigned long v;
+
+	v=((unsigned long)pot*AXIS_SCALE)/DIVIDER;
+
+	// Clipping
+	if(v>AXIS_MAX)
+		v=AXIS_MAX;
+
+	return v;
+}
 
 static char apple2BuildReport(unsigned char *reportBuffer, char id)
 {
-	int x,y;
+	unsigned int x,y;
 	unsigned char tmp;
 
 	if (reportBuffer)
 	{
-		// Calculate the channel value relative to a char (0-255)
-		x=(potx/DIVIDER);
-		y=(poty/DIVIDER);
-
-		// Clipping
-		if(x>255)
-			x=255;
-		else if(x<0)
-			x=0;
-
-		if(y>255)
-			y=255;
-		else if(y<0)
-			y=0;
+		x=apple2Axis(potx);
+		y=apple2Axis(poty);
 
 		tmp=button_state;
 
+#if APPLE2_REPORT_16BIT
+		reportBuffer[0]=x;
+		reportBuffer[1]=x>>8;
+		reportBuffer[2]=y;
+		reportBuffer[3]=y>>8;
+#else
 		reportBuffer[0]=(char)x;
 		reportBuffer[1]=(char)y;
+#endif
 
-		reportBuffer[2] = 0;
-		if (tmp&(1<<PB5)) reportBuffer[2] |= 0x01;	
-		if (tmp&(1<<PB0)) reportBuffer[2] |= 0x02;
+		reportBuffer[REPORT_SIZE-1] = 0;
+		if (tmp&(1<<PB5)) reportBuffer[REPORT_SIZE-1] |= 0x01;	
+		if (tmp&(1<<PB0)) reportBuffer[REPORT_SIZE-1] |= 0x02;
 	}
 
 	button_reported_state=button_state;
@@ -182,8 +270,13 @@ const char apple2_usbHidReportDescriptor[] PROGMEM = {
     0x09, 0x30,                    //     USAGE (X)
     0x09, 0x31,                    //     USAGE (Y)
     0x15, 0x00,                    //     LOGICAL_MINIMUM (0)
+#if APPLE2_REPORT_16BIT
+    0x26, 0xff, 0x03,              //     LOGICAL_MAXIMUM (1023)
+    0x75, 0x10,                    //     REPORT_SIZE (16)
+#else
     0x26, 0xff, 0x00,              //     LOGICAL_MAXIMUM (255)
     0x75, 0x08,                    //     REPORT_SIZE (8)
+#endif
     0x95, 0x02,                    //     REPORT_COUNT (2)
     0x81, 0x02,                    //     INPUT (Data,Var,Abs)
     0x05, 0x09,                    //     USAGE_PAGE (Button)
@@ -198,7 +291,7 @@ const char apple2_usbHidReportDescriptor[] PROGMEM = {
     0x15, 0x00,                    //     LOGICAL_MINIMUM (0)
     0x26, 0xff, 0x00,              //     LOGICAL_MAXIMUM (255)
     0x75, 0x08,                    //     REPORT_SIZE (8)
-    0x95, 0x01,                    //     REPORT_COUNT (1)
+    0x95, 0x08,                    //     REPORT_COUNT (8)
     0xb2, 0x02, 0x01,              //     FEATURE (Data,Var,Abs,Buf)
     0xc0,                          //   END_COLLECTION
     0xc0                           // END_COLLECTION
@@ -234,6 +327,10 @@ Gamepad apple2Joy = {
 	.update					=	apple2Update,
 	.changed				=	apple2Changed,
 	.buildReport			=	apple2BuildReport,
+	.buttons_offset			=	REPORT_SIZE-1,
+	.buttons_count			=	8,
+	.axes_offset			=	0,
+	.axes_count				=	APPLE2_REPORT_16BIT ? 0 : 2,
 };
 
 Gamepad *apple2GetGamepad(void)
@@ -34,6 +34,14 @@
 #include "apple2joy.h"
 
 #include "devdesc.h"
+#include "config.h"
+#include "remap.h"
+#include "turbo.h"
+#include "pack.h"
+#include "boottime.h"
+#include "suspend.h"
+#include "keyboard.h"
+#include "diag.h"
 
 #include "../bootloader/fuses.h"
 #include "../bootloader/bootloader.h"
@@ -50,15 +58,15 @@ char usbDescriptorConfiguration[] = { 0 }; // dummy
 uchar my_usbDescriptorConfiguration[] = {    /* USB configuration descriptor */
     9,          /* sizeof(usbDescriptorConfiguration): length of descriptor in bytes */
     USBDESCR_CONFIG,    /* descriptor type */
-    18 + 7 * USB_CFG_HAVE_INTRIN_ENDPOINT + 9, 0,
+    18 + 7 * USB_CFG_HAVE_INTRIN_ENDPOINT + 9 + 25 * USB_CFG_HAVE_INTRIN_ENDPOINT3, 0,
                 /* total length of data returned (including inlined descriptors) */
-    1,          /* number of interfaces in this configuration */
+    1 + USB_CFG_HAVE_INTRIN_ENDPOINT3,   /* number of interfaces in this configuration */
     1,          /* index of this configuration */
     0,          /* configuration name string index */
 #if USB_CFG_IS_SELF_POWERED
-    USBATTR_SELFPOWER,  /* attributes */
+    USBATTR_SELFPOWER | USBATTR_REMOTEWAKE,  /* attributes */
 #else
-    USBATTR_BUSPOWER,   /* attributes */
+    USBATTR_BUSPOWER | USBATTR_REMOTEWAKE,   /* attributes */
 #endif
     USB_CFG_MAX_BUS_POWER/2,            /* max USB current in 2mA units */
 /* interface descriptor follows inline: */
@@ -86,10 +94,69 @@ uchar my_usbDescriptorConfiguration[] = {    /* USB configuration descriptor */
     8, 0,       /* maximum packet size */
     USB_CFG_INTR_POLL_INTERVAL, /* in ms */
 #endif
+#if USB_CFG_KEYBOARD    /* boot keyboard interface, see keyboard.h */
+    9,          /* sizeof(usbDescrInterface): length of descriptor in bytes */
+    USBDESCR_INTERFACE, /* descriptor type */
+    KEYBOARD_INTERFACE, /* index of this interface */
+    0,          /* alternate setting for this interface */
+    1,          /* endpoints excl 0: number of endpoint descriptors to follow */
+    3,          /* HID */
+    1,          /* boot interface */
+    1,          /* keyboard */
+    0,          /* string index for interface */
+    9,          /* sizeof(usbDescrHID): length of descriptor in bytes */
+    USBDESCR_HID,   /* descriptor type: HID */
+    0x10, 0x01, /* BCD representation of HID version */
+    0x00,       /* target country code */
+    0x01,       /* number of HID Report (or other HID class) Descriptor infos to follow */
+    0x22,       /* descriptor type: report */
+    KEYBOARD_REPORT_DESCRIPTOR_LENGTH, 0,  /* total length of report descriptor */
+    7,          /* sizeof(usbDescrEndpoint) */
+    USBDESCR_ENDPOINT,  /* descriptor type = endpoint */
+    0x80 | USB_CFG_EP3_NUMBER,  /* IN endpoint number 3 */
+    0x03,       /* attrib: Interrupt endpoint */
+    8, 0,       /* maximum packet size */
+    USB_CFG_INTR_POLL_INTERVAL, /* in ms */
+#endif
+#if USB_CFG_DIAGNOSTICS    /* vendor-defined diagnostics interface, see diag.h */
+    9,          /* sizeof(usbDescrInterface): length of descriptor in bytes */
+    USBDESCR_INTERFACE, /* descriptor type */
+    DIAG_INTERFACE, /* index of this interface */
+    0,          /* alternate setting for this interface */
+    1,          /* endpoints excl 0: number of endpoint descriptors to follow */
+    3,          /* HID */
+    0,          /* no subclass */
+    0,          /* no protocol */
+    0,          /* string index for interface */
+    9,          /* sizeof(usbDescrHID): length of descriptor in bytes */
+    USBDESCR_HID,   /* descriptor type: HID */
+    0x10, 0x01, /* BCD representation of HID version */
+    0x00,       /* target country code */
+    0x01,       /* number of HID Report (or other HID class) Descriptor infos to follow */
+    0x22,       /* descriptor type: report */
+    DIAG_REPORT_DESCRIPTOR_LENGTH, 0,  /* total length of report descriptor */
+    7,          /* sizeof(usbDescrEndpoint) */
+    USBDESCR_ENDPOINT,  /* descriptor type = endpoint */
+    0x80 | USB_CFG_EP3_NUMBER,  /* IN endpoint number 3 */
+    0x03,       /* attrib: Interrupt endpoint */
+    8, 0,       /* maximum packet size */
+    USB_CFG_INTR_POLL_INTERVAL, /* in ms */
+#endif
 };
 
 static Gamepad *curGamepad;
 
+#define isMouseReport(id)	(curGamepad->mouse_report_id && (id) == curGamepad->mouse_report_id)
+
+/* All the controllers go in report 1 without ID, see pack.h */
+static uchar packed;
+#define numReports()		(packed ? 1 : curGamepad->num_reports)
+#define featureReportId()	(packed ? 0 : curGamepad->feature_report_id)
+
+#ifdef BOOT_TIMING
+unsigned int boot_stamps[BOOT_STAGES];
+#endif
+
 /* ----------------------- hardware I/O abstraction ------------------------ */
 
 static void hardwareInit(void)
@@ -134,12 +201,25 @@ static void hardwareInit(void)
 	TCCR2A = (1<<WGM21);
 	TCCR2B =(1<<CS22)|(1<<CS21)|(1<<CS20);
 	OCR2A = 6;  // for 2kHz
+	TIMSK2 |= (1<<OCIE2A);	// Wakes the main loop up, see poll_tick
 }
 
-static uchar    reportBuffer[6];    /* buffer for HID reports */
+static uchar    reportBuffer[8];    /* buffer for HID reports, one low-speed interrupt transfer */
+
+/* Set by the timer 2 interrupt rather than polled in TIFR2: the interrupt
+ * is what wakes the CPU up from the idle sleep of the main loop */
+static volatile uchar poll_tick;
+
+extern volatile schar usbRxLen;	// usbdrv.c, a packet waiting for usbPoll()
+
+ISR(TIMER2_COMPA_vect, ISR_NOBLOCK)	// Keep V-USB interrupt latency low
+{
+	diagTick(poll_tick);
+	poll_tick = 1;
+}
 
-#define mustPollController()   (TIFR2 & (1<<OCF2A))
-#define clrPollController()    do { TIFR2 = (1<<OCF2A); } while(0)
+#define mustPollController()   (poll_tick)
+#define clrPollController()    do { poll_tick = 0; } while(0)
 #define mustRunLoop()		(TIFR0 & (1<<TOV0))
 #define clrRunLoop()		do { TIFR0 = 1<<TOV0; } while(0)
 
@@ -151,6 +231,8 @@ static uchar    idleRates[MAX_REPORTS];           /* in 4 ms units */
 
 uchar	usbFunctionDescriptor(struct usbRequest *rq)
 {
+	bootStamp(BOOT_STAGE_DESCRIPTOR);
+
 	if ((rq->bmRequestType & USBRQ_TYPE_MASK) != USBRQ_TYPE_STANDARD)
 		return 0;
 
@@ -163,6 +245,20 @@ uchar	usbFunctionDescriptor(struct usbRequest *rq)
 				usbMsgPtr = rt_usbDeviceDescriptor;		
 				return rt_usbDeviceDescriptorSize;
 			case USBDESCR_HID_REPORT:
+#if USB_CFG_KEYBOARD
+				if (rq->wIndex.bytes[0] == KEYBOARD_INTERFACE)
+				{
+					usbMsgPtr = (void *)keyboard_usbHidReportDescriptor;
+					return KEYBOARD_REPORT_DESCRIPTOR_LENGTH;
+				}
+#endif
+#if USB_CFG_DIAGNOSTICS
+				if (rq->wIndex.bytes[0] == DIAG_INTERFACE)
+				{
+					usbMsgPtr = (void *)diag_usbHidReportDescriptor;
+					return DIAG_REPORT_DESCRIPTOR_LENGTH;
+				}
+#endif
 				usbMsgPtr = rt_usbHidReportDescriptor;
 				return rt_usbHidReportDescriptorSize;
 			case USBDESCR_CONFIG:
@@ -174,6 +270,53 @@ uchar	usbFunctionDescriptor(struct usbRequest *rq)
 	return 0;
 }
 
+/* Changes first seen by a GET_REPORT, main() still owes them to endpoint 1 */
+static uchar setup_pending;
+
+/* The SET_REPORT data starts with the report ID the host named in wValue.
+ * A v3.2 tool sends 0x5A alone with ID 0, even to a descriptor with IDs. */
+static uchar feature_skip;
+
+/* Read the controller, return the bitmask of the reports that changed */
+static uchar pollController(void)
+{
+	uchar changed = 0;
+	int i;
+
+	diagStart(DIAG_TIME_UPDATE);
+	curGamepad->update();
+	diagStop(DIAG_TIME_UPDATE);
+	diagCount(DIAG_POLLS);
+
+	for (i=0; i<curGamepad->num_reports; i++) {
+		if (curGamepad->changed(i+1))
+			changed |= packed ? 1 : (1<<i);
+	}
+
+	return changed;
+}
+
+/* The packed report, each controller remapped and with its autofire */
+static char buildPackedReport(uchar *buf, char (*build)(unsigned char *, char))
+{
+	uchar pad[sizeof(reportBuffer)];
+	char id;
+
+	packClear(buf);
+	for (id=1; id<=curGamepad->num_reports; id++)
+	{
+		build(pad, id);
+		remapApply(pad);
+#if USB_CFG_KEYBOARD
+		if (id == 1 && build == curGamepad->buildReport)
+			keyboardUpdate(pad);
+#endif
+		turboApply(pad, id);
+		packAdd(buf, pad, id);
+	}
+	return PACK_REPORT_SIZE;
+}
+
 static uchar setupBuffer[sizeof(reportBuffer)];
 
 uchar	usbFunctionSetup(uchar data[8])
@@ -182,15 +325,60 @@ uchar	usbFunctionSetup(uchar data[8])
 	int i;
 
 	usbMsgPtr = setupBuffer;
+
+#if USB_CFG_KEYBOARD
+	if ((rq->bmRequestType & USBRQ_RCPT_MASK) == USBRQ_RCPT_INTERFACE && rq->wIndex.bytes[0] == KEYBOARD_INTERFACE)
+		return keyboardSetup(data);
+#endif
+#if USB_CFG_DIAGNOSTICS
+	if ((rq->bmRequestType & USBRQ_RCPT_MASK) == USBRQ_RCPT_INTERFACE && rq->wIndex.bytes[0] == DIAG_INTERFACE)
+		return diagSetup(data);
+#endif
 	
 	if((rq->bmRequestType & USBRQ_TYPE_MASK) == USBRQ_TYPE_CLASS){    /* class request type */
+		bootStamp(BOOT_STAGE_CONFIGURED);
+		diagCount(DIAG_SETUPS);
+		diagTrace(DIAG_TRACE_SETUP, rq->bRequest);
 		switch (rq->bRequest)
 		{
 			case USBRQ_HID_GET_REPORT:
 				/* wValue: ReportType (highbyte), ReportID (lowbyte) */
-				return curGamepad->buildReport(setupBuffer, rq->wValue.bytes[0]);
+				if (rq->wValue.bytes[1] == 3) { // Feature
+					if (featureReportId()) {
+						setupBuffer[0] = featureReportId();
+						return configFeatureRead(setupBuffer+1, sizeof(setupBuffer)-1)+1;
+					}
+					return configFeatureRead(setupBuffer, sizeof(setupBuffer));
+				}
+				/* Optionally read the controller first, only when its tick
+				 * is due anyway so that the drivers keep their timing */
+				if (config.get_report_poll && mustPollController()) {
+					clrPollController();
+					diagStop(DIAG_TIME_TICK);
+					setup_pending |= pollController();
+				}
+				if (packed)
+					return buildPackedReport(setupBuffer, curGamepad->peekReport);
+				if (curGamepad->peekReport) {
+					i = curGamepad->peekReport(setupBuffer, rq->wValue.bytes[0]);
+				} else {
+					/* buildReport() marks the state as reported, a change
+					 * it returns here must still go out on endpoint 1 */
+					uchar id = rq->wValue.bytes[0];
+					if (id < 1 || id > curGamepad->num_reports)
+						id = 1;	// As the drivers do
+					if (curGamepad->changed(id))
+						setup_pending |= (1<<(id-1));
+					i = curGamepad->buildReport(setupBuffer, rq->wValue.bytes[0]);
+				}
+				if (!isMouseReport(rq->wValue.bytes[0])) {
+					remapApply(setupBuffer);
+					turboApply(setupBuffer, rq->wValue.bytes[0]);
+				}
+				return i;
 
 			case USBRQ_HID_SET_REPORT:
+				feature_skip = rq->wValue.bytes[0] ? 1 : 0;
 				return USB_NO_MSG;  /* use usbFunctionWrite() to receive data from host */
 
 			case USBRQ_HID_GET_IDLE:
@@ -221,28 +409,58 @@ uchar	usbFunctionSetup(uchar data[8])
  */
 uchar   usbFunctionWrite(uchar *data, uchar len)
 {
-	if(data[0]==0x5A)
+	uchar skip = feature_skip;	// Report ID in front
+	uchar result;
+
+	if(len <= skip)
+		return len;
+	diagTrace(DIAG_TRACE_FEATURE, data[skip]);
+	if(data[skip]==CFG_CMD_BOOTLOADER)
+	{
 		jumptobootloader=1;
+		return len;
+	}
+	result = configFeatureWrite(data+skip, len-skip);
+	if(result == CFG_WRITE_REFUSED)
+		return 0xff;	// STALL, the host sees the write fail
+	if(result)
+	{
+		remapCompile();
+		turboCompile();
+#if USB_CFG_KEYBOARD
+		keyboardCompile();
+#endif
+	}
     return len;
 }
 
 __attribute__ ((OS_main)) int main(void)
 {
-	char must_report = 0, first_run = 1;
+	uchar must_report = 0, next_report = 0, changed;
+	char first_run = 1;
 	uchar idleCounters[MAX_REPORTS];
 	int i;
 
+	bootTimeStart();
 	jumptobootloader=0;
 
 	memset(idleCounters, 0, MAX_REPORTS);
 	memset(idleRates, 0, MAX_REPORTS); // infinity
 
 	curGamepad = apple2GetGamepad();
+	bootStamp(BOOT_STAGE_DETECT);
+	configInit();
+	packed = packInit(curGamepad);
 
 	// configure report descriptor according to
 	// the current gamepad
 	rt_usbHidReportDescriptor = curGamepad->reportDescriptor;
 	rt_usbHidReportDescriptorSize = curGamepad->reportDescriptorSize;
+	if (packed)
+	{
+		rt_usbHidReportDescriptor = (void*)pack_usbHidReportDescriptor;
+		rt_usbHidReportDescriptorSize = PACK_REPORT_DESCRIPTOR_LENGTH;
+	}
 
 	if (curGamepad->deviceDescriptor != 0)
 	{
@@ -262,15 +480,26 @@ __attribute__ ((OS_main)) int main(void)
 
 	wdt_enable(WDTO_2S);
 	hardwareInit();
+	bootStamp(BOOT_STAGE_HARDWARE);
 	set_sleep_mode(SLEEP_MODE_IDLE);
 
+	remapInit(curGamepad->buttons_offset, curGamepad->buttons_count);
+	turboInit(curGamepad->buttons_offset, curGamepad->buttons_count);
+#if USB_CFG_KEYBOARD
+	keyboardInit(curGamepad->axes_offset, curGamepad->axes_count, curGamepad->buttons_offset, curGamepad->buttons_count);
+#endif
 	curGamepad->init();
+	suspendInit();
+	bootStamp(BOOT_STAGE_INIT);
 	
 	usbInit();
 	sei();
+	bootStamp(BOOT_STAGE_USB);
 	
 	for(;;){	/* main event loop */
 		wdt_reset();
+		diagStop(DIAG_TIME_PASS);
+		diagStart(DIAG_TIME_PASS);
 		if(jumptobootloader)
 		{
 			cli(); // Clear interrupts
@@ -285,6 +514,10 @@ __attribute__ ((OS_main)) int main(void)
 
 		// this must be called at each 50 ms or less
 		usbPoll();
+		must_report |= setup_pending;
+		setup_pending = 0;
+
+		configTask();
 
 		if (first_run) {
 			curGamepad->update();
@@ -296,7 +529,10 @@ __attribute__ ((OS_main)) int main(void)
 		if(mustRunLoop())  /* 22 ms timer */
 		{
 			clrRunLoop();
-			for (i=0; i<curGamepad->num_reports; i++) 
+#if USB_CFG_KEYBOARD
+			keyboardTick();
+#endif
+			for (i=0; i<numReports(); i++) 
 			{
 				if(idleRates[i] != 0)
 				{
@@ -315,6 +551,22 @@ __attribute__ ((OS_main)) int main(void)
 		if (mustPollController())
 		{
 			clrPollController();
+			diagStop(DIAG_TIME_TICK);
+
+			/* No keep-alive for 3ms: the host suspended the bus */
+			if (suspendTask())
+			{
+				diagCount(DIAG_SUSPENDS);
+				diagTrace(DIAG_TRACE_SUSPEND, 0);
+				suspendSleep();
+				diagTrace(DIAG_TRACE_RESUME, 0);
+
+				// The controller may have changed while we slept, read it
+				// again before anything is reported
+				first_run = 1;
+				must_report = (1<<numReports())-1;
+				continue;
+			}
 
 			// Ok, the timer tells us it is time to update
 			// the controller status. 
@@ -325,41 +577,75 @@ __attribute__ ((OS_main)) int main(void)
 			// delays from messing with the timing in the controller update 
 			// function. 
 
-			curGamepad->update();
-
 			/* Check what will have to be reported */
-			for (i=0; i<curGamepad->num_reports; i++) {
-				if (curGamepad->changed(i+1)) {
-					must_report |= (1<<i);
-				}
-			}
+			changed = pollController();
+			if (must_report & changed)
+				diagCount(DIAG_COALESCED);	// A previous change is still waiting
+			must_report |= changed;
 		}
 			
-		if(must_report)
+		/* Autofire toggled, resend the reports that hold a button */
+		changed = turboEdge();
+		if (packed && changed)
+			changed = 1;	// They all go in report 1
+		must_report |= changed & ((1<<numReports())-1);
+
+		/* Hand at most one report to the driver per pass instead of waiting
+		 * for each transfer to complete. A report that could not be sent yet
+		 * stays pending and is built from the newest state when the endpoint
+		 * frees up, so changes arriving in between are coalesced into it. */
+		if(must_report && usbInterruptIsReady())
 		{
-			for (i=0; i<curGamepad->num_reports; i++)
-			{
-				if ((must_report & (1<<i)) == 0)
-					continue;
+			char len;
 
-				if (usbInterruptIsReady())
-				{
-					char len;
-
-					len = curGamepad->buildReport(reportBuffer, i+1);
-					usbSetInterrupt(reportBuffer, len);
+			// Round robin so a busy controller cannot starve the others
+			do {
+				if (++next_report >= numReports())
+					next_report = 0;
+			} while ((must_report & (1<<next_report)) == 0);
 
-					while (!usbInterruptIsReady())
-					{
-						usbPoll();
-						wdt_reset();
-					}
+			if (packed)
+				len = buildPackedReport(reportBuffer, curGamepad->buildReport);
+			else
+			{
+				len = curGamepad->buildReport(reportBuffer, next_report+1);
+				if (!isMouseReport(next_report+1))
+				{
+					remapApply(reportBuffer);
+#if USB_CFG_KEYBOARD
+					if (next_report == 0)
+						keyboardUpdate(reportBuffer);
+#endif
+					turboApply(reportBuffer, next_report+1);
 				}
 			}
-				
-			must_report = 0;
+			must_report &= ~(1<<next_report);
+			diagTrace(DIAG_TRACE_REPORT, next_report+1);
 
+			usbSetInterrupt(reportBuffer, len);
+			diagCount(DIAG_REPORTS);
+		}
+
+#if USB_CFG_KEYBOARD
+		keyboardTask();
+#endif
+
+		/* Diagnostics only when the input reports have nothing pending */
+		if (!must_report)
+			diagTask();
+
+		/* Nothing to do until the next poll tick or USB interrupt, both
+		 * wake the CPU up. Interrupts stay off from the test to the sleep
+		 * instruction so that a tick cannot slip in between. */
+		cli();
+		if (!mustPollController() && !usbRxLen && !(must_report && usbInterruptIsReady()))
+		{
+			sleep_enable();
+			sei();
+			sleep_cpu();
+			sleep_disable();
 		}
+		sei();
 	}
 }
 
@@ -64,6 +64,17 @@
 
 #define SNES_GET_DATA()	(SNES_DATA_PIN & SNES_DATA_BIT)
 
+/* Clock half period and latch pulse in us, as in the Famiclone adapter. The
+ * joystick's shift register takes far shorter pulses, a project may still
+ * override them in its usbconfig.h.
+ */
+#ifndef NSNES_HALF_US
+#define NSNES_HALF_US	1
+#endif
+#ifndef NSNES_LATCH_US
+#define NSNES_LATCH_US	12
+#endif
+
 /*********** prototypes *************/
 static char nsnesInit(void);
 static void nsnesUpdate(void);
@@ -116,17 +127,17 @@ static void nsnesUpdate(void)
 	unsigned int tmp=0;
 
 	SNES_LATCH_HIGH();
-	_delay_us(12);
+	_delay_us(NSNES_LATCH_US);
 	SNES_LATCH_LOW();
 
 	for (i=0; i<8; i++)
 	{
-		_delay_us(6);
+		_delay_us(NSNES_HALF_US);
 		SNES_CLOCK_LOW();
 		
 		if (!SNES_GET_DATA()) { tmp |= (1<<i); }
 
-		_delay_us(6);
+		_delay_us(NSNES_HALF_US);
 		SNES_CLOCK_HIGH();
 	}
 	last_update_state = tmp;
@@ -190,7 +201,7 @@ const char nsnes_usbHidReportDescriptor[] PROGMEM = {
     0x15, 0x00,                    //     LOGICAL_MINIMUM (0)
     0x26, 0xff, 0x00,              //     LOGICAL_MAXIMUM (255)
     0x75, 0x08,                    //     REPORT_SIZE (8)
-    0x95, 0x01,                    //     REPORT_COUNT (1)
+    0x95, 0x08,                    //     REPORT_COUNT (8)
     0xb2, 0x02, 0x01,              //     FEATURE (Data,Var,Abs,Buf)	
     0xc0,                          //   END_COLLECTION
     0xc0                           // END_COLLECTION
@@ -222,7 +233,11 @@ Gamepad nsnesGamepad = {
 	.init					= nsnesInit,
 	.update					= nsnesUpdate,
 	.changed				= nsnesChanged,
-	.buildReport			= nsnesBuildReport
+	.buildReport			= nsnesBuildReport,
+	.buttons_offset			= 2,
+	.axes_offset			= 0,
+	.axes_count				= 2,
+	.buttons_count			= 8
 };
 
 Gamepad *nsnesGetGamepad(void)
@@ -0,0 +1,80 @@
+/* Button remapping through precompiled lookup tables
+ * Copyright (C) 2024 Francis-Olivier Gradel, B.Eng.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * The author may be contacted at info@retronicdesign.com
+ *
+ */
+#include <string.h>
+#include "config.h"
+#include "remap.h"
+
+/* config.remap is only looked at when it changes. It is turned into one
+ * table per nibble of the button bytes, giving the output bits set by each
+ * of the 16 values of that nibble. Remapping a report is then a fixed
+ * number of lookups and ORs, the identity mapping included.
+ */
+static unsigned char table[CFG_REMAP_SIZE/4][16][CFG_REMAP_SIZE/8];
+static unsigned char remap_offset;
+static unsigned char remap_count;
+
+void remapInit(unsigned char offset, unsigned char count)
+{
+	remap_offset = offset;
+	remap_count = (count < CFG_REMAP_SIZE) ? count : CFG_REMAP_SIZE;
+
+	remapCompile();
+}
+
+void remapCompile(void)
+{
+	unsigned char i, v, out;
+
+	memset(table, 0, sizeof(table));
+
+	for (i=0; i<remap_count; i++)
+	{
+		out = config.remap[i];
+		if (out >= remap_count)	// Dropped button
+			continue;
+
+		for (v=0; v<16; v++)
+			if (v & (1<<(i&3)))
+				table[i>>2][v][out>>3] |= 1<<(out&7);
+	}
+}
+
+void remapApply(unsigned char *report)
+{
+	unsigned char b0, b1;
+
+	if (!remap_count)
+		return;
+
+	report += remap_offset;
+	b0 = report[0];
+
+	if (remap_count <= 8)
+	{
+		report[0] = table[0][b0&0x0f][0] | table[1][b0>>4][0];
+	}
+	else
+	{
+		b1 = report[1];
+		report[0] = table[0][b0&0x0f][0] | table[1][b0>>4][0] | table[2][b1&0x0f][0] | table[3][b1>>4][0];
+		report[1] = table[0][b0&0x0f][1] | table[1][b0>>4][1] | table[2][b1&0x0f][1] | table[3][b1>>4][1];
+	}
+}
@@ -0,0 +1,220 @@
+/* USB suspend and remote wakeup
+ * Copyright (C) 2024 Francis-Olivier Gradel, B.Eng.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * The author may be contacted at info@retronicdesign.com
+ *
+ */
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+#include <avr/power.h>
+#include <avr/eeprom.h>
+#include <util/delay.h>
+
+#include "usbdrv/usbdrv.h"
+#include "suspend.h"
+
+#define USB_MASK	((1<<PD0)|(1<<PD2))		// D-, D+
+#define USB_IDLE	(1<<PD0)				// J state, low speed: D- high, D+ low
+
+static unsigned char disabled;
+static unsigned char shared;				// The driver's PCINT2 handler calls suspendBusEdge()
+static volatile unsigned char bus_edge;
+static unsigned char idle_ticks;
+static unsigned char remote_wakeup;		// Set by the host, cleared on bus reset
+
+/* Only there to wake the CPU up. Weak: a driver using these vectors keeps its
+ * own handler, its pins changing wake us just the same. */
+ISR(PCINT0_vect, ISR_NAKED __attribute__((weak)))
+{
+	reti();
+}
+
+ISR(PCINT1_vect, ISR_NAKED __attribute__((weak)))
+{
+	reti();
+}
+
+ISR(PCINT2_vect, ISR_NAKED __attribute__((weak)))
+{
+	reti();
+}
+
+void suspendSharePCINT2(void)
+{
+	shared = 1;
+}
+
+void suspendBusEdge(void)
+{
+	bus_edge = 1;
+}
+
+void suspendInit(void)
+{
+	// Taken by the controller driver, enabling D- would flood its handler
+	// unless the handler passes the changes on
+	disabled = (PCICR & (1<<PCIE2)) && !shared;
+	if (disabled)
+		return;
+
+	PCMSK2 |= (1<<PCINT16);
+	PCIFR = (1<<PCIF2);
+	bus_edge = 0;
+	idle_ticks = 0;
+}
+
+unsigned char suspendTask(void)
+{
+	if (disabled)
+		return 0;
+
+	// With a shared PCINT2, the handler clears the flag and sets bus_edge
+	if ((PCIFR & (1<<PCIF2)) || bus_edge)
+	{
+		PCIFR = (1<<PCIF2);
+		bus_edge = 0;
+		idle_ticks = 0;
+		return 0;
+	}
+
+	// Before SET_CONFIGURATION the host is free to leave us alone
+	if (!usbConfiguration)
+		return 0;
+
+	if (idle_ticks < SUSPEND_IDLE_TICKS)
+		idle_ticks++;
+
+	return idle_ticks >= SUSPEND_IDLE_TICKS;
+}
+
+/* Resume signaling, USB spec 7.1.7.7: K state for 1 to 15ms. The host then
+ * drives the resume itself and starts the keep-alives again. */
+static void suspendSignalResume(void)
+{
+	cli();
+	PORTD = (PORTD & ~(1<<PD0)) | (1<<PD2);	// K: D+ high, D- low
+	DDRD |= USB_MASK;
+	_delay_ms(10);
+	DDRD &= ~USB_MASK;
+	PORTD &= ~USB_MASK;
+	USB_INTR_PENDING = 1<<USB_INTR_PENDING_BIT;	// Our own D+ edge, not a packet
+	sei();
+}
+
+void suspendSleep(void)
+{
+	unsigned char pcicr = PCICR, pcmsk0 = PCMSK0, pcmsk1 = PCMSK1, pcmsk2 = PCMSK2, timsk2 = TIMSK2;
+	unsigned char wakeb, wakec, waked, pinb, pinc, pind, woken = 0;
+
+	/* Buttons are the inputs with a pull-up. The pot inputs have none, they
+	 * drift while their capacitor charges and would keep waking us up, and
+	 * the pins of the driver's own pin change interrupts (a roller, pots)
+	 * would wake the CPU at every edge. The controller lines are left as
+	 * they are: outputs at their idle level, the controller powered so that
+	 * its buttons can wake the host. */
+	wakeb = PORTB & ~DDRB & ~pcmsk0;
+	wakec = PORTC & ~DDRC & 0x3f & ~pcmsk1;
+	waked = PORTD & ~DDRD & ~USB_MASK & ~pcmsk2;
+
+	eeprom_busy_wait();	// configTask() resumes where it was after wakeup
+
+	while (!woken)
+	{
+		cli();
+		pinb = PINB;
+		pinc = PINC;
+		pind = PIND;
+
+		// Host resume (K) or bus reset (SE0) on either line
+		PCMSK0 = 0;
+		PCMSK1 = 0;
+		PCMSK2 = (1<<PCINT16)|(1<<PCINT18);
+		if (remote_wakeup)
+		{
+			PCMSK0 = wakeb;
+			PCMSK1 = wakec;
+			PCMSK2 |= waked;
+		}
+		PCIFR = (1<<PCIF0)|(1<<PCIF1)|(1<<PCIF2);
+		PCICR = (1<<PCIE0)|(1<<PCIE1)|(1<<PCIE2);
+
+		/* WDTON (fuses.h) keeps the watchdog running in reset mode: it can
+		 * neither be stopped nor wake us up, and power-down has no other
+		 * timer. The CPU idles at F_CPU/256 instead, timer 2 keeps going
+		 * and its poll tick wakes us every ~150ms to reset the watchdog.
+		 * V-USB would not make sense of a packet at that clock. */
+		USB_INTR_ENABLE &= ~(1<<USB_INTR_ENABLE_BIT);
+		TIFR2 = (1<<OCF2A);
+		TIMSK2 = timsk2 | (1<<OCIE2A);
+		clock_prescale_set(clock_div_256);
+		wdt_reset();
+
+		set_sleep_mode(SLEEP_MODE_IDLE);
+		sleep_enable();
+		sei();	// The next instruction still runs, no wakeup is lost
+		sleep_cpu();
+		sleep_disable();
+
+		cli();
+		clock_prescale_set(clock_div_1);
+		wdt_reset();
+		// Our wake pins must not reach the driver's handlers as its edges
+		PCIFR = (1<<PCIF0)|(1<<PCIF1)|(1<<PCIF2);
+		PCICR = pcicr;
+		PCMSK0 = pcmsk0;
+		PCMSK1 = pcmsk1;
+		PCMSK2 = pcmsk2;
+		TIMSK2 = timsk2;
+		USB_INTR_PENDING = 1<<USB_INTR_PENDING_BIT;	// Bus states seen while asleep
+		USB_INTR_ENABLE |= (1<<USB_INTR_ENABLE_BIT);
+		sei();
+
+		if ((PIND & USB_MASK) != USB_IDLE)
+		{
+			// The host got there first
+			woken = 1;
+		}
+		else if (remote_wakeup && (((PINB ^ pinb) & wakeb) | ((PINC ^ pinc) & wakec) | ((PIND ^ pind) & waked)))
+		{
+			// At least 1.3ms of oscillator startup on top of the 3ms it
+			// took to detect the suspend: the 5ms of idle bus required
+			// before signaling are over.
+			suspendSignalResume();
+			woken = 1;
+		}
+		// Otherwise timer 2, a button gone back to where it was, or a glitch
+	}
+
+	PCIFR = (1<<PCIF2);
+	idle_ticks = 0;
+}
+
+void suspendRxHook(unsigned char *data)
+{
+	usbRequest_t *rq = (void *)data;
+
+	// Standard requests to the device
+	if (usbRxToken != (uchar)USBPID_SETUP || rq->bmRequestType != 0)
+		return;
+
+	if (rq->bRequest == USBRQ_SET_ADDRESS)	// First request after a bus reset
+		remote_wakeup = 0;
+	else if ((rq->bRequest == USBRQ_SET_FEATURE || rq->bRequest == USBRQ_CLEAR_FEATURE) && rq->wValue.bytes[0] == USB_FEATURE_REMOTE_WAKEUP)
+		remote_wakeup = (rq->bRequest == USBRQ_SET_FEATURE);
+}
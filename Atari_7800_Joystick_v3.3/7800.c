@@ -27,6 +27,7 @@
 #include <string.h>
 #include "usbconfig.h"
 #include "7800.h"
+#include "debounce.h"
 
 static char Atari7800Init(void);
 static void Atari7800Update(void);
@@ -36,6 +37,8 @@ static char Atari7800BuildReport(unsigned char *reportBuffer, char id);
 static unsigned char last_update_state=0;
 static unsigned char last_reported_state=0;
 
+static Debouncer debouncer;
+
 static char Atari7800Init(void)
 {
 
@@ -61,12 +64,15 @@ static char Atari7800Init(void)
 	DDRD |= (1<<PD7);
 	PORTD &= ~(1<<PD7);
 
+	debounceInit(&debouncer, 0xff);
+
 	return 0;
 }
 
 static void Atari7800Update(void)
 {
-	last_update_state = ((PINB&0x0F)|((PINC&0x0C)<<2));
+	// Buttons are active high, flip them so that 0 = pressed for the debouncer
+	last_update_state = debounce(&debouncer, ((PINB&0x0F)|((PINC&0x0C)<<2)) ^ 0x30) ^ 0x30;
 }
 
 static char Atari7800Changed(char id)
@@ -130,7 +136,7 @@ const char Atari7800_usbHidReportDescriptor[] PROGMEM = {
     0x15, 0x00,                    //     LOGICAL_MINIMUM (0)
     0x26, 0xff, 0x00,              //     LOGICAL_MAXIMUM (255)
     0x75, 0x08,                    //     REPORT_SIZE (8)
-    0x95, 0x01,                    //     REPORT_COUNT (1)
+    0x95, 0x08,                    //     REPORT_COUNT (8)
     0xb2, 0x02, 0x01,              //     FEATURE (Data,Var,Abs,Buf)	
     0xc0,                          //   END_COLLECTION
     0xc0                           // END_COLLECTION
@@ -165,6 +171,10 @@ Gamepad Atari7800Joy = {
 	.update					=	Atari7800Update,
 	.changed				=	Atari7800Changed,
 	.buildReport			=	Atari7800BuildReport,
+	.buttons_offset			=	2,
+	.buttons_count			=	8,
+	.axes_offset			=	0,
+	.axes_count				=	2,
 };
 
 Gamepad *Atari7800GetGamepad(void)
@@ -0,0 +1,116 @@
+#ifndef _config_h__
+#define _config_h__
+
+#include "usbconfig.h"
+
+/* Layout version of the Config structure. Fields are only ever appended,
+ * so a record saved by an older firmware still loads: the missing tail
+ * keeps its default value. */
+#define CONFIG_VERSION		6
+
+/* The adapters expose an 8 byte feature report. Its first byte selects the
+ * command, 0x5A (jump to bootloader) being handled by main.c. Drivers using
+ * report IDs give the feature report an ID of its own (feature_report_id in
+ * gamepad.h), main.c strips it and the payload shrinks to 7 bytes.
+ *
+ * The firmware takes a SET_REPORT shorter than the report, and one sent
+ * with report ID 0 has no ID in front whatever the descriptor. So the 1 byte
+ * 0x5A of the v3.2 tools still works on Linux and macOS, in every mode.
+ * Windows' HidD_SetFeature() only takes a buffer of the declared size: a
+ * tool written for the 1 byte report of v3.2 must send 0x5A followed by
+ * zeros, 8 bytes after the report ID byte (7 when the descriptor has an ID).
+ *
+ * SET_REPORT(Feature):
+ *   CFG_CMD_READ     [cmd, offset]               select what GET_REPORT returns
+ *   CFG_CMD_WRITE    [cmd, offset, 6 data bytes] change the RAM copy, refused
+ *                                                (STALL) if a field goes out
+ *                                                of range, see configValid()
+ *   CFG_CMD_SAVE     [cmd]                       persist the RAM copy in EEPROM
+ *   CFG_CMD_DEFAULTS [cmd]                       back to the built-in defaults
+ * GET_REPORT(Feature):
+ *   [CONFIG_VERSION, sizeof(Config), offset, 5 data bytes from offset]
+ *   From CFG_BOOT_TIME_OFFSET on, a BOOT_TIMING build returns boot_stamps
+ *   (boottime.h) instead of 0xff.
+ */
+#define CFG_FEATURE_SIZE	8
+#define CFG_CMD_BOOTLOADER	0x5A
+#define CFG_CMD_READ		0xC0
+#define CFG_CMD_WRITE		0xC1
+#define CFG_CMD_SAVE		0xC2
+#define CFG_CMD_DEFAULTS	0xC3
+#define CFG_BOOT_TIME_OFFSET	0xE0
+#define CFG_WRITE_REFUSED	0xff	// configFeatureWrite(), the RAM copy is unchanged
+
+/* Defaults, a project may override them in its usbconfig.h */
+#ifndef CFG_DEFAULT_CENTER
+#define CFG_DEFAULT_CENTER	0x80	// Idle value of the digital axes
+#endif
+#ifndef CFG_DEFAULT_DIVIDER
+#define CFG_DEFAULT_DIVIDER	1		// Pot timer counts per axis unit
+#endif
+#ifndef CFG_DEFAULT_GAIN
+#define CFG_DEFAULT_GAIN	100		// Analog axis gain in percent
+#endif
+
+#define CFG_REMAP_SIZE		16		// Buttons that can be remapped, see remap.h
+#define CFG_REMAP_DROP		0xff
+
+#ifndef CFG_DEFAULT_TURBO_RATE
+#define CFG_DEFAULT_TURBO_RATE	10	// Autofire rate in Hz, see turbo.h
+#endif
+#ifndef CFG_DEFAULT_TURBO_DUTY
+#define CFG_DEFAULT_TURBO_DUTY	50	// Autofire pressed time in percent
+#endif
+#define CFG_TURBO_RATE_MAX	30		// A game reading the pad at 60Hz sees no more
+
+#define CFG_KEYMAP_SIZE		(4+CFG_REMAP_SIZE)	// Directions, then buttons, see keyboard.h
+
+/* HID key of each input: up, down, left, right, then the buttons in report
+ * order. The ones not listed are 0, no key. */
+#ifndef CFG_DEFAULT_KEYMAP	// Arrows, Enter, Escape, Space, Backspace
+#define CFG_DEFAULT_KEYMAP	0x52, 0x51, 0x50, 0x4f, 0x28, 0x29, 0x2c, 0x2a
+#endif
+
+/* A GET_REPORT(Input) arriving when the controller is due to be read reads
+ * it first, instead of returning the state of the previous poll. The
+ * interval between two reads stays the same. */
+#ifndef CFG_DEFAULT_GET_REPORT_POLL
+#define CFG_DEFAULT_GET_REPORT_POLL	0
+#endif
+
+/* A multitap sends all its controllers in one report (pack.h) instead of
+ * one report ID each. The descriptor changes with it, so a new value takes
+ * effect at the next start. */
+#ifndef CFG_DEFAULT_PACK_REPORTS
+#define CFG_DEFAULT_PACK_REPORTS	0
+#endif
+
+typedef struct {
+	unsigned char center;
+	unsigned char divider;
+	unsigned char gain;
+	unsigned char remap[CFG_REMAP_SIZE];	// Report button i goes to button remap[i], CFG_REMAP_DROP drops it
+	unsigned char turbo_mask[CFG_REMAP_SIZE/8];	// Autofire buttons, after remapping
+	unsigned char turbo_rate;	// 1 to CFG_TURBO_RATE_MAX
+	unsigned char turbo_duty;	// 1 to 99
+	unsigned char keymap[CFG_KEYMAP_SIZE];	// HID key 0 (none) to 0x65 or a modifier 0xE0-0xE7, see USB_CFG_KEYBOARD
+	unsigned char get_report_poll;	// Non zero: GET_REPORT may read the controller
+	unsigned char pack_reports;	// Non zero: one report for a multitap, see pack.h
+} Config;
+
+/* RAM copy, loaded once at boot. This is the only copy the drivers read. */
+extern Config config;
+
+void configInit(void);
+
+/* \brief Background EEPROM writer, call from the main loop. Never blocks. */
+void configTask(void);
+
+/* return Non zero if the RAM copy was modified, CFG_WRITE_REFUSED if the
+ * command was refused */
+unsigned char configFeatureWrite(unsigned char *data, unsigned char len);
+
+/* return The number of bytes written to buf (size) */
+unsigned char configFeatureRead(unsigned char *buf, unsigned char size);
+
+#endif // _config_h__
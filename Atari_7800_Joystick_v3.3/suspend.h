@@ -0,0 +1,51 @@
+#ifndef _suspend_h__
+#define _suspend_h__
+
+/* USB suspend and remote wakeup.
+ *
+ * V-USB leaves suspend to the application. The host sends a keep-alive
+ * (a low-speed EOP) every millisecond, each one toggles D-. D- is PD0 on
+ * these adapters, PCINT16: its pin change flag is polled, never taken as an
+ * interrupt, so V-USB's interrupt latency does not change. A configured
+ * device that sees no activity for 3ms has been suspended by the host.
+ *
+ * The Apple II driver owns the PCINT2 interrupt for its pots. Its handler
+ * passes the D- changes on with suspendBusEdge(), any other driver owning
+ * PCINT2 never suspends.
+ */
+
+/* Poll ticks (~0.6ms, timer 2) without bus activity before sleeping. Ticks
+ * can be served late, 6 of them always cover 3ms. */
+#define SUSPEND_IDLE_TICKS	6
+
+#define USB_FEATURE_REMOTE_WAKEUP	1	// USB spec 9.4, DEVICE_REMOTE_WAKEUP feature selector
+
+/* Call after the controller init(), it tells if PCINT2 is free. */
+void suspendInit(void);
+
+/* \brief Call from the driver's init() when its PCINT2 handler calls
+ * suspendBusEdge(): PCINT16 is then enabled along with its own pins. */
+void suspendSharePCINT2(void);
+
+/* \brief Bus activity seen by a driver's PCINT2 handler, for a change that
+ * is not on its own pins. */
+void suspendBusEdge(void);
+
+/* \brief Call at every poll tick.
+ * return Non zero if the bus is suspended
+ */
+unsigned char suspendTask(void);
+
+/* \brief Sleep until the host resumes or resets the bus. When the host
+ * allowed it, a button press wakes the host up first. The pin changes the
+ * driver enabled (a roller, pots) are masked meanwhile. The CPU idles on a
+ * divided clock, the timer 2 compare A interrupt (the poll tick) wakes it to
+ * reset the watchdog: its handler must exist. Interrupts must be enabled.
+ */
+void suspendSleep(void);
+
+/* Watches SET/CLEAR_FEATURE(DEVICE_REMOTE_WAKEUP), which V-USB ignores.
+ * Called from USB_RX_USER_HOOK (usbconfig.h) for every received packet. */
+void suspendRxHook(unsigned char *data);
+
+#endif // _suspend_h__
@@ -27,6 +27,8 @@
 #include <string.h>
 #include "usbconfig.h"
 #include "ataristyle.h"
+#include "debounce.h"
+#include "config.h"
 
 static char atariStyleInit(void);
 static void atariStyleUpdate(void);
@@ -36,6 +38,8 @@ static char atariStyleBuildReport(unsigned char *reportBuffer, char id);
 static unsigned char last_update_state=0;
 static unsigned char last_reported_state=0;
 
+static Debouncer debouncer;
+
 static char atariStyleInit(void)
 {
 	/* PB0   = PIN1 = UP 	(I,1)
@@ -59,12 +63,14 @@ static char atariStyleInit(void)
 	DDRC &= ~((1<<PC0)|(1<<PC1)|(1<<PC2)|(1<<PC3));
 	PORTC |= ((1<<PC0)|(1<<PC1)|(1<<PC2)|(1<<PC3));
 
+	debounceInit(&debouncer, 0xff);
+
 	return 0;
 }
 
 static void atariStyleUpdate(void)
 {
-	last_update_state = ((PINB&0x1F) | ((PINC&0x0C)<<3));
+	last_update_state = debounce(&debouncer, ((PINB&0x1F) | ((PINC&0x0C)<<3)));
 }
 
 static char atariStyleChanged(char id)
@@ -81,7 +87,7 @@ static char atariStyleBuildReport(unsigned char *reportBuffer, char id)
 	
 	if (reportBuffer)
 	{
-		y = x = 0x7f;
+		y = x = config.center;
 
 		tmp = last_update_state ^ 0xff;
 		
@@ -129,7 +135,7 @@ const char atariStyle_usbHidReportDescriptor[] PROGMEM = {
     0x15, 0x00,                    //     LOGICAL_MINIMUM (0)
     0x26, 0xff, 0x00,              //     LOGICAL_MAXIMUM (255)
     0x75, 0x08,                    //     REPORT_SIZE (8)
-    0x95, 0x01,                    //     REPORT_COUNT (1)
+    0x95, 0x08,                    //     REPORT_COUNT (8)
     0xb2, 0x02, 0x01,              //     FEATURE (Data,Var,Abs,Buf)	
     0xc0,                          //   END_COLLECTION
     0xc0                           // END_COLLECTION
@@ -164,6 +170,10 @@ Gamepad atariStyleJoy = {
 	.update					=	atariStyleUpdate,
 	.changed				=	atariStyleChanged,
 	.buildReport			=	atariStyleBuildReport,
+	.buttons_offset			=	2,
+	.buttons_count			=	8,
+	.axes_offset			=	0,
+	.axes_count				=	2,
 };
 
 Gamepad *atariStyleGetGamepad(void)
@@ -65,7 +65,20 @@ rename it to "usbconfig.h". Then edit it accordingly.
 /* Define this to 1 if you want to compile a version with two endpoints: The
  * default control endpoint 0 and an interrupt-in endpoint 1.
  */
-#define USB_CFG_HAVE_INTRIN_ENDPOINT3   0
+#ifndef USB_CFG_KEYBOARD
+#define USB_CFG_KEYBOARD                0
+#endif
+/* Define this to 1 to add a boot keyboard interface fed by the joystick,
+ * see keyboard.h. It takes endpoint 3.
+ */
+#ifndef USB_CFG_DIAGNOSTICS
+#define USB_CFG_DIAGNOSTICS             0
+#endif
+/* Define this to 1 to add a vendor-defined HID interface streaming counters,
+ * traces and timings, see diag.h. It also takes endpoint 3: build either
+ * this or the keyboard.
+ */
+#define USB_CFG_HAVE_INTRIN_ENDPOINT3   (USB_CFG_KEYBOARD || USB_CFG_DIAGNOSTICS)
 /* Define this to 1 if you want to compile a version with three endpoints: The
  * default control endpoint 0, an interrupt-in endpoint 1 and an interrupt-in
  * endpoint 3. You must also enable endpoint 1 above.
@@ -115,7 +128,10 @@ rename it to "usbconfig.h". Then edit it accordingly.
  * of the macros usbDisableAllRequests() and usbEnableAllRequests() in
  * usbdrv.h.
  */
-/* #define USB_RX_USER_HOOK(data, len)     if(usbRxToken == (uchar)USBPID_SETUP) blinkLED(); */
+#ifndef __ASSEMBLER__
+extern void suspendRxHook(unsigned char *data);
+#endif
+#define USB_RX_USER_HOOK(data, len)     suspendRxHook(data);
 /* This macro is a hook if you want to do unconventional things. If it is
  * defined, it's inserted at the beginning of received message processing.
  * If you eat the received message and don't want default processing to
@@ -271,4 +287,8 @@ rename it to "usbconfig.h". Then edit it accordingly.
 /* #define USB_INTR_PENDING_BIT    INTF0 */
 /* #define USB_INTR_VECTOR         SIG_INTERRUPT0 */
 
+/* ----------------------- Adapter configuration ------------------------ */
+
+#define CFG_DEFAULT_CENTER      0x7f    /* TheC64 wants 0x7f as the idle axis value */
+
 #endif /* __usbconfig_h_included__ */
@@ -0,0 +1,67 @@
+/* Vertical counter debouncer for active-low digital inputs
+ * Copyright (C) 2024 Francis-Olivier Gradel, B.Eng.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * The author may be contacted at info@retronicdesign.com
+ *
+ */
+#include "debounce.h"
+
+/* Each input owns a 2 bit down counter spread over cnt1:cnt0 ("vertical"
+ * counter), so the 8 inputs of a port are filtered with a handful of
+ * bitwise operations instead of a loop.
+ *
+ * A press (1->0) goes through on the very first sample, so the press latency
+ * is unchanged. A pressed input that reads released counts down from
+ * DEBOUNCE_RELEASE_SAMPLES-1 and is only released when the counter is
+ * exhausted. Any sample reading pressed again reloads the counter, so the
+ * bounce of the contact, both on press and on release, never reaches
+ * changed() and costs no extra USB report.
+ */
+#define RELOAD	(DEBOUNCE_RELEASE_SAMPLES-1)
+#define RELOAD0	((RELOAD&1) ? 0xff : 0x00)
+#define RELOAD1	((RELOAD&2) ? 0xff : 0x00)
+
+void debounceInit(Debouncer *db, unsigned char sample)
+{
+	db->state = sample;
+	db->cnt0 = RELOAD0;
+	db->cnt1 = RELOAD1;
+}
+
+unsigned char debounce(Debouncer *db, unsigned char sample)
+{
+	unsigned char releasing, expired, c0, c1;
+
+	// Presses are taken right away
+	db->state &= sample;
+
+	// Pressed inputs reading released
+	releasing = sample & ~db->state;
+
+	c0 = db->cnt0;
+	c1 = db->cnt1;
+
+	// Counter already at 0 and still released: accept the release
+	expired = releasing & ~(c0 | c1);
+	db->state |= expired;
+
+	// Count down the releasing inputs, reload all the others
+	db->cnt0 = (~c0 & releasing) | (RELOAD0 & ~releasing);
+	db->cnt1 = ((c1 ^ ~c0) & releasing) | (RELOAD1 & ~releasing);
+
+	return db->state;
+}
@@ -28,13 +28,10 @@
 #include <string.h>
 #include "usbconfig.h"
 #include "ataripaddles.h"
+#include "config.h"
 
 #define SETUPDELAY 50	// Time to reset the capacitor back to GND
-#ifdef Atari
-	#define DIVIDER 6		// Divider of the read value to match with 0-255 (Atari Paddles 1Mohm)
-#else //Commodore
-	#define DIVIDER 12	// Divider of the read value to match with 0-255 (C64 Paddles 470Kohm)
-#endif
+#define DIVIDER config.divider	// Divider of the read value to match with 0-255, see CFG_DEFAULT_DIVIDER
 
 void mux(char);
 void resetport(char);
@@ -76,7 +73,7 @@ static char atariPaddlesInit(void)
 	DDRC &= ~((1<<PC0)|(1<<PC1));
 	PORTC &= ~((1<<PC0)|(1<<PC1));
 
-	TCCR1B |= ((1<<CS12));// CPU/256 @ 12MHz = 46.875khz
+	TCCR1B = ((1<<CS12));// CPU/256 @ 12MHz = 46.875khz
 
 	old_channel[0]=channel[0]=0;
 	old_channel[1]=channel[1]=0;
@@ -188,7 +185,7 @@ const char atariPaddles_usbHidReportDescriptor[] PROGMEM = {
     0x15, 0x00,                    //     LOGICAL_MINIMUM (0)
     0x26, 0xff, 0x00,              //     LOGICAL_MAXIMUM (255)
     0x75, 0x08,                    //     REPORT_SIZE (8)
-    0x95, 0x01,                    //     REPORT_COUNT (1)
+    0x95, 0x08,                    //     REPORT_COUNT (8)
     0xb2, 0x02, 0x01,              //     FEATURE (Data,Var,Abs,Buf)
     0xc0,                          //   END_COLLECTION
     0xc0                           // END_COLLECTION
@@ -224,6 +221,8 @@ Gamepad atariPaddlesJoy = {
 	.update					=	atariPaddlesUpdate,
 	.changed				=	atariPaddlesChanged,
 	.buildReport			=	atariPaddlesBuildReport,
+	.buttons_offset			=	2,
+	.buttons_count			=	8,
 };
 
 Gamepad *atariPaddlesGetGamepad(void)
@@ -198,7 +198,7 @@ const char AtariDriving_usbHidReportDescriptor[] PROGMEM = {
     0x15, 0x00,         //          LOGICAL_MINIMUM (0)
     0x26, 0xff, 0x00,   //          LOGICAL_MAXIMUM (255)
     0x75, 0x08,         //          REPORT_SIZE (8)
-    0x95, 0x01,         //          REPORT_COUNT (1)
+    0x95, 0x08,         //          REPORT_COUNT (8)
     0xb2, 0x02, 0x01,   //          FEATURE (Data,Var,Abs,Buf)	
     0xc0                           // END_COLLECTION
 };
@@ -232,6 +232,8 @@ Gamepad AtariDrivingJoy = {
 	.update					=	AtariDrivingUpdate,
 	.changed				=	AtariDrivingChanged,
 	.buildReport			=	AtariDrivingBuildReport,
+	.buttons_offset			=	1,
+	.buttons_count			=	8,
 };
 
 Gamepad *AtariDrivingGetGamepad(void)
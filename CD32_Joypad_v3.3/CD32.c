@@ -189,7 +189,7 @@ const char CD32_usbHidReportDescriptor[] PROGMEM = {
     0x15, 0x00,         //          LOGICAL_MINIMUM (0)
     0x26, 0xff, 0x00,   //          LOGICAL_MAXIMUM (255)
     0x75, 0x08,         //          REPORT_SIZE (8)
-    0x95, 0x01,         //          REPORT_COUNT (1)
+    0x95, 0x08,         //          REPORT_COUNT (8)
     0xb2, 0x02, 0x01,   //          FEATURE (Data,Var,Abs,Buf)	
 	0xc0,				//		END_COLLECTION
     0xc0,				// END_COLLECTION
@@ -224,6 +224,10 @@ Gamepad CD32Joy = {
 	.update					=	CD32Update,
 	.changed				=	CD32Changed,
 	.buildReport			=	CD32BuildReport,
+	.buttons_offset			=	2,
+	.buttons_count			=	8,
+	.axes_offset			=	0,
+	.axes_count				=	2,
 };
 
 Gamepad *CD32GetGamepad(void)
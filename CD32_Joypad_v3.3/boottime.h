@@ -0,0 +1,38 @@
+#ifndef _boottime_h__
+#define _boottime_h__
+
+#include <avr/io.h>
+#include "usbconfig.h"
+
+/* Power-on to enumeration, measured on the adapter. The bootloader waits
+ * 100ms for the levels to settle, then main() fakes a USB disconnect before
+ * usbInit(), and the host starts its own 100ms wait over. Define BOOT_TIMING
+ * in usbconfig.h to see where the rest of the time goes.
+ */
+
+/* Stages, in the order main() goes through them */
+#define BOOT_STAGE_DETECT		0	// Controller detected, report descriptor chosen
+#define BOOT_STAGE_HARDWARE		1	// hardwareInit() done
+#define BOOT_STAGE_INIT			2	// Driver init() done
+#define BOOT_STAGE_USB			3	// usbInit(), interrupts on
+#define BOOT_STAGE_DESCRIPTOR	4	// First descriptor request, the host reset the bus
+#define BOOT_STAGE_CONFIGURED	5	// First HID class request, the host driver is bound
+#define BOOT_STAGES				6
+
+#ifdef BOOT_TIMING
+/* Timer1 counts CPU/1024 (85us at 12MHz) from main() on. The drivers using
+ * Timer1 themselves set TCCR1B whole and restart it, only the stages before
+ * their init() count there.
+ * The stamps are read back with CFG_CMD_READ from CFG_BOOT_TIME_OFFSET on.
+ */
+extern unsigned int boot_stamps[BOOT_STAGES];
+
+#define bootTimeStart()		do { TCCR1A = 0; TCNT1 = 0; TCCR1B = (1<<CS12)|(1<<CS10); } while(0)
+// Always odd, 0 is a stage not reached yet
+#define bootStamp(stage)	do { if (!boot_stamps[stage]) boot_stamps[stage] = TCNT1|1; } while(0)
+#else
+#define bootTimeStart()
+#define bootStamp(stage)
+#endif
+
+#endif // _boottime_h__
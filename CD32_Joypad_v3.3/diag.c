@@ -0,0 +1,147 @@
+/* Diagnostics stream on its own interrupt endpoint
+ * Copyright (C) 2024 Francis-Olivier Gradel, B.Eng.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * The author may be contacted at info@retronicdesign.com
+ *
+ */
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <string.h>
+#include "usbdrv/usbdrv.h"
+#include "diag.h"
+
+#if USB_CFG_DIAGNOSTICS
+
+#define TRACE_SIZE	8	// Events, a power of 2
+
+const char diag_usbHidReportDescriptor[] PROGMEM = {
+    0x06, 0x00, 0xff,              // USAGE_PAGE (Vendor Defined Page 1)
+    0x09, 0x01,                    // USAGE (Vendor Usage 1)
+    0xa1, 0x01,                    // COLLECTION (Application)
+    0x15, 0x00,                    //   LOGICAL_MINIMUM (0)
+    0x26, 0xff, 0x00,              //   LOGICAL_MAXIMUM (255)
+    0x75, 0x08,                    //   REPORT_SIZE (8)
+    0x95, DIAG_REPORT_SIZE,        //   REPORT_COUNT (8)
+    0x09, 0x01,                    //   USAGE (Vendor Usage 1)
+    0x81, 0x02,                    //   INPUT (Data,Var,Abs)
+    0xc0                           // END_COLLECTION
+};
+
+// main.c puts the length in the configuration descriptor
+typedef char diag_descriptor_length[(sizeof(diag_usbHidReportDescriptor) == DIAG_REPORT_DESCRIPTOR_LENGTH) ? 1 : -1];
+
+unsigned int diag_counters[DIAG_COUNTERS];
+volatile unsigned char diag_overruns;	// Written by the poll tick interrupt, one byte
+volatile unsigned char diag_start[DIAG_TIMES];
+unsigned char diag_time[DIAG_TIMES][2];
+
+static unsigned char trace[TRACE_SIZE][3];	// id, arg, time
+static unsigned char trace_head;
+static unsigned char trace_tail;
+static unsigned char record[DIAG_REPORT_SIZE];
+static unsigned char seq;
+static unsigned char next_rec = DIAG_REC_COUNTERS;
+
+void diagTrace(unsigned char id, unsigned char arg)
+{
+	unsigned char *e = trace[trace_head];
+
+	e[0] = id;
+	e[1] = arg;
+	e[2] = TCNT0;
+
+	trace_head = (trace_head+1) & (TRACE_SIZE-1);
+	if (trace_head == trace_tail)	// Full, the oldest event goes
+		trace_tail = (trace_tail+1) & (TRACE_SIZE-1);
+}
+
+static void diagCounters(unsigned char *buf, unsigned char type, unsigned char first, unsigned char count)
+{
+	buf[0] = type;
+	memcpy(buf+2, &diag_counters[first], count*2);	// Little endian, as the host reads them
+}
+
+static void diagRecord(unsigned char *buf)
+{
+	unsigned char i;
+
+	memset(buf, 0, DIAG_REPORT_SIZE);
+
+	if (trace_head != trace_tail)	// Events first, the ring is small
+	{
+		buf[0] = DIAG_REC_TRACE;
+		for (i=2; i<DIAG_REPORT_SIZE && trace_head != trace_tail; i+=3)
+		{
+			memcpy(buf+i, trace[trace_tail], 3);
+			trace_tail = (trace_tail+1) & (TRACE_SIZE-1);
+		}
+	}
+	else switch (next_rec)
+	{
+		case DIAG_REC_COUNTERS:
+			diagCounters(buf, DIAG_REC_COUNTERS, DIAG_POLLS, 3);
+			next_rec = DIAG_REC_EVENTS;
+			break;
+
+		case DIAG_REC_EVENTS:
+			diagCounters(buf, DIAG_REC_EVENTS, DIAG_SETUPS, 2);
+			buf[6] = diag_overruns;
+			next_rec = DIAG_REC_TIMING;
+			break;
+
+		default:
+			buf[0] = DIAG_REC_TIMING;
+			memcpy(buf+2, diag_time, sizeof(diag_time));
+			for (i=0; i<DIAG_TIMES; i++)
+				diag_time[i][1] = 0;
+			next_rec = DIAG_REC_COUNTERS;
+			break;
+	}
+
+	buf[1] = seq++;
+}
+
+void diagTask(void)
+{
+	if (!usbInterruptIsReady3())	// Nobody reads, or the last record is still queued
+		return;
+
+	diagRecord(record);
+	usbSetInterrupt3(record, sizeof(record));
+}
+
+unsigned char diagSetup(unsigned char data[8])
+{
+	usbRequest_t *rq = (void *)data;
+
+	if ((rq->bmRequestType & USBRQ_TYPE_MASK) != USBRQ_TYPE_CLASS)
+		return 0;
+
+	// A control read gets the counters, it does not consume the stream
+	if (rq->bRequest == USBRQ_HID_GET_REPORT)
+	{
+		memset(record, 0, sizeof(record));
+		diagCounters(record, DIAG_REC_COUNTERS, DIAG_POLLS, 3);
+		record[1] = seq;
+		usbMsgPtr = record;
+		return sizeof(record);
+	}
+
+	return 0;
+}
+
+#endif // USB_CFG_DIAGNOSTICS
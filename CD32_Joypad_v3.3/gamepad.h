@@ -21,6 +21,36 @@ typedef struct {
 	 * return The number of bytes written to buf
 	 */
 	char (*buildReport)(unsigned char *buf, char id);
+
+	/**
+	 * Optional, leave NULL if buildReport() only marks the state as
+	 * reported. Same report as buildReport() for a GET_REPORT on the
+	 * control pipe, but consuming nothing: changed() answers as before
+	 * and the motion of a mouse stays for the next interrupt report.
+	 * return The number of bytes written to buf
+	 */
+	char (*peekReport)(unsigned char *buf, char id);
+
+	/* Where the button bitfield is in the reports built by buildReport(),
+	 * for remapping. Leave buttons_count at 0 if the reports have none.
+	 */
+	char buttons_offset;
+	char buttons_count;
+
+	/* Where the X and Y axes (one byte each, 0x80 at rest) are in report
+	 * ID 1, for the keyboard (keyboard.h). Leave axes_count at 0 if the
+	 * report has none, or axes that are not a stick.
+	 */
+	char axes_offset;
+	char axes_count;
+
+	/* Report ID of the feature report, 0 if the descriptor uses no report IDs */
+	char feature_report_id;
+
+	/* Report ID of a mouse report mixed in with game pad ones, 0 if none.
+	 * Remapping, autofire and the keyboard leave that report alone.
+	 */
+	char mouse_report_id;
 } Gamepad;
 
 #endif // _gamepad_h__
@@ -0,0 +1,40 @@
+#ifndef _chord_h__
+#define _chord_h__
+
+#include "usbconfig.h"
+
+/* Keypads sharing their lines with a disc or with fire buttons report a code,
+ * not one bit per key. While the contacts of a key close or open one after
+ * the other, the code goes through transient values that decode as another
+ * key or as a direction. A code only replaces the current state once it was
+ * read this many times in a row (taken at the driver's poll rate), so it
+ * adds CHORD_STABLE_SAMPLES-1 samples of latency to a clean press or
+ * release. 1 disables the filter.
+ */
+#ifndef CHORD_STABLE_SAMPLES
+#define CHORD_STABLE_SAMPLES	3
+#endif
+
+/* Codes the driver does not expect from a single control (or a control and
+ * a fire button), such as two keys at once, can only come from a chord or
+ * from rolling between keys. They need this many samples instead.
+ */
+#ifndef CHORD_COMBO_SAMPLES
+#define CHORD_COMBO_SAMPLES		16
+#endif
+
+typedef struct {
+	unsigned char state;		// last accepted code
+	unsigned char candidate;	// code being timed
+	unsigned char count;		// consecutive samples of candidate
+} ChordFilter;
+
+void chordInit(ChordFilter *cf, unsigned char code);
+
+/* \brief Filter one sample of a code.
+ * combo Non zero if the code is not one the controller sends for a single control
+ * return The accepted code
+ */
+unsigned char chordFilter(ChordFilter *cf, unsigned char code, unsigned char combo);
+
+#endif // _chord_h__
@@ -20,14 +20,24 @@
  * The author may be contacted at info@retronicdesign.com
  */
 #include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
 #include <util/delay.h>
 #include <avr/pgmspace.h>
 #include <string.h>
 #include "usbconfig.h"
 #include "colecovision.h"
+#include "chord.h"
 
 #define MULT 32	// Spinner sensitivity
 
+/* Timer2 poll ticks (~0.6ms each) a sub controller stays selected before
+ * it is read. A project may override it in its usbconfig.h.
+ */
+#ifndef COLECO_SETTLE_TICKS
+#define COLECO_SETTLE_TICKS	2
+#endif
+
 static char colecovisionInit(void);
 static void colecovisionUpdate(void);
 static char colecovisionChanged(char id);
@@ -38,6 +48,13 @@ static unsigned char last_reported_state[2]={0,0};
 
 volatile int wheel_pos;
 static unsigned char spinner, old_spinner;
+static unsigned char wheel_reported;
+static volatile unsigned char roller_busy, roller_again;
+
+static unsigned char phase=0;		// Sub controller selected, 0 or 1
+static unsigned char phase_ticks=0;	// update() calls since it was selected
+
+static ChordFilter keypad;
 
 int QEM [16] = {0,1,-1,2,-1,0,2,1,1,2,0,-1,2,-1,1,0};               // Quadrature Encoder Matrix
 /* QEM explanation:
@@ -85,6 +102,68 @@ int QEM [16] = {0,1,-1,2,-1,0,2,1,1,2,0,-1,2,-1,1,0};               // Quadratur
  */
 
 
+/* Quadrature A and B do not go through the sub controller select, they can
+ * be read at any time.
+ */
+static unsigned char colecovisionSpinner(void)
+{
+	return ((~PINB&(1<<PB5))>>5) | ((~PINC&(1<<PC2))>>1);
+}
+
+/* Roller and spinner, counted on every edge instead of once per scan so
+ * fast turns are not lost.
+ */
+static void colecovisionRoller(void)
+{
+	unsigned char done;
+
+	// Our interrupts run with interrupts enabled, an edge may come in while we
+	// are still counting the previous one: count it in the same pass.
+	if (roller_busy)
+	{
+		roller_again = 1;
+		return;
+	}
+	roller_busy = 1;
+
+	do {
+		roller_again = 0;
+		spinner = colecovisionSpinner();
+
+		// Apply delta displacement from quadrature generated by the spinner.
+		// Quad Format (4 bits): MSB OldB OldA ActualB ActualA LSB
+		wheel_pos += (QEM[(spinner|(old_spinner<<2))]*MULT);
+
+		// Clipping min and max position
+		if(wheel_pos>(int)255)
+			wheel_pos=255;
+
+		if(wheel_pos<(int)0)
+			wheel_pos=0;
+
+		old_spinner=spinner; // Old position = new position for next iteration.
+
+		// An edge after the test of roller_again but before roller_busy is
+		// cleared would be dropped, so both go together.
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			done = !roller_again;
+			if (done)
+				roller_busy = 0;
+		}
+	} while (!done);
+}
+
+ISR(PCINT0_vect, ISR_NOBLOCK)	// Keep V-USB interrupt latency low
+{
+	colecovisionRoller();
+}
+
+ISR(PCINT1_vect, ISR_NOBLOCK)
+{
+	colecovisionRoller();
+}
+
 static char colecovisionInit(void)
 {
 
@@ -112,56 +191,76 @@ static char colecovisionInit(void)
 	PORTD &= ~((1<<PD7));
 
 	/* Spinner, initial condition */
-	colecovisionUpdate();
+	old_spinner = colecovisionSpinner();
 	wheel_pos=0x80;
 
+	// Count the roller on both quadrature inputs: PB5 (PCINT5) and PC2 (PCINT10)
+	PCMSK0 |= (1<<PCINT5);
+	PCMSK1 |= (1<<PCINT10);
+	PCIFR = (1<<PCIF0)|(1<<PCIF1);
+	PCICR |= (1<<PCIE0)|(1<<PCIE1);
+
+	chordInit(&keypad, 0x0F);
+
 	return 0;
 }
 
+/* Called at every Timer2 poll tick. Reads the selected sub controller once it
+ * had COLECO_SETTLE_TICKS to settle, then selects the other one and returns
+ * instead of waiting for it.
+ */
 static void colecovisionUpdate(void)
 {
-	int delta;
-
-	// Sub controller 1 selected
-	PORTC |= ((1<<PC1)|(1<<PC3)); 
-	PORTD &= ~((1<<PD7));
+	if (++phase_ticks < COLECO_SETTLE_TICKS)
+		return;
+	phase_ticks = 0;
 
-	_delay_ms(2);
-
-	//Reading of Joystick, Left Fire and Spinner Quadrature A
-	last_update_state[0] = (PINB&0x3F);
-
-	// Sub controller 2 selected
-	PORTC &= ~((1<<PC1)|(1<<PC3));
-	PORTD |= ((1<<PD7));
+	if (phase == 0)
+	{
+		//Reading of Joystick, Left Fire and Spinner Quadrature A
+		last_update_state[0] = (PINB&0x3F);
 
-	_delay_ms(2);
+		// Sub controller 2 selected
+		PORTC &= ~((1<<PC1)|(1<<PC3));
+		PORTD |= ((1<<PD7));
+		phase = 1;
+	}
+	else
+	{
+		unsigned char tmp;
 
-	//Reading of Key Pad, Right Fire and Spinner Quadrature B
-	last_update_state[1] = ((PINB&0x1F)|((PINC&(1<<PC2))<<3));
+		//Reading of Key Pad, Right Fire and Spinner Quadrature B
+		tmp = ((PINB&0x1F)|((PINC&(1<<PC2))<<3));
 
-	//Spinner calculation
-	spinner = ((~last_update_state[0]&(1<<PB5))>>5) | ((~last_update_state[1]&(1<<PB5))>>4);
-	
-	// Apply delta displacement from quadrature generated by the spinner.
-	// Quad Format (4 bits): MSB OldB OldA ActualB ActualA LSB
-	delta = (QEM[(spinner|(old_spinner<<2))]*MULT);
-	wheel_pos += delta;
+		// The keypad gives a 4 bit code, rolling from a key to another goes
+		// through other valid codes. All 4 lines low is no single key.
+		last_update_state[1] = (tmp&0xF0) | chordFilter(&keypad, tmp&0x0F, !(tmp&0x0F));
 
-	// Clipping min and max position
-	if(wheel_pos>(int)255)
-		wheel_pos=255;
+		// Sub controller 1 selected
+		PORTC |= ((1<<PC1)|(1<<PC3)); 
+		PORTD &= ~((1<<PD7));
+		phase = 0;
+	}
+}
 
-	if(wheel_pos<(int)0)
-		wheel_pos=0;
+static unsigned char colecovisionWheel(void)
+{
+	unsigned char pos;
 
-	old_spinner=spinner; // Old position = new position for next iteration.
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		pos = wheel_pos;
+	}
 
+	return pos;
 }
 
+// The quadrature bits of the states are masked, the roller has its own count
 static char colecovisionChanged(char id)
 {
-	return (last_update_state[0] != last_reported_state[0] || last_update_state[1] != last_reported_state[1]);
+	return (((last_update_state[0] ^ last_reported_state[0]) & 0x1F) ||
+			((last_update_state[1] ^ last_reported_state[1]) & 0x1F) ||
+			colecovisionWheel() != wheel_reported);
 }
 
 #define REPORT_SIZE 5
@@ -193,7 +292,7 @@ static char colecovisionBuildReport(unsigned char *reportBuffer, char id)
 		
 		reportBuffer[0] = x;
 		reportBuffer[1] = y;
-		reportBuffer[2] = (unsigned char)wheel_pos;
+		reportBuffer[2] = wheel_reported = colecovisionWheel();
 
 		reportBuffer[3] = 0;
 		reportBuffer[4] = 0;
@@ -228,6 +327,8 @@ static char colecovisionBuildReport(unsigned char *reportBuffer, char id)
 
 	last_reported_state[0] = last_update_state[0];
 	last_reported_state[1] = last_update_state[1];
+	if (!reportBuffer)
+		wheel_reported = colecovisionWheel();
 
 	return REPORT_SIZE;
 }
@@ -259,7 +360,7 @@ const char colecovision_usbHidReportDescriptor[] PROGMEM = {
     0x15, 0x00,					   //     LOGICAL_MINIMUM (0)
     0x26, 0xff, 0x00,			   //     LOGICAL_MAXIMUM (255)
     0x75, 0x08,					   //     REPORT_SIZE (8)
-    0x95, 0x01,					   //     REPORT_COUNT (1)
+    0x95, 0x08,					   //     REPORT_COUNT (8)
     0xb2, 0x02, 0x01,			   //     FEATURE (Data,Var,Abs,Buf)
 	0xc0,                          //   END_COLLECTION	
     0xc0                           // END_COLLECTION
@@ -294,6 +395,10 @@ Gamepad colecovisionJoy = {
 	.update					=	colecovisionUpdate,
 	.changed				=	colecovisionChanged,
 	.buildReport			=	colecovisionBuildReport,
+	.buttons_offset			=	3,
+	.buttons_count			=	16,
+	.axes_offset			=	0,
+	.axes_count				=	2,
 };
 
 Gamepad *colecovisionGetGamepad(void)
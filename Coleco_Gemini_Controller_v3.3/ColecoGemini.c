@@ -26,10 +26,11 @@
 #include <string.h>
 #include "usbconfig.h"
 #include "ColecoGemini.h"
+#include "config.h"
 
 #define SETUPDELAY	5
-#define DIVIDER 64 // 1M pot
-#define TIMEOUT	65000
+#define DIVIDER config.divider // see CFG_DEFAULT_DIVIDER
+#define TIMEOUT	80		// Polls (~0.6ms) without a comparator edge: no pot, start over
 
 static char ColecoGeminiInit(void);
 static void ColecoGeminiUpdate(void);
@@ -37,8 +38,10 @@ static char ColecoGeminiChanged(char id);
 static char ColecoGeminiBuildReport(unsigned char *reportBuffer, char id);
 static void ColecoGeminiReadPot(void);
 
-volatile unsigned int pot,old_pot;
+volatile unsigned int pot;
 volatile char flag;
+static unsigned int pot_value, old_pot;	// Last complete measurement, last one reported
+static unsigned char pot_polls;
 
 static unsigned char last_update_state=0;
 static unsigned char last_reported_state=0;
@@ -67,32 +70,42 @@ static char ColecoGeminiInit(void)
 	DDRC &= ~((1<<PC1)|(1<<PC3)|(1<<PC0)|(1<<PC2));
 	PORTC &= ~((1<<PC1)|(1<<PC3)|(1<<PC0)|(1<<PC2));
 
-	old_pot=pot=0;
+	old_pot=pot_value=pot=0;
 
 	ADCSRB |= (1<<ACME);	// Comparator negative input on ADC MUX.
 	ADCSRA &= ~(1<<ADEN);	// ADC off, Comparator on.
 	ACSR |= ((1<<ACBG)|(1<<ACIE)|(1<<ACIC)|(1<<ACIS1)); // Comparator positive input on BANDGAP. Interrupt enable on caparator
 	ADMUX=1; // Channel 1 selected (PC1)
 
-	TCCR1B |= ((1<<WGM12)|(1<<CS11));	// Timer1: CTC,XTAL/8
+	TCCR1B = ((1<<WGM12)|(1<<CS11));	// Timer1: CTC,XTAL/8
 
 	return 0;
 }
 
+/* The pot is measured in the background: ReadPot() starts charging it, the
+ * comparator ISR captures the charge time and discharges it right away, and
+ * a later poll collects the value and starts the next charge. The main loop
+ * never waits for the capacitor.
+ */
 static void ColecoGeminiUpdate(void)
 {
-	unsigned int i=0;
-
 	last_update_state = ((PINB&((1<<PB0)|(1<<PB1)|(1<<PB2)|(1<<PB3)|(1<<PB4))));
-	ColecoGeminiReadPot();
 
-	while(i<TIMEOUT && flag)
-		i++;
+	if (flag)	// Still charging
+	{
+		if (++pot_polls < TIMEOUT)
+			return;
+	}
+	else
+		pot_value = pot;
+
+	pot_polls = 0;
+	ColecoGeminiReadPot();
 }
 
 static char ColecoGeminiChanged(char id)
 {
-	return ((last_update_state != last_reported_state) || (pot != old_pot) );
+	return ((last_update_state != last_reported_state) || (pot_value != old_pot) );
 }
 
 #define REPORT_SIZE 4
@@ -107,7 +120,7 @@ static char ColecoGeminiBuildReport(unsigned char *reportBuffer, char id)
 		y = x = 0x80;
 
 		// Re-rangeing the pot values between 0-255
-		z=(pot/DIVIDER);
+		z=(pot_value/DIVIDER);
 
 		// Clip maximum value to 255
 		if(z>255)
@@ -131,6 +144,7 @@ static char ColecoGeminiBuildReport(unsigned char *reportBuffer, char id)
 
 	}
 	last_reported_state = last_update_state;
+	old_pot = pot_value;
 
 	return REPORT_SIZE;
 }
@@ -162,7 +176,7 @@ const char ColecoGemini_usbHidReportDescriptor[] PROGMEM = {
     0x15, 0x00,                    //     LOGICAL_MINIMUM (0)
     0x26, 0xff, 0x00,              //     LOGICAL_MAXIMUM (255)
     0x75, 0x08,                    //     REPORT_SIZE (8)
-    0x95, 0x01,                    //     REPORT_COUNT (1)
+    0x95, 0x08,                    //     REPORT_COUNT (8)
     0xb2, 0x02, 0x01,              //     FEATURE (Data,Var,Abs,Buf)	
     0xc0,                          //   END_COLLECTION
     0xc0                           // END_COLLECTION
@@ -198,6 +212,10 @@ Gamepad ColecoGeminiJoy = {
 	.update					=	ColecoGeminiUpdate,
 	.changed				=	ColecoGeminiChanged,
 	.buildReport			=	ColecoGeminiBuildReport,
+	.buttons_offset			=	3,
+	.buttons_count			=	8,
+	.axes_offset			=	0,
+	.axes_count				=	2,
 };
 
 Gamepad *ColecoGeminiGetGamepad(void)
@@ -210,7 +228,10 @@ Gamepad *ColecoGeminiGetGamepad(void)
 
 ISR(ANALOG_COMP_vect)
 {
+	if (!flag)
+		return;
 	pot=ICR1;		// Store triggered timer value 
+	DDRC |= (1<<PC1);	// Start discharging for the next reading
 	flag=0;			// Lower reading in process flag.
 }
 
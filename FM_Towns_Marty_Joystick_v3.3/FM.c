@@ -26,6 +26,7 @@
 #include <string.h>
 #include "usbconfig.h"
 #include "FM.h"
+#include "debounce.h"
 
 static char FMStyleInit(void);
 static void FMStyleUpdate(void);
@@ -35,6 +36,8 @@ static char FMStyleBuildReport(unsigned char *reportBuffer, char id);
 static unsigned char last_update_state=0;
 static unsigned char last_reported_state=0;
 
+static Debouncer debouncer;
+
 static char FMStyleInit(void)
 {
 	/* PIN1-PB0 = (I,1) UP / SELECT (1+2)
@@ -58,12 +61,14 @@ static char FMStyleInit(void)
 	DDRC |= ((1<<PC0)|(1<<PC2));
 	PORTC &= ~((1<<PC0)|(1<<PC1)|(1<<PC2)|(1<<PC3));
 
+	debounceInit(&debouncer, 0xff);
+
 	return 0;
 }
 
 static void FMStyleUpdate(void)
 {
-	last_update_state = (PINB&0x3F)|(PIND&(1<<PD7));
+	last_update_state = debounce(&debouncer, (PINB&0x3F)|(PIND&(1<<PD7)));
 }
 
 static char FMStyleChanged(char id)
@@ -140,7 +145,7 @@ const char FMStyle_usbHidReportDescriptor[] PROGMEM = {
     0x15, 0x00,                    //     LOGICAL_MINIMUM (0)
     0x26, 0xff, 0x00,              //     LOGICAL_MAXIMUM (255)
     0x75, 0x08,                    //     REPORT_SIZE (8)
-    0x95, 0x01,                    //     REPORT_COUNT (1)
+    0x95, 0x08,                    //     REPORT_COUNT (8)
     0xb2, 0x02, 0x01,              //     FEATURE (Data,Var,Abs,Buf)	
     0xc0,                          //   END_COLLECTION
     0xc0                           // END_COLLECTION
@@ -175,6 +180,10 @@ Gamepad FMStyleJoy = {
 	.update					=	FMStyleUpdate,
 	.changed				=	FMStyleChanged,
 	.buildReport			=	FMStyleBuildReport,
+	.buttons_offset			=	2,
+	.buttons_count			=	8,
+	.axes_offset			=	0,
+	.axes_count				=	2,
 };
 
 Gamepad *FMStyleGetGamepad(void)
@@ -26,6 +26,7 @@
 #include <string.h>
 #include "usbconfig.h"
 #include "Fairchild.h"
+#include "debounce.h"
 
 static char FairchildFInit(void);
 static void FairchildFUpdate(void);
@@ -35,6 +36,8 @@ static char FairchildFBuildReport(unsigned char *reportBuffer, char id);
 static unsigned char last_update_state=0;
 static unsigned char last_reported_state=0;
 
+static Debouncer debouncer;
+
 static char FairchildFInit(void)
 {
 
@@ -60,12 +63,14 @@ static char FairchildFInit(void)
 	DDRD &= ~(1<<PD7);
 	PORTD |= (1<<PD7);
 
+	debounceInit(&debouncer, 0xff);
+
 	return 0;
 }
 
 static void FairchildFUpdate(void)
 {
-	last_update_state = ((PINB&((1<<PB0)|(1<<PB1)|(1<<PB2)|(1<<PB3)|(1<<PB4)|(1<<PB5))) | ((PINC&(1<<PC3))<<3) | (PIND&(1<<PD7)));
+	last_update_state = debounce(&debouncer, ((PINB&((1<<PB0)|(1<<PB1)|(1<<PB2)|(1<<PB3)|(1<<PB4)|(1<<PB5))) | ((PINC&(1<<PC3))<<3) | (PIND&(1<<PD7))));
 }
 
 static char FairchildFChanged(char id)
@@ -128,7 +133,7 @@ const char FairchildF_usbHidReportDescriptor[] PROGMEM = {
     0x15, 0x00,                    //     LOGICAL_MINIMUM (0)
     0x26, 0xff, 0x00,              //     LOGICAL_MAXIMUM (255)
     0x75, 0x08,                    //     REPORT_SIZE (8)
-    0x95, 0x01,                    //     REPORT_COUNT (1)
+    0x95, 0x08,                    //     REPORT_COUNT (8)
     0xb2, 0x02, 0x01,              //     FEATURE (Data,Var,Abs,Buf)	
     0xc0,                          //   END_COLLECTION
     0xc0                           // END_COLLECTION
@@ -163,6 +168,8 @@ Gamepad FairchildFJoy = {
 	.update					=	FairchildFUpdate,
 	.changed				=	FairchildFChanged,
 	.buildReport			=	FairchildFBuildReport,
+	.axes_offset			=	0,
+	.axes_count				=	2,
 };
 
 Gamepad *FairchildFGetGamepad(void)
@@ -0,0 +1,16 @@
+#ifndef _remap_h__
+#define _remap_h__
+
+/* \brief Set where the buttons are in the reports and compile the tables.
+ * \param offset index of the first button byte in the report
+ * \param count number of buttons, 0 disables remapping
+ */
+void remapInit(unsigned char offset, unsigned char count);
+
+/* \brief Rebuild the tables from config.remap, call when it changes. */
+void remapCompile(void);
+
+/* \brief Remap the buttons of a report written by buildReport(). */
+void remapApply(unsigned char *report);
+
+#endif // _remap_h__
@@ -24,6 +24,7 @@
 #include <avr/interrupt.h>
 #include <util/delay.h>
 #include <avr/pgmspace.h>
+#include <avr/wdt.h>
 #include <string.h>
 #include "gamepad.h"
 #include "usbconfig.h"
@@ -65,11 +66,56 @@
 
 #define SNES_GET_DATA()	(SNES_DATA_PIN & SNES_DATA_BIT)
 
+/* Clock half period in ns and latch pulse in us, a project may override
+ * them in its usbconfig.h for a slow clone.
+ */
+#ifndef NSNES_HALF_NS
+#define NSNES_HALF_NS	500
+#endif
+#ifndef NSNES_LATCH_US
+#define NSNES_LATCH_US	12
+#endif
+
+/* update() runs between two polls of the 2kHz controller timer, the longest
+ * read (32 bits for the mouse) must leave it room. The unrolled shift takes
+ * about 8 cycles per bit at 12MHz on top of the delays, counted as 1us.
+ * With the defaults a 24 bits Four Score read is 60us and a mouse read
+ * 76us. A clone that misreads at 1MHz can set NSNES_HALF_NS to 1000, the
+ * mouse read is then 108us.
+ */
+#define NSNES_BUDGET_US		250
+#define NSNES_BIT_LOOP_NS	1000
+#define NSNES_READ_US(bits)	(NSNES_LATCH_US + (bits)*(2*NSNES_HALF_NS + NSNES_BIT_LOOP_NS)/1000)
+
+// Fails to compile if the timing settings overrun the budget
+typedef char nsnes_read_fits_budget[(NSNES_READ_US(32) <= NSNES_BUDGET_US) ? 1 : -1];
+
+/* SNES mouse sensitivity (0 slow, 1 medium, 2 fast). The mouse always
+ * powers up slow, it is stepped to this one once detected.
+ */
+#ifndef NSNES_MOUSE_SPEED
+#define NSNES_MOUSE_SPEED	1
+#endif
+
+#define TYPE_NES		0
+#define TYPE_SNES		1
+
+#define MODE_PAD		0
+#define MODE_MOUSE		1
+#define MODE_FOURSCORE	2
+
+#define FOURSCORE_PADS			2
+#define FOURSCORE_FEATURE_ID	(FOURSCORE_PADS+1)
+#define FOURSCORE_SIGNATURE		0x08	// Clock cycles 16-23, read order
+
+#define PLUG_CHECKS		8	// Consecutive reads of the other kind before re-enumerating
+
 /*********** prototypes *************/
 static char nsnesInit(void);
 static void nsnesUpdate(void);
 static char nsnesChanged(char report_id);
 static char nsnesBuildReport(unsigned char *reportBuffer, char id);
+static char nsnesPeekReport(unsigned char *reportBuffer, char id);
 
 // the most recent bytes we fetched from the controller
 static unsigned int last_update_state=0;
@@ -77,6 +123,13 @@ static unsigned int last_update_state=0;
 // the most recently reported bytes
 static unsigned int last_reported_state=0;
 
+static unsigned char type=TYPE_SNES;	// Pad connected, in MODE_PAD
+static unsigned char mode=MODE_PAD;		// Found at boot, selects the descriptor
+static unsigned char plug_count=0;
+static unsigned char pad_state[FOURSCORE_PADS];
+static unsigned char pad_reported[FOURSCORE_PADS];
+static int mouse_x, mouse_y;			// Motion not reported yet
+
 static char nsnesInit(void)
 {
 	// clock and latch as output
@@ -99,81 +152,281 @@ static char nsnesInit(void)
 }
 
 /*
-       Clock Cycle     Button Reported
-        ===========     ===============
-        0               B
-        1               Y
-        2               Select
-        3               Start
-        4               Up on joypad
-        5               Down on joypad
-        6               Left on joypad
-        7               Right on joypad
-        8               A
-        9               X
-        10              L
-        11              R
-        12              none (always high)
-        13              none (always high)
-        14              none (always high)
-        15              none (always high)
- 
+       Clock Cycle     Pad             Mouse
+        ===========     ===             =====
+        0               B (NES A)       none (always high)
+        1               Y (NES B)       none (always high)
+        2               Select          none (always high)
+        3               Start           none (always high)
+        4               Up on joypad    none (always high)
+        5               Down on joypad  none (always high)
+        6               Left on joypad  none (always high)
+        7               Right on joypad none (always high)
+        8               A               Right button
+        9               X               Left button
+        10              L               Sensitivity, MSB
+        11              R               Sensitivity, LSB
+        12-15           ID 0000         ID 0001
+        16              -               Y direction (1 = up)
+        17-23           -               Y motion, MSB first
+        24              -               X direction (1 = left)
+        25-31           -               X motion, MSB first
+
+ The data line is active low. A NES pad ends after 8 bits and keeps the
+ line low, so its ID reads 1111. Nothing connected reads as an idle SNES pad.
+
+ The NES Four Score (4 players mode) sends the two pads of a data line one
+ after the other, then the signature 00010000 on cycles 16-23. This
+ connector only carries the first data line, so we see players 1 and 3,
+ reported as pads 1 and 2. The Hori adapter and the second line of the
+ Four Score go through pins the Famicom expansion port has and this one
+ does not.
 */
 
-static void nsnesUpdate(void)
+/* One clock cycle, the bit is already on the data line. Shifted in from
+ * the top so that the first bit of a byte ends up in bit 0.
+ */
+#define NSNES_SHIFT_BIT(tmp)	do { \
+		_delay_us(NSNES_HALF_NS/1000.0); \
+		SNES_CLOCK_LOW(); \
+		tmp >>= 1; \
+		if (!SNES_GET_DATA()) { tmp |= 0x80; } \
+		_delay_us(NSNES_HALF_NS/1000.0); \
+		SNES_CLOCK_HIGH(); \
+	} while(0)
+
+/* Clock out 8 bits. Unrolled on a byte, a 32 bits mask and result cost
+ * more per bit than the clock itself.
+ */
+static unsigned char nsnesShift(void)
+{
+	unsigned char tmp=0;
+
+	NSNES_SHIFT_BIT(tmp);
+	NSNES_SHIFT_BIT(tmp);
+	NSNES_SHIFT_BIT(tmp);
+	NSNES_SHIFT_BIT(tmp);
+	NSNES_SHIFT_BIT(tmp);
+	NSNES_SHIFT_BIT(tmp);
+	NSNES_SHIFT_BIT(tmp);
+	NSNES_SHIFT_BIT(tmp);
+
+	return tmp;
+}
+
+/* Latch, then clock out count bytes. Bit n of the result (1 = line low)
+ * is clock cycle n.
+ */
+static unsigned long nsnesRead(unsigned char count)
 {
-	int i;
-	unsigned int tmp=0;
+	unsigned char bytes[4];
+	unsigned char i;
 
 	SNES_LATCH_HIGH();
-	_delay_us(12);
+	_delay_us(NSNES_LATCH_US);
 	SNES_LATCH_LOW();
 
-	for (i=0; i<16; i++)
+	for (i=0; i<count; i++)
+		bytes[i] = nsnesShift();
+	for (; i<4; i++)
+		bytes[i] = 0;
+
+	return bytes[0] | ((unsigned int)bytes[1]<<8) | ((unsigned long)bytes[2]<<16) | ((unsigned long)bytes[3]<<24);
+}
+
+static unsigned char nsnesType(unsigned int id)
+{
+	return (((id>>12)&0x0F) == 0x0F) ? TYPE_NES : TYPE_SNES;
+}
+
+/* A Four Score with only pad 2 pressing Right shows the mouse ID, and a
+ * moving mouse can show the Four Score signature, so neither is looked for
+ * once the other one is enumerated.
+ */
+static unsigned char nsnesMode(unsigned long tmp)
+{
+	if (((tmp>>16)&0xFF) == FOURSCORE_SIGNATURE && mode != MODE_MOUSE)
+		return MODE_FOURSCORE;
+	if (((tmp>>12)&0x0F) == 0x08 && mode != MODE_FOURSCORE)
+		return MODE_MOUSE;
+	return MODE_PAD;
+}
+
+/* Motion is sign and magnitude, the magnitude MSB first */
+static int nsnesMotion(unsigned char bits)
+{
+	unsigned char i, v=0;
+
+	for (i=1; i<8; i++)
+		v = (v<<1) | ((bits>>i)&1);
+
+	return (bits&1) ? -v : v;
+}
+
+/* A latch pulse with one clock inside steps the mouse to the next
+ * sensitivity.
+ */
+static void nsnesMouseSpeedStep(void)
+{
+	SNES_LATCH_HIGH();
+	_delay_us(NSNES_HALF_NS/1000.0);
+	SNES_CLOCK_LOW();
+	_delay_us(NSNES_HALF_NS/1000.0);
+	SNES_CLOCK_HIGH();
+	_delay_us(NSNES_HALF_NS/1000.0);
+	SNES_LATCH_LOW();
+}
+
+static void nsnesUpdate(void)
+{
+	unsigned long tmp;
+	unsigned char speed, found;
+
+	tmp = nsnesRead((mode == MODE_MOUSE) ? 4 : 3);
+	found = nsnesMode(tmp);
+
+	/* The descriptor was chosen at boot. If another kind of device is
+	 * plugged in, let the watchdog reset us so the host enumerates the
+	 * new one.
+	 */
+	if (found != mode)
 	{
-		_delay_us(6);
-		SNES_CLOCK_LOW();
-		
-		if (!SNES_GET_DATA()) { tmp |= (1<<i); }
+		if (++plug_count >= PLUG_CHECKS)
+		{
+			wdt_enable(WDTO_15MS);
+			for(;;);
+		}
+		return;
+	}
+	plug_count = 0;
 
-		_delay_us(6);
-		SNES_CLOCK_HIGH();
+	if (mode == MODE_FOURSCORE)
+	{
+		pad_state[0] = tmp;
+		pad_state[1] = tmp>>8;
+		return;
 	}
-	last_update_state = tmp;
+
+	if (mode == MODE_PAD)
+	{
+		type = nsnesType(tmp);
+		if (type == TYPE_NES)	// Only 8 real bits
+			tmp &= 0x00FF;
+		last_update_state = tmp&0x0FFF;
+		return;
+	}
+
+	// Buttons, L in bit 0
+	last_update_state = ((tmp>>9)&1) | ((tmp>>7)&2);
+
+	// Accumulate, nothing is lost when the host polls slower than us
+	if (mouse_x > -1000 && mouse_x < 1000)
+		mouse_x += nsnesMotion(tmp>>24);
+	if (mouse_y > -1000 && mouse_y < 1000)
+		mouse_y += nsnesMotion(tmp>>16);
+
+	speed = ((tmp>>9)&2) | ((tmp>>11)&1);
+	if (speed != NSNES_MOUSE_SPEED)
+		nsnesMouseSpeedStep();
 }
 
 static char nsnesChanged(char id)
 {
+	if (mode == MODE_FOURSCORE)
+		return (pad_state[id-1] != pad_reported[id-1]);
+	if (mode == MODE_MOUSE && (mouse_x || mouse_y))
+		return 1;
+
 	return (last_update_state != last_reported_state);
 }
 
 #define REPORT_SIZE 3
 
-static char nsnesBuildReport(unsigned char *reportBuffer, char id)
+static signed char nsnesClip(int v)
+{
+	if (v > 127)
+		return 127;
+	if (v < -127)
+		return -127;
+	return v;
+}
+
+// [X, Y, buttons] from the 12 first clock cycles
+static void nsnesPadReport(unsigned char *reportBuffer, unsigned int tmp)
+{
+	unsigned char x,y;
+
+	y = x = 0x80;
+
+	if (tmp&(1<<4)) { y = 0x00; }//Up
+	if (tmp&(1<<5)) { y = 0xff; }//Down
+	if (tmp&(1<<6)) { x = 0x00; }//Left
+	if (tmp&(1<<7)) { x = 0xff; }//Right
+
+	reportBuffer[0] = x;
+	reportBuffer[1] = y;
+	reportBuffer[2] = (tmp&0x0F) | ((tmp>>4)&0xF0);	// B Y Select Start A X L R
+}
+
+/* consume: mark the state as reported and take the motion reported away */
+static char nsnesReport(unsigned char *reportBuffer, char id, char consume)
 {
 	int x,y;
-	unsigned int tmp;
-	
-	if (reportBuffer)
+
+	if (mode == MODE_FOURSCORE)	// [report ID, X, Y, buttons] for pad id
+	{
+		if (id < 1 || id > FOURSCORE_PADS)
+			id = 1;
+		if (reportBuffer)
+		{
+			reportBuffer[0] = id;
+			nsnesPadReport(reportBuffer+1, pad_state[id-1]);
+		}
+		if (consume)
+			pad_reported[id-1] = pad_state[id-1];
+
+		return REPORT_SIZE+1;
+	}
+
+	if (mode == MODE_MOUSE)	// [buttons, X, Y], the rest of the motion goes in the next report
 	{
-		y = x = 0x80;
-
-		tmp = last_update_state;// ^ 0xffff;
-		
-		if (tmp&(1<<4)) { y = 0x00; }//Up
-		if (tmp&(1<<5)) { y = 0xff; }//Down
-		if (tmp&(1<<6)) { x = 0x00; }//Left
-		if (tmp&(1<<7)) { x = 0xff; }//Right
-
-		reportBuffer[0] = x;
-		reportBuffer[1] = y;
-		reportBuffer[2] = (tmp&0x0F);
+		if (reportBuffer)
+		{
+			x = nsnesClip(mouse_x);
+			y = nsnesClip(mouse_y);
+			if (consume)
+			{
+				mouse_x -= x;
+				mouse_y -= y;
+			}
+			reportBuffer[0] = last_update_state;
+			reportBuffer[1] = x;
+			reportBuffer[2] = y;
+		}
+		if (consume)
+			last_reported_state = last_update_state;
+
+		return REPORT_SIZE;
 	}
-	last_reported_state = last_update_state;
+	
+	if (reportBuffer)
+		nsnesPadReport(reportBuffer, last_update_state);
+	if (consume)
+		last_reported_state = last_update_state;
 
 	return REPORT_SIZE;
 }
 
+static char nsnesBuildReport(unsigned char *reportBuffer, char id)
+{
+	return nsnesReport(reportBuffer, id, 1);
+}
+
+static char nsnesPeekReport(unsigned char *reportBuffer, char id)
+{
+	return nsnesReport(reportBuffer, id, 0);
+}
+
 const char nsnes_usbHidReportDescriptor[] PROGMEM = {
 
 	0x05, 0x01,                    // USAGE_PAGE (Generic Desktop)
@@ -190,7 +443,7 @@ const char nsnes_usbHidReportDescriptor[] PROGMEM = {
     0x81, 0x02,                    //     INPUT (Data,Var,Abs)
     0x05, 0x09,                    //     USAGE_PAGE (Button)
     0x19, 0x01,                    //     USAGE_MINIMUM (Button 1)
-    0x29, 0x04,                    //     USAGE_MAXIMUM (Button 8)
+    0x29, 0x08,                    //     USAGE_MAXIMUM (Button 8)
     0x15, 0x00,                    //     LOGICAL_MINIMUM (0)
     0x25, 0x01,                    //     LOGICAL_MAXIMUM (1)
     0x95, 0x08,                    //     REPORT_COUNT (8)
@@ -200,12 +453,104 @@ const char nsnes_usbHidReportDescriptor[] PROGMEM = {
     0x15, 0x00,                    //     LOGICAL_MINIMUM (0)
     0x26, 0xff, 0x00,              //     LOGICAL_MAXIMUM (255)
     0x75, 0x08,                    //     REPORT_SIZE (8)
-    0x95, 0x01,                    //     REPORT_COUNT (1)
+    0x95, 0x08,                    //     REPORT_COUNT (8)
     0xb2, 0x02, 0x01,              //     FEATURE (Data,Var,Abs,Buf)	
     0xc0,                          //   END_COLLECTION
     0xc0                           // END_COLLECTION
 };
 
+const char nsnesMouse_usbHidReportDescriptor[] PROGMEM = {
+    0x05, 0x01,                    // USAGE_PAGE (Generic Desktop)
+    0x09, 0x02,                    // USAGE (Mouse)
+    0xa1, 0x01,                    // COLLECTION (Application)
+    0x09, 0x01,                    //   USAGE (Pointer)
+    0xa1, 0x00,                    //   COLLECTION (Physical)
+    0x05, 0x09,                    //     USAGE_PAGE (Button)
+    0x19, 0x01,                    //     USAGE_MINIMUM (Button 1)
+    0x29, 0x02,                    //     USAGE_MAXIMUM (Button 2)
+    0x15, 0x00,                    //     LOGICAL_MINIMUM (0)
+    0x25, 0x01,                    //     LOGICAL_MAXIMUM (1)
+    0x95, 0x02,                    //     REPORT_COUNT (2)
+    0x75, 0x01,                    //     REPORT_SIZE (1)
+    0x81, 0x02,                    //     INPUT (Data,Var,Abs)
+    0x95, 0x01,                    //     REPORT_COUNT (1)
+    0x75, 0x06,                    //     REPORT_SIZE (6)
+    0x81, 0x03,                    //     INPUT (Const,Var,Abs)
+    0x05, 0x01,                    //     USAGE_PAGE (Generic Desktop)
+    0x09, 0x30,                    //     USAGE (X)
+    0x09, 0x31,                    //     USAGE (Y)
+    0x15, 0x81,                    //     LOGICAL_MINIMUM (-127)
+    0x25, 0x7f,                    //     LOGICAL_MAXIMUM (127)
+    0x75, 0x08,                    //     REPORT_SIZE (8)
+    0x95, 0x02,                    //     REPORT_COUNT (2)
+    0x81, 0x06,                    //     INPUT (Data,Var,Rel)
+	0x09, 0x00,                    //     USAGE (Undefined) // Used to trig bootloader when SET FEATURE
+    0x15, 0x00,                    //     LOGICAL_MINIMUM (0)
+    0x26, 0xff, 0x00,              //     LOGICAL_MAXIMUM (255)
+    0x75, 0x08,                    //     REPORT_SIZE (8)
+    0x95, 0x08,                    //     REPORT_COUNT (8)
+    0xb2, 0x02, 0x01,              //     FEATURE (Data,Var,Abs,Buf)
+    0xc0,                          //   END_COLLECTION
+    0xc0                           // END_COLLECTION
+};
+
+// One game pad per Four Score player, the feature report on its own ID
+const char nsnesFourScore_usbHidReportDescriptor[] PROGMEM = {
+	0x05, 0x01,                    // USAGE_PAGE (Generic Desktop)
+    0x09, 0x05,                    // USAGE (Game Pad)
+    0xa1, 0x01,                    // COLLECTION (Application)
+    0x85, 1,                       //   REPORT_ID (1)
+    0xa1, 0x00,                    //   COLLECTION (Physical)
+    0x05, 0x01,                    //     USAGE_PAGE (Generic Desktop)
+    0x09, 0x30,                    //     USAGE (X)
+    0x09, 0x31,                    //     USAGE (Y)
+    0x15, 0x00,                    //     LOGICAL_MINIMUM (0)
+    0x26, 0xff, 0x00,              //     LOGICAL_MAXIMUM (255)
+    0x75, 0x08,                    //     REPORT_SIZE (8)
+    0x95, 0x02,                    //     REPORT_COUNT (2)
+    0x81, 0x02,                    //     INPUT (Data,Var,Abs)
+    0x05, 0x09,                    //     USAGE_PAGE (Button)
+    0x19, 0x01,                    //     USAGE_MINIMUM (Button 1)
+    0x29, 0x08,                    //     USAGE_MAXIMUM (Button 8)
+    0x15, 0x00,                    //     LOGICAL_MINIMUM (0)
+    0x25, 0x01,                    //     LOGICAL_MAXIMUM (1)
+    0x95, 0x08,                    //     REPORT_COUNT (8)
+    0x75, 0x01,                    //     REPORT_SIZE (1)
+    0x81, 0x02,                    //     INPUT (Data,Var,Abs)
+    0x85, FOURSCORE_FEATURE_ID,    //     REPORT_ID (3)
+	0x09, 0x00,                    //     USAGE (Undefined) // Used to trig bootloader when SET FEATURE
+    0x15, 0x00,                    //     LOGICAL_MINIMUM (0)
+    0x26, 0xff, 0x00,              //     LOGICAL_MAXIMUM (255)
+    0x75, 0x08,                    //     REPORT_SIZE (8)
+    0x95, 0x07,                    //     REPORT_COUNT (7)
+    0xb2, 0x02, 0x01,              //     FEATURE (Data,Var,Abs,Buf)
+    0xc0,                          //   END_COLLECTION
+    0xc0,                          // END_COLLECTION
+	0x05, 0x01,                    // USAGE_PAGE (Generic Desktop)
+    0x09, 0x05,                    // USAGE (Game Pad)
+    0xa1, 0x01,                    // COLLECTION (Application)
+    0x85, 2,                       //   REPORT_ID (2)
+    0xa1, 0x00,                    //   COLLECTION (Physical)
+    0x05, 0x01,                    //     USAGE_PAGE (Generic Desktop)
+    0x09, 0x30,                    //     USAGE (X)
+    0x09, 0x31,                    //     USAGE (Y)
+    0x15, 0x00,                    //     LOGICAL_MINIMUM (0)
+    0x26, 0xff, 0x00,              //     LOGICAL_MAXIMUM (255)
+    0x75, 0x08,                    //     REPORT_SIZE (8)
+    0x95, 0x02,                    //     REPORT_COUNT (2)
+    0x81, 0x02,                    //     INPUT (Data,Var,Abs)
+    0x05, 0x09,                    //     USAGE_PAGE (Button)
+    0x19, 0x01,                    //     USAGE_MINIMUM (Button 1)
+    0x29, 0x08,                    //     USAGE_MAXIMUM (Button 8)
+    0x15, 0x00,                    //     LOGICAL_MINIMUM (0)
+    0x25, 0x01,                    //     LOGICAL_MAXIMUM (1)
+    0x95, 0x08,                    //     REPORT_COUNT (8)
+    0x75, 0x01,                    //     REPORT_SIZE (1)
+    0x81, 0x02,                    //     INPUT (Data,Var,Abs)
+    0xc0,                          //   END_COLLECTION
+    0xc0                           // END_COLLECTION
+};
+
 #define USBDESCR_DEVICE         1
 
 const char nsnes_usbDescrDevice[] PROGMEM = {    /* USB device descriptor */
@@ -232,7 +577,12 @@ Gamepad nsnesGamepad = {
 	.init					= nsnesInit,
 	.update					= nsnesUpdate,
 	.changed				= nsnesChanged,
-	.buildReport			= nsnesBuildReport
+	.buildReport			= nsnesBuildReport,
+	.peekReport			= nsnesPeekReport,
+	.buttons_offset			= 2,
+	.axes_offset			= 0,
+	.axes_count				= 2,
+	.buttons_count			= 8
 };
 
 Gamepad *nsnesGetGamepad(void)
@@ -240,6 +590,32 @@ Gamepad *nsnesGetGamepad(void)
 	nsnesGamepad.reportDescriptor = (void*)nsnes_usbHidReportDescriptor;
 	nsnesGamepad.deviceDescriptor = (void*)nsnes_usbDescrDevice;
 
+	// Power the port and look at what answers, hardwareInit() comes later
+	DDRB |= (1<<PB4);
+	PORTB |= (1<<PB4);
+	DDRD |= (1<<PD7);
+	PORTD &= ~(1<<PD7);
+	nsnesInit();
+	_delay_ms(10);
+
+	mode = nsnesMode(nsnesRead(3));
+	if (mode == MODE_FOURSCORE)
+	{
+		nsnesGamepad.num_reports = FOURSCORE_PADS;
+		nsnesGamepad.reportDescriptor = (void*)nsnesFourScore_usbHidReportDescriptor;
+		nsnesGamepad.reportDescriptorSize = sizeof(nsnesFourScore_usbHidReportDescriptor);
+		nsnesGamepad.buttons_offset = 3;
+		nsnesGamepad.axes_offset = 1;
+		nsnesGamepad.feature_report_id = FOURSCORE_FEATURE_ID;
+	}
+	else if (mode == MODE_MOUSE)
+	{
+		nsnesGamepad.reportDescriptor = (void*)nsnesMouse_usbHidReportDescriptor;
+		nsnesGamepad.reportDescriptorSize = sizeof(nsnesMouse_usbHidReportDescriptor);
+		nsnesGamepad.buttons_offset = 0;
+		nsnesGamepad.axes_count = 0;
+	}
+
 	return &nsnesGamepad;
 }
 
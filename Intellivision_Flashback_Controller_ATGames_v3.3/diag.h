@@ -0,0 +1,109 @@
+#ifndef _diag_h__
+#define _diag_h__
+
+#include <avr/io.h>
+#include "usbconfig.h"
+
+/* Diagnostics, built when usbconfig.h sets USB_CFG_DIAGNOSTICS to 1.
+ *
+ * A vendor-defined HID interface with its own interrupt endpoint (3),
+ * readable through hidraw without a driver. It streams 8 byte records:
+ *
+ *   [DIAG_REC_COUNTERS, seq, polls, reports, coalesced]     16 bit LE each
+ *   [DIAG_REC_EVENTS,   seq, setups, suspends, overruns, 0] 16, 16, 8 bit
+ *   [DIAG_REC_TIMING,   seq, update last/max, pass last/max, tick last/max]
+ *   [DIAG_REC_TRACE,    seq, id, arg, time, id, arg, time]  2 trace events
+ *
+ * seq counts the records so that the reader sees the ones it missed. The
+ * times are TCNT0 counts (1024/F_CPU, 85us): how long update() took, the
+ * time between two passes of the main loop and from the poll tick to its
+ * handling. The maxima start again after each timing record.
+ *
+ * A record is only built when endpoint 1 has no report pending and the
+ * previous record was taken by the host: with nobody reading, the main loop
+ * pays one test per pass, plus the counter increments.
+ */
+
+#define DIAG_INTERFACE			1	// bInterfaceNumber, in place of the keyboard
+#define DIAG_REPORT_SIZE		8
+#define DIAG_REPORT_DESCRIPTOR_LENGTH	21
+
+#define DIAG_REC_COUNTERS	0x01
+#define DIAG_REC_EVENTS		0x02
+#define DIAG_REC_TIMING		0x03
+#define DIAG_REC_TRACE		0x04
+
+/* Counters */
+#define DIAG_POLLS			0	// Controller updates
+#define DIAG_REPORTS		1	// Reports handed to endpoint 1
+#define DIAG_COALESCED		2	// Changes merged into a report not sent yet
+#define DIAG_SETUPS			3	// Class requests
+#define DIAG_SUSPENDS		4
+#define DIAG_COUNTERS		5
+
+/* Timings */
+#define DIAG_TIME_UPDATE	0
+#define DIAG_TIME_PASS		1
+#define DIAG_TIME_TICK		2
+#define DIAG_TIMES			3
+
+/* Trace events, arg in () */
+#define DIAG_TRACE_REPORT	1	// (report ID) handed to endpoint 1
+#define DIAG_TRACE_SETUP	2	// (bRequest) class request
+#define DIAG_TRACE_FEATURE	3	// (command) feature report written
+#define DIAG_TRACE_SUSPEND	4
+#define DIAG_TRACE_RESUME	5
+
+#if USB_CFG_DIAGNOSTICS && USB_CFG_KEYBOARD
+#error "The keyboard and the diagnostics both need endpoint 3, build one of them"
+#endif
+
+#if USB_CFG_DIAGNOSTICS
+
+extern const char diag_usbHidReportDescriptor[];
+
+extern unsigned int diag_counters[DIAG_COUNTERS];
+extern volatile unsigned char diag_overruns;
+extern volatile unsigned char diag_start[DIAG_TIMES];
+extern unsigned char diag_time[DIAG_TIMES][2];	// Last, max
+
+#define diagCount(c)		do { diag_counters[c]++; } while(0)
+#define diagStart(t)		do { diag_start[t] = TCNT0; } while(0)
+
+/* \brief Call from the poll tick interrupt.
+ * \param missed non zero if the previous tick was not handled yet
+ */
+#define diagTick(missed)	do { if (missed) diag_overruns++; diagStart(DIAG_TIME_TICK); } while(0)
+
+static inline void diagStop(unsigned char t)
+{
+	unsigned char d = TCNT0 - diag_start[t];
+
+	diag_time[t][0] = d;
+	if (d > diag_time[t][1])
+		diag_time[t][1] = d;
+}
+
+void diagTrace(unsigned char id, unsigned char arg);
+
+/* \brief Hand the next record to endpoint 3 if the host took the last one.
+ * Call when endpoint 1 has nothing pending. */
+void diagTask(void);
+
+/* \brief Class requests addressed to the diagnostics interface.
+ * return As usbFunctionSetup()
+ */
+unsigned char diagSetup(unsigned char data[8]);
+
+#else
+
+#define diagCount(c)		do { } while(0)
+#define diagStart(t)		do { } while(0)
+#define diagStop(t)			do { } while(0)
+#define diagTick(missed)	do { } while(0)
+#define diagTrace(id, arg)	do { } while(0)
+#define diagTask()			do { } while(0)
+
+#endif // USB_CFG_DIAGNOSTICS
+
+#endif // _diag_h__
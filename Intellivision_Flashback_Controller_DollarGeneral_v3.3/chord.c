@@ -0,0 +1,49 @@
+/* Code stability filter for keypads sharing lines with other controls
+ * Copyright (C) 2024 Francis-Olivier Gradel, B.Eng.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * The author may be contacted at info@retronicdesign.com
+ *
+ */
+#include "chord.h"
+
+/* Unlike debounce.c, the inputs can not be filtered one by one: a transient
+ * code is made of valid line levels, only the whole code tells it apart.
+ * Any change of code restarts the count, so a code seen for less than its
+ * window, or interrupted by another one, never reaches changed().
+ */
+void chordInit(ChordFilter *cf, unsigned char code)
+{
+	cf->state = cf->candidate = code;
+	cf->count = 0xff;
+}
+
+unsigned char chordFilter(ChordFilter *cf, unsigned char code, unsigned char combo)
+{
+	if (code != cf->candidate)
+	{
+		cf->candidate = code;
+		cf->count = 0;
+	}
+
+	if (cf->count != 0xff)
+		cf->count++;
+
+	if (cf->count >= (combo ? CHORD_COMBO_SAMPLES : CHORD_STABLE_SAMPLES))
+		cf->state = code;
+
+	return cf->state;
+}
@@ -29,6 +29,7 @@
 #include <string.h>
 #include "usbconfig.h"
 #include "intellivision.h"
+#include "chord.h"
 
 static char intellivisionInit(void);
 static void intellivisionUpdate(void);
@@ -38,6 +39,8 @@ static char intellivisionBuildReport(unsigned char *reportBuffer, char id);
 static unsigned char last_update_state=0;
 static unsigned char last_reported_state=0;
 
+static ChordFilter chord;
+
 static char intellivisionInit(void)
 {
 
@@ -75,23 +78,54 @@ static char intellivisionInit(void)
 	PORTC |= ((1<<PC0)|(1<<PC2)|(1<<PC1)|(1<<PC3));
 	PORTD |= ((1<<PD7));
 
+	chordInit(&chord, 0xff);
+
 	return 0;
 }
 
+/* Codes (inputs inverted, 1 = active) a single control can give: a disc
+ * direction and/or an action button, or one key of the keypad. One bit per
+ * code, anything else is a chord for the chord filter.
+ */
+static const unsigned char intellivision_single[32] PROGMEM = {
+	0x5F, 0x13, 0x16, 0x01, 0x16, 0x01, 0x5F, 0x13,
+	0x16, 0x01, 0x5F, 0x13, 0x5F, 0x13, 0x00, 0x00,
+	0x5E, 0x13, 0x00, 0x00, 0x00, 0x00, 0x5E, 0x13,
+	0x00, 0x00, 0x5E, 0x13, 0x5E, 0x13, 0x00, 0x00,
+};
+
+static unsigned char intellivisionChord(unsigned char code)
+{
+	unsigned char tmp = (code ^ 0xff);
+
+	return chordFilter(&chord, code, !(pgm_read_byte(&intellivision_single[tmp>>3]) & (1<<(tmp&7))));
+}
+
+/* Mattel bit of each PB0-PB5 combination, PB2 (ground) ignored */
+static const unsigned char flashback_pinb[64] PROGMEM = {
+	0x00, 0x08, 0x10, 0x18, 0x00, 0x08, 0x10, 0x18,
+	0x02, 0x0A, 0x12, 0x1A, 0x02, 0x0A, 0x12, 0x1A,
+	0x40, 0x48, 0x50, 0x58, 0x40, 0x48, 0x50, 0x58,
+	0x42, 0x4A, 0x52, 0x5A, 0x42, 0x4A, 0x52, 0x5A,
+	0x20, 0x28, 0x30, 0x38, 0x20, 0x28, 0x30, 0x38,
+	0x22, 0x2A, 0x32, 0x3A, 0x22, 0x2A, 0x32, 0x3A,
+	0x60, 0x68, 0x70, 0x78, 0x60, 0x68, 0x70, 0x78,
+	0x62, 0x6A, 0x72, 0x7A, 0x62, 0x6A, 0x72, 0x7A,
+};
+
 static void intellivisionUpdate(void)
 {
 	//				Bit7	Bit6	Bit5	Bit4	Bit3	Bit2	Bit1	Bit0
 	// Mattel		PC2		PD7		PB5		PB4		PB3		PB2		PB1		PB0
 	// Flashback	PC3		PB4		PB5		PB1		PB0		PD7		PB3		PC2
-	// Looks complex but it's for placing bits in the corresponding order to match original gamepad for simple decoding.
-	last_update_state = (((PINB&(1<<PB0))?(1<<3):0)|
-						((PINB&(1<<PB1))?(1<<4):0)|
-						((PINB&(1<<PB3))?(1<<1):0)|
-						((PINB&(1<<PB4))?(1<<6):0)|
-						((PINB&(1<<PB5))?(1<<5):0)|
-						((PINC&(1<<PC2))?(1<<0):0)|
-						((PIND&(1<<PD7))?(1<<2):0)|
-						((PINC&(1<<PC3))?(1<<7):0));
+	// Places the bits in the order of the original gamepad, so the decoding is the same.
+	// PORTB goes through flashback_pinb, PC2, PC3 and PD7 only need a shift.
+	unsigned char pinc = PINC;
+
+	last_update_state = intellivisionChord(pgm_read_byte(&flashback_pinb[PINB&0x3F])|
+						((pinc&(1<<PC2))>>2)|
+						((pinc&(1<<PC3))<<4)|
+						((PIND&(1<<PD7))>>5));
 }
 
 static char intellivisionChanged(char id)
@@ -101,72 +135,94 @@ static char intellivisionChanged(char id)
 
 #define REPORT_SIZE 5
 
+/* Report bytes [X, Y, Btn 1-8, Btn 9-16] for every controller code (inputs
+ * inverted, 1 = active). The disc gives the 16 directions, then the 3 action
+ * buttons, then the 12 keys of the keypad and the K1+K9 combination (Btn 16,
+ * Pause) override it, a key centering the disc. Codes matching none of them
+ * are a centered disc with no button.
+ *
+ * Disc (code&0x8F)   N 0x02, NNE 0x82, NE 0x86, ENE 0x06, E 0x04, ESE 0x84,
+ *                    SE 0x8C, SSE 0x0C, S 0x08, SSW 0x88, SW 0x89, WSW 0x09,
+ *                    W 0x01, WNW 0x81, NW 0x83, NNW 0x03
+ * Action (code&0x70) 1 0x50, 2 0x60, 3 0x30
+ * Keypad (code)      1 0x18, 2 0x28, 3 0x48, 4 0x14, 5 0x24, 6 0x44, 7 0x12,
+ *                    8 0x22, 9 0x42, Clear 0x11, 0 0x21, Enter 0x41, K1+K9 0x5A
+ */
+static const unsigned char intellivision_decode[256][4] PROGMEM = {
+	{0x80,0x80,0x00,0x00}, {0x00,0x80,0x00,0x00}, {0x80,0x00,0x00,0x00}, {0x40,0x00,0x00,0x00},	// 0x00-0x03
+	{0xFF,0x80,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0xFF,0x40,0x00,0x00}, {0x80,0x80,0x00,0x00},	// 0x04-0x07
+	{0x80,0xFF,0x00,0x00}, {0x00,0xC0,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x00},	// 0x08-0x0B
+	{0xC0,0xFF,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x00},	// 0x0C-0x0F
+	{0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x10}, {0x80,0x80,0x00,0x02}, {0x40,0x00,0x00,0x00},	// 0x10-0x13
+	{0x80,0x80,0x40,0x00}, {0x80,0x80,0x00,0x00}, {0xFF,0x40,0x00,0x00}, {0x80,0x80,0x00,0x00},	// 0x14-0x17
+	{0x80,0x80,0x08,0x00}, {0x00,0xC0,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x00},	// 0x18-0x1B
+	{0xC0,0xFF,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x00},	// 0x1C-0x1F
+	{0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x20}, {0x80,0x80,0x00,0x04}, {0x40,0x00,0x00,0x00},	// 0x20-0x23
+	{0x80,0x80,0x80,0x00}, {0x80,0x80,0x00,0x00}, {0xFF,0x40,0x00,0x00}, {0x80,0x80,0x00,0x00},	// 0x24-0x27
+	{0x80,0x80,0x10,0x00}, {0x00,0xC0,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x00},	// 0x28-0x2B
+	{0xC0,0xFF,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x00},	// 0x2C-0x2F
+	{0x80,0x80,0x04,0x00}, {0x00,0x80,0x04,0x00}, {0x80,0x00,0x04,0x00}, {0x40,0x00,0x04,0x00},	// 0x30-0x33
+	{0xFF,0x80,0x04,0x00}, {0x80,0x80,0x04,0x00}, {0xFF,0x40,0x04,0x00}, {0x80,0x80,0x04,0x00},	// 0x34-0x37
+	{0x80,0xFF,0x04,0x00}, {0x00,0xC0,0x04,0x00}, {0x80,0x80,0x04,0x00}, {0x80,0x80,0x04,0x00},	// 0x38-0x3B
+	{0xC0,0xFF,0x04,0x00}, {0x80,0x80,0x04,0x00}, {0x80,0x80,0x04,0x00}, {0x80,0x80,0x04,0x00},	// 0x3C-0x3F
+	{0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x40}, {0x80,0x80,0x00,0x08}, {0x40,0x00,0x00,0x00},	// 0x40-0x43
+	{0x80,0x80,0x00,0x01}, {0x80,0x80,0x00,0x00}, {0xFF,0x40,0x00,0x00}, {0x80,0x80,0x00,0x00},	// 0x44-0x47
+	{0x80,0x80,0x20,0x00}, {0x00,0xC0,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x00},	// 0x48-0x4B
+	{0xC0,0xFF,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x00},	// 0x4C-0x4F
+	{0x80,0x80,0x01,0x00}, {0x00,0x80,0x01,0x00}, {0x80,0x00,0x01,0x00}, {0x40,0x00,0x01,0x00},	// 0x50-0x53
+	{0xFF,0x80,0x01,0x00}, {0x80,0x80,0x01,0x00}, {0xFF,0x40,0x01,0x00}, {0x80,0x80,0x01,0x00},	// 0x54-0x57
+	{0x80,0xFF,0x01,0x00}, {0x00,0xC0,0x01,0x00}, {0x80,0x80,0x00,0x80}, {0x80,0x80,0x01,0x00},	// 0x58-0x5B
+	{0xC0,0xFF,0x01,0x00}, {0x80,0x80,0x01,0x00}, {0x80,0x80,0x01,0x00}, {0x80,0x80,0x01,0x00},	// 0x5C-0x5F
+	{0x80,0x80,0x02,0x00}, {0x00,0x80,0x02,0x00}, {0x80,0x00,0x02,0x00}, {0x40,0x00,0x02,0x00},	// 0x60-0x63
+	{0xFF,0x80,0x02,0x00}, {0x80,0x80,0x02,0x00}, {0xFF,0x40,0x02,0x00}, {0x80,0x80,0x02,0x00},	// 0x64-0x67
+	{0x80,0xFF,0x02,0x00}, {0x00,0xC0,0x02,0x00}, {0x80,0x80,0x02,0x00}, {0x80,0x80,0x02,0x00},	// 0x68-0x6B
+	{0xC0,0xFF,0x02,0x00}, {0x80,0x80,0x02,0x00}, {0x80,0x80,0x02,0x00}, {0x80,0x80,0x02,0x00},	// 0x6C-0x6F
+	{0x80,0x80,0x00,0x00}, {0x00,0x80,0x00,0x00}, {0x80,0x00,0x00,0x00}, {0x40,0x00,0x00,0x00},	// 0x70-0x73
+	{0xFF,0x80,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0xFF,0x40,0x00,0x00}, {0x80,0x80,0x00,0x00},	// 0x74-0x77
+	{0x80,0xFF,0x00,0x00}, {0x00,0xC0,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x00},	// 0x78-0x7B
+	{0xC0,0xFF,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x00},	// 0x7C-0x7F
+	{0x80,0x80,0x00,0x00}, {0x00,0x40,0x00,0x00}, {0xC0,0x00,0x00,0x00}, {0x00,0x00,0x00,0x00},	// 0x80-0x83
+	{0xFF,0xC0,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0xFF,0x00,0x00,0x00}, {0x80,0x80,0x00,0x00},	// 0x84-0x87
+	{0x40,0xFF,0x00,0x00}, {0x00,0xFF,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x00},	// 0x88-0x8B
+	{0xFF,0xFF,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x00},	// 0x8C-0x8F
+	{0x80,0x80,0x00,0x00}, {0x00,0x40,0x00,0x00}, {0xC0,0x00,0x00,0x00}, {0x00,0x00,0x00,0x00},	// 0x90-0x93
+	{0xFF,0xC0,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0xFF,0x00,0x00,0x00}, {0x80,0x80,0x00,0x00},	// 0x94-0x97
+	{0x40,0xFF,0x00,0x00}, {0x00,0xFF,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x00},	// 0x98-0x9B
+	{0xFF,0xFF,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x00},	// 0x9C-0x9F
+	{0x80,0x80,0x00,0x00}, {0x00,0x40,0x00,0x00}, {0xC0,0x00,0x00,0x00}, {0x00,0x00,0x00,0x00},	// 0xA0-0xA3
+	{0xFF,0xC0,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0xFF,0x00,0x00,0x00}, {0x80,0x80,0x00,0x00},	// 0xA4-0xA7
+	{0x40,0xFF,0x00,0x00}, {0x00,0xFF,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x00},	// 0xA8-0xAB
+	{0xFF,0xFF,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x00},	// 0xAC-0xAF
+	{0x80,0x80,0x04,0x00}, {0x00,0x40,0x04,0x00}, {0xC0,0x00,0x04,0x00}, {0x00,0x00,0x04,0x00},	// 0xB0-0xB3
+	{0xFF,0xC0,0x04,0x00}, {0x80,0x80,0x04,0x00}, {0xFF,0x00,0x04,0x00}, {0x80,0x80,0x04,0x00},	// 0xB4-0xB7
+	{0x40,0xFF,0x04,0x00}, {0x00,0xFF,0x04,0x00}, {0x80,0x80,0x04,0x00}, {0x80,0x80,0x04,0x00},	// 0xB8-0xBB
+	{0xFF,0xFF,0x04,0x00}, {0x80,0x80,0x04,0x00}, {0x80,0x80,0x04,0x00}, {0x80,0x80,0x04,0x00},	// 0xBC-0xBF
+	{0x80,0x80,0x00,0x00}, {0x00,0x40,0x00,0x00}, {0xC0,0x00,0x00,0x00}, {0x00,0x00,0x00,0x00},	// 0xC0-0xC3
+	{0xFF,0xC0,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0xFF,0x00,0x00,0x00}, {0x80,0x80,0x00,0x00},	// 0xC4-0xC7
+	{0x40,0xFF,0x00,0x00}, {0x00,0xFF,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x00},	// 0xC8-0xCB
+	{0xFF,0xFF,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x00},	// 0xCC-0xCF
+	{0x80,0x80,0x01,0x00}, {0x00,0x40,0x01,0x00}, {0xC0,0x00,0x01,0x00}, {0x00,0x00,0x01,0x00},	// 0xD0-0xD3
+	{0xFF,0xC0,0x01,0x00}, {0x80,0x80,0x01,0x00}, {0xFF,0x00,0x01,0x00}, {0x80,0x80,0x01,0x00},	// 0xD4-0xD7
+	{0x40,0xFF,0x01,0x00}, {0x00,0xFF,0x01,0x00}, {0x80,0x80,0x01,0x00}, {0x80,0x80,0x01,0x00},	// 0xD8-0xDB
+	{0xFF,0xFF,0x01,0x00}, {0x80,0x80,0x01,0x00}, {0x80,0x80,0x01,0x00}, {0x80,0x80,0x01,0x00},	// 0xDC-0xDF
+	{0x80,0x80,0x02,0x00}, {0x00,0x40,0x02,0x00}, {0xC0,0x00,0x02,0x00}, {0x00,0x00,0x02,0x00},	// 0xE0-0xE3
+	{0xFF,0xC0,0x02,0x00}, {0x80,0x80,0x02,0x00}, {0xFF,0x00,0x02,0x00}, {0x80,0x80,0x02,0x00},	// 0xE4-0xE7
+	{0x40,0xFF,0x02,0x00}, {0x00,0xFF,0x02,0x00}, {0x80,0x80,0x02,0x00}, {0x80,0x80,0x02,0x00},	// 0xE8-0xEB
+	{0xFF,0xFF,0x02,0x00}, {0x80,0x80,0x02,0x00}, {0x80,0x80,0x02,0x00}, {0x80,0x80,0x02,0x00},	// 0xEC-0xEF
+	{0x80,0x80,0x00,0x00}, {0x00,0x40,0x00,0x00}, {0xC0,0x00,0x00,0x00}, {0x00,0x00,0x00,0x00},	// 0xF0-0xF3
+	{0xFF,0xC0,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0xFF,0x00,0x00,0x00}, {0x80,0x80,0x00,0x00},	// 0xF4-0xF7
+	{0x40,0xFF,0x00,0x00}, {0x00,0xFF,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x00},	// 0xF8-0xFB
+	{0xFF,0xFF,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x00}, {0x80,0x80,0x00,0x00},	// 0xFC-0xFF
+};
+
 static char intellivisionBuildReport(unsigned char *reportBuffer, char id)
 {
-	int x,y;
-	unsigned char tmp,but[2];
+	unsigned char tmp;
 	
 	if (reportBuffer)
 	{
 		tmp = (last_update_state ^ 0xff);
 		
-		//Scan direction disc first
-		switch(tmp&0x8F)
-		{
-			case 0b00000010: x = 0x80; y = 0x00; but[0]=but[1]=0; break; //D1 Disc N
-			case 0b10000010: x = 0xC0; y = 0x00; but[0]=but[1]=0; break; //D2 Disc NNE
-			case 0b10000110: x = 0xFF; y = 0x00; but[0]=but[1]=0; break; //D3 Disc NE 
-			case 0b00000110: x = 0xFF; y = 0x40; but[0]=but[1]=0; break; //D4 Disc ENE
-			case 0b00000100: x = 0xFF; y = 0x80; but[0]=but[1]=0; break; //D5 Disc E
-			case 0b10000100: x = 0xFF; y = 0xC0; but[0]=but[1]=0; break; //D6 Disc ESE
-			case 0b10001100: x = 0xFF; y = 0xFF; but[0]=but[1]=0; break; //D7 Disc SE
-			case 0b00001100: x = 0xC0; y = 0xFF; but[0]=but[1]=0; break; //D8 Disc SSE
-			case 0b00001000: x = 0x80; y = 0xFF; but[0]=but[1]=0; break; //D9 Disc S
-			case 0b10001000: x = 0x40; y = 0xFF; but[0]=but[1]=0; break; //D10 Disc SSW
-			case 0b10001001: x = 0x00; y = 0xFF; but[0]=but[1]=0; break; //D11 Disc SW
-			case 0b00001001: x = 0x00; y = 0xC0; but[0]=but[1]=0; break; //D12 Disc WSW
-			case 0b00000001: x = 0x00; y = 0x80; but[0]=but[1]=0; break; //D13 Disc W
-			case 0b10000001: x = 0x00; y = 0x40; but[0]=but[1]=0; break; //D14 Disc WNW
-			case 0b10000011: x = 0x00; y = 0x00; but[0]=but[1]=0; break; //D15 Disc NW
-			case 0b00000011: x = 0x40; y = 0x00; but[0]=but[1]=0; break; //D16 Disc NNW
-
-			default: y = x = 0x80; //D0 Disc centered
-		}
-
-		//Then scan action buttons (3 buttons)
-		switch(tmp&0x70)
-		{
-
-			case 0b01010000:  but[1]=0b00000000; but[0]=0b00000001; break; //S1 Button 1
-			case 0b01100000:  but[1]=0b00000000; but[0]=0b00000010; break; //S2 Button 2
-			case 0b00110000:  but[1]=0b00000000; but[0]=0b00000100; break; //S3 Button 3
-
-			default: but[2]=but[1]=but[0]=0; //All buttons depressed
-		}
-
-		//Finally, scan keypad (12 buttons)
-		switch(tmp)
-		{
-
-			case 0b00011000: x = y = 0x80;  but[1]=0b00000000; but[0]=0b00001000; break; //K1 Keypad 1
-			case 0b00101000: x = y = 0x80;  but[1]=0b00000000; but[0]=0b00010000; break; //K2 Keypad 2
-			case 0b01001000: x = y = 0x80;  but[1]=0b00000000; but[0]=0b00100000; break; //K3 Keypad 3
-			case 0b00010100: x = y = 0x80;  but[1]=0b00000000; but[0]=0b01000000; break; //K4 Keypad 4
-			case 0b00100100: x = y = 0x80;  but[1]=0b00000000; but[0]=0b10000000; break; //K5 Keypad 5
-			case 0b01000100: x = y = 0x80;  but[1]=0b00000001; but[0]=0b00000000; break; //K6 Keypad 6
-			case 0b00010010: x = y = 0x80;  but[1]=0b00000010; but[0]=0b00000000; break; //K7 Keypad 7
-			case 0b00100010: x = y = 0x80;  but[1]=0b00000100; but[0]=0b00000000; break; //K8 Keypad 8
-			case 0b01000010: x = y = 0x80;  but[1]=0b00001000; but[0]=0b00000000; break; //K9 Keypad 9
-			case 0b00010001: x = y = 0x80;  but[1]=0b00010000; but[0]=0b00000000; break; //Clear Keypad Clear
-			case 0b00100001: x = y = 0x80;  but[1]=0b00100000; but[0]=0b00000000; break; //K0 Keypad 0
-			case 0b01000001: x = y = 0x80;  but[1]=0b01000000; but[0]=0b00000000; break; //Enter Keypad Enter
-
-			//Special case, keypad combinations
-			case 0b01011010: x = y = 0x80;  but[1]=0b10000000; but[0]=0b00000000; break; //[K1+K9] to Btn 16 (Pause)
-
-			default: but[1]=0; but[0] &= 0x07; //Keypad depressed	
-		}
-
 	   /*
  		* [0] X
  		* [1] Y
@@ -175,10 +231,7 @@ static char intellivisionBuildReport(unsigned char *reportBuffer, char id)
 		* [4] Raw controller input with no interpretation (8 bits)
  		*/
 
-		reportBuffer[0] = x;
-		reportBuffer[1] = y;
-		reportBuffer[2] = but[0];
-		reportBuffer[3] = but[1];
+		memcpy_P(reportBuffer, intellivision_decode[tmp], 4);
 		reportBuffer[4] = tmp;
 
 	}
@@ -214,7 +267,7 @@ const char intellivision_usbHidReportDescriptor[] PROGMEM = {
     0x15, 0x00,                    //     LOGICAL_MINIMUM (0)
     0x26, 0xff, 0x00,              //     LOGICAL_MAXIMUM (255)
     0x75, 0x08,                    //     REPORT_SIZE (8)
-    0x95, 0x01,                    //     REPORT_COUNT (1)
+    0x95, 0x08,                    //     REPORT_COUNT (8)
     0xb2, 0x02, 0x01,              //     FEATURE (Data,Var,Abs,Buf)	
     0xc0                           // END_COLLECTION
 };
@@ -248,6 +301,10 @@ Gamepad intellivisionJoy = {
 	.update					=	intellivisionUpdate,
 	.changed				=	intellivisionChanged,
 	.buildReport			=	intellivisionBuildReport,
+	.buttons_offset			=	2,
+	.buttons_count			=	16,
+	.axes_offset			=	0,
+	.axes_count				=	2,
 };
 
 Gamepad *intellivisionGetGamepad(void)
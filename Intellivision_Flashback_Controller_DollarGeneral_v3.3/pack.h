@@ -0,0 +1,39 @@
+#ifndef _pack_h__
+#define _pack_h__
+
+#include "gamepad.h"
+
+/* Every controller of a multitap in one report, set config.pack_reports.
+ *
+ * A multitap normally gives each controller a report ID of its own, and
+ * each one costs an interrupt transfer: with 4 controllers pressed at the
+ * same time the last one leaves 4 polls after the first. Packed, a single
+ * report without ID (one joystick for the host) carries them all:
+ *   byte 0-1  2 bits per axis, X and Y of controller 1 to 4 (-1, 0 or 1)
+ *   byte 2-5  the 8 buttons of controller 1 to 4
+ * Only digital controllers fit in there: 2 to PACK_PADS reports of 2 axes
+ * and at most 8 buttons, no mouse (Sega Team Player, NES Four Score).
+ */
+
+#define PACK_PADS		4
+#define PACK_REPORT_SIZE	(PACK_PADS/2 + PACK_PADS)
+#define PACK_REPORT_DESCRIPTOR_LENGTH	68
+
+extern const char pack_usbHidReportDescriptor[];
+
+/* \brief Check whether the reports of a gamepad can be packed.
+ * Call after configInit(), it only reads config.pack_reports there.
+ * return 1 if main.c is to send the packed report, 0 otherwise
+ */
+unsigned char packInit(Gamepad *pad);
+
+/* \brief Start a packed report, all axes centered and no button. */
+void packClear(unsigned char *report);
+
+/* \brief Add a controller to the packed report.
+ * \param pad report built for report ID id, remapped and with autofire
+ * \param id 1 to PACK_PADS
+ */
+void packAdd(unsigned char *report, const unsigned char *pad, unsigned char id);
+
+#endif // _pack_h__
@@ -26,6 +26,7 @@
 #include <string.h>
 #include "usbconfig.h"
 #include "MSX.h"
+#include "debounce.h"
 
 static char MSXInit(void);
 static void MSXUpdate(void);
@@ -35,6 +36,8 @@ static char MSXBuildReport(unsigned char *reportBuffer, char id);
 static unsigned char last_update_state=0;
 static unsigned char last_reported_state=0;
 
+static Debouncer debouncer;
+
 static char MSXInit(void)
 {
 
@@ -59,12 +62,14 @@ static char MSXInit(void)
 	DDRD |= (1<<PD7);
 	PORTD &= ~(1<<PD7);
 
+	debounceInit(&debouncer, 0xff);
+
 	return 0;
 }
 
 static void MSXUpdate(void)
 {
-	last_update_state = (PINB&0x3F);
+	last_update_state = debounce(&debouncer, (PINB&0x3F));
 }
 
 static char MSXChanged(char id)
@@ -128,7 +133,7 @@ const char MSX_usbHidReportDescriptor[] PROGMEM = {
     0x15, 0x00,                    //     LOGICAL_MINIMUM (0)
     0x26, 0xff, 0x00,              //     LOGICAL_MAXIMUM (255)
     0x75, 0x08,                    //     REPORT_SIZE (8)
-    0x95, 0x01,                    //     REPORT_COUNT (1)
+    0x95, 0x08,                    //     REPORT_COUNT (8)
     0xb2, 0x02, 0x01,              //     FEATURE (Data,Var,Abs,Buf)	
     0xc0,                          //   END_COLLECTION
     0xc0                           // END_COLLECTION
@@ -163,6 +168,10 @@ Gamepad MSXJoy = {
 	.update					=	MSXUpdate,
 	.changed				=	MSXChanged,
 	.buildReport			=	MSXBuildReport,
+	.buttons_offset			=	2,
+	.buttons_count			=	8,
+	.axes_offset			=	0,
+	.axes_count				=	2,
 };
 
 Gamepad *MSXGetGamepad(void)
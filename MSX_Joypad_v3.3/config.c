@@ -0,0 +1,251 @@
+/* Adapter configuration stored in EEPROM
+ * Copyright (C) 2024 Francis-Olivier Gradel, B.Eng.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * The author may be contacted at info@retronicdesign.com
+ *
+ */
+#include <avr/io.h>
+#include <avr/eeprom.h>
+#include <avr/pgmspace.h>
+#include <util/crc16.h>
+#include <string.h>
+#include "config.h"
+#include "boottime.h"
+
+/* The EEPROM is used as a journal of fixed size slots. Every save goes to
+ * the slot following the current one with the next sequence number, so the
+ * writes are spread over the whole EEPROM. The CRC is the last thing
+ * written: if power is lost during a save, the new slot does not check and
+ * the previous record, left untouched, is loaded on the next boot.
+ */
+#define CFG_SLOT_SIZE	64
+#define CFG_NUM_SLOTS	((E2END+1)/CFG_SLOT_SIZE)
+#define CFG_DATA_SIZE	(CFG_SLOT_SIZE-7)
+
+/* Packed with fixed width fields: the EEPROM layout is the same whatever
+ * the compiler, the host tests (test/config_test.c) read it as the AVR does.
+ */
+typedef struct __attribute__((packed)) {
+	uint8_t seq;		// Incremented on every save, the highest one wins
+	uint8_t version;	// CONFIG_VERSION of the firmware that saved it
+	uint8_t length;		// sizeof(Config) of the firmware that saved it
+	uint16_t owner;		// Hash of the product name, ignore other firmwares' records
+	uint8_t data[CFG_DATA_SIZE];
+	uint16_t crc;		// Over all the above, written last
+} ConfigSlot;
+
+// Fails to compile if Config outgrows a slot, or the slot is not packed
+typedef char config_fits_in_slot[(sizeof(Config) <= CFG_DATA_SIZE) ? 1 : -1];
+typedef char slot_is_packed[(sizeof(ConfigSlot) == CFG_SLOT_SIZE) ? 1 : -1];
+
+static const char productName[] PROGMEM = { USB_CFG_DEVICE_NAME };
+static const unsigned char defaultKeymap[] PROGMEM = { CFG_DEFAULT_KEYMAP };
+
+typedef char keymap_fits[(sizeof(defaultKeymap) <= CFG_KEYMAP_SIZE) ? 1 : -1];
+
+Config config;
+
+static ConfigSlot slot;				// Record being written
+static Config edit;					// CFG_CMD_WRITE applied, before it is checked
+static unsigned char cur_slot;
+static unsigned char cur_seq;
+static unsigned int owner;
+static unsigned char write_pos;		// Next byte of slot to write, CFG_SLOT_SIZE when idle
+static unsigned char save_pending;
+static unsigned char read_offset;
+
+static unsigned int configCrc(unsigned char *p, unsigned char len)
+{
+	unsigned int crc = 0xffff;
+
+	while (len--)
+		crc = _crc_ccitt_update(crc, *p++);
+
+	return crc;
+}
+
+static void configDefaults(void)
+{
+	unsigned char i;
+
+	config.center = CFG_DEFAULT_CENTER;
+	config.divider = CFG_DEFAULT_DIVIDER;
+	config.gain = CFG_DEFAULT_GAIN;
+
+	for (i=0; i<CFG_REMAP_SIZE; i++)
+		config.remap[i] = i;
+
+	memset(config.turbo_mask, 0, sizeof(config.turbo_mask));
+	config.turbo_rate = CFG_DEFAULT_TURBO_RATE;
+	config.turbo_duty = CFG_DEFAULT_TURBO_DUTY;
+
+	memset(config.keymap, 0, sizeof(config.keymap));
+	memcpy_P(config.keymap, defaultKeymap, sizeof(defaultKeymap));
+
+	config.get_report_poll = CFG_DEFAULT_GET_REPORT_POLL;
+	config.pack_reports = CFG_DEFAULT_PACK_REPORTS;
+}
+
+void configInit(void)
+{
+	unsigned char i, best = 0xff;
+
+	owner = configCrc((unsigned char *)productName, sizeof(productName));
+	write_pos = CFG_SLOT_SIZE;
+	save_pending = 0;
+	cur_slot = CFG_NUM_SLOTS-1;
+	cur_seq = 0;
+
+	configDefaults();
+
+	for (i=0; i<CFG_NUM_SLOTS; i++)
+	{
+		eeprom_read_block(&slot, (void *)(i*CFG_SLOT_SIZE), CFG_SLOT_SIZE);
+
+		if (slot.owner != owner)
+			continue;
+		if (slot.crc != configCrc((unsigned char *)&slot, CFG_SLOT_SIZE-2))
+			continue;
+
+		// Sequence numbers wrap, compare them as a signed distance
+		if (best == 0xff || (signed char)(slot.seq - cur_seq) > 0)
+		{
+			best = i;
+			cur_seq = slot.seq;
+		}
+	}
+
+	if (best != 0xff)
+	{
+		eeprom_read_block(&slot, (void *)(best*CFG_SLOT_SIZE), CFG_SLOT_SIZE);
+		memcpy(&config, slot.data, (slot.length < sizeof(Config)) ? slot.length : sizeof(Config));
+		cur_slot = best;
+	}
+}
+
+void configTask(void)
+{
+	if (write_pos >= CFG_SLOT_SIZE)
+	{
+		if (!save_pending)
+			return;
+		save_pending = 0;
+
+		// Snapshot the RAM copy, it may change again while we write
+		if (++cur_slot >= CFG_NUM_SLOTS)
+			cur_slot = 0;
+		memset(&slot, 0xff, sizeof(slot));
+		slot.seq = ++cur_seq;
+		slot.version = CONFIG_VERSION;
+		slot.length = sizeof(Config);
+		slot.owner = owner;
+		memcpy(slot.data, &config, sizeof(Config));
+		slot.crc = configCrc((unsigned char *)&slot, CFG_SLOT_SIZE-2);
+		write_pos = 0;
+	}
+
+	// One byte at a time, only when the previous write (~3.4ms) is done
+	if (!eeprom_is_ready())
+		return;
+
+	eeprom_update_byte((uint8_t *)(cur_slot*CFG_SLOT_SIZE + write_pos), ((unsigned char *)&slot)[write_pos]);
+	write_pos++;
+}
+
+/* Every field a driver or the host would get as is must be in range: a
+ * remap to a button that does not exist, a turbo the timer cannot make or
+ * a key code outside the keyboard descriptor.
+ */
+static unsigned char configValid(Config *c)
+{
+	unsigned char i, key;
+
+	for (i=0; i<CFG_REMAP_SIZE; i++)
+		if (c->remap[i] >= CFG_REMAP_SIZE && c->remap[i] != CFG_REMAP_DROP)
+			return 0;
+
+	if (c->turbo_rate < 1 || c->turbo_rate > CFG_TURBO_RATE_MAX)
+		return 0;
+	if (c->turbo_duty < 1 || c->turbo_duty > 99)
+		return 0;
+
+	for (i=0; i<CFG_KEYMAP_SIZE; i++)
+	{
+		key = c->keymap[i];
+		if (key > 0x65 && (key < 0xE0 || key > 0xE7))
+			return 0;
+	}
+
+	return 1;
+}
+
+unsigned char configFeatureWrite(unsigned char *data, unsigned char len)
+{
+	unsigned char i, offset;
+
+	switch (data[0])
+	{
+		case CFG_CMD_READ:
+			read_offset = data[1];
+			break;
+
+		case CFG_CMD_WRITE:
+			memcpy(&edit, &config, sizeof(Config));
+			offset = data[1];
+			for (i=2; i<len && offset<sizeof(Config); i++)
+				((unsigned char *)&edit)[offset++] = data[i];
+			if (!edit.divider)	// Used as a divisor by the pot drivers
+				edit.divider = 1;
+			if (!configValid(&edit))
+				return CFG_WRITE_REFUSED;
+			memcpy(&config, &edit, sizeof(Config));
+			return 1;
+
+		case CFG_CMD_SAVE:
+			save_pending = 1;
+			break;
+
+		case CFG_CMD_DEFAULTS:
+			configDefaults();
+			return 1;
+	}
+
+	return 0;
+}
+
+unsigned char configFeatureRead(unsigned char *buf, unsigned char size)
+{
+	unsigned char i, offset = read_offset;
+
+	buf[0] = CONFIG_VERSION;
+	buf[1] = sizeof(Config);
+	buf[2] = offset;
+
+	for (i=3; i<size; i++, offset++)
+	{
+#ifdef BOOT_TIMING
+		if (offset >= CFG_BOOT_TIME_OFFSET && offset < CFG_BOOT_TIME_OFFSET+sizeof(boot_stamps))
+		{
+			buf[i] = ((unsigned char *)boot_stamps)[offset-CFG_BOOT_TIME_OFFSET];
+			continue;
+		}
+#endif
+		buf[i] = (offset < sizeof(Config)) ? ((unsigned char *)&config)[offset] : 0xff;
+	}
+
+	return size;
+}
@@ -0,0 +1,268 @@
+/* Boot keyboard interface fed by the joystick report
+ * Copyright (C) 2024 Francis-Olivier Gradel, B.Eng.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * The author may be contacted at info@retronicdesign.com
+ *
+ */
+#include <avr/pgmspace.h>
+#include <string.h>
+#include "usbdrv/usbdrv.h"
+#include "config.h"
+#include "keyboard.h"
+
+#if USB_CFG_KEYBOARD
+
+/* The key report is never rebuilt from scratch. Each input that changed
+ * since the previous joystick report adds its key to a free slot or takes
+ * it out of its slot, modifiers (0xE0-0xE7) go to the modifier byte. With
+ * more than 6 keys held the extra ones are dropped until a slot frees up.
+ */
+#define KEY_MODIFIER_FIRST	0xE0
+#define KEY_MODIFIER_LAST	0xE7
+#define KEY_SLOTS			2	// report[2..7]
+
+#define AXIS_LOW	0x40	// Analog sticks count as a direction past these
+#define AXIS_HIGH	0xC0
+
+const char keyboard_usbHidReportDescriptor[] PROGMEM = {
+    0x05, 0x01,                    // USAGE_PAGE (Generic Desktop)
+    0x09, 0x06,                    // USAGE (Keyboard)
+    0xa1, 0x01,                    // COLLECTION (Application)
+    0x05, 0x07,                    //   USAGE_PAGE (Keyboard)
+    0x19, 0xe0,                    //   USAGE_MINIMUM (Keyboard LeftControl)
+    0x29, 0xe7,                    //   USAGE_MAXIMUM (Keyboard Right GUI)
+    0x15, 0x00,                    //   LOGICAL_MINIMUM (0)
+    0x25, 0x01,                    //   LOGICAL_MAXIMUM (1)
+    0x75, 0x01,                    //   REPORT_SIZE (1)
+    0x95, 0x08,                    //   REPORT_COUNT (8)
+    0x81, 0x02,                    //   INPUT (Data,Var,Abs)
+    0x95, 0x01,                    //   REPORT_COUNT (1)
+    0x75, 0x08,                    //   REPORT_SIZE (8)
+    0x81, 0x03,                    //   INPUT (Cnst,Var,Abs)
+    0x95, 0x05,                    //   REPORT_COUNT (5)
+    0x75, 0x01,                    //   REPORT_SIZE (1)
+    0x05, 0x08,                    //   USAGE_PAGE (LEDs)
+    0x19, 0x01,                    //   USAGE_MINIMUM (Num Lock)
+    0x29, 0x05,                    //   USAGE_MAXIMUM (Kana)
+    0x91, 0x02,                    //   OUTPUT (Data,Var,Abs)
+    0x95, 0x01,                    //   REPORT_COUNT (1)
+    0x75, 0x03,                    //   REPORT_SIZE (3)
+    0x91, 0x03,                    //   OUTPUT (Cnst,Var,Abs)
+    0x95, 0x06,                    //   REPORT_COUNT (6)
+    0x75, 0x08,                    //   REPORT_SIZE (8)
+    0x15, 0x00,                    //   LOGICAL_MINIMUM (0)
+    0x25, 0x65,                    //   LOGICAL_MAXIMUM (101)
+    0x05, 0x07,                    //   USAGE_PAGE (Keyboard)
+    0x19, 0x00,                    //   USAGE_MINIMUM (Reserved (no event indicated))
+    0x29, 0x65,                    //   USAGE_MAXIMUM (Keyboard Application)
+    0x81, 0x00,                    //   INPUT (Data,Ary,Abs)
+    0xc0                           // END_COLLECTION
+};
+
+// main.c puts the length in the configuration descriptor
+typedef char keyboard_descriptor_length[(sizeof(keyboard_usbHidReportDescriptor) == KEYBOARD_REPORT_DESCRIPTOR_LENGTH) ? 1 : -1];
+
+static unsigned char report[KEYBOARD_REPORT_SIZE];
+static unsigned long inputs;		// Inputs held, bit n is config.keymap[n]
+static unsigned char pending;
+static unsigned char idle_rate = 125;	// 4ms units, HID spec 7.2.4 default for keyboards
+static unsigned char idle_count;
+static unsigned char protocol = 1;		// Report protocol, both use the boot report
+static unsigned char kb_axes_offset;
+static unsigned char kb_axes_count;
+static unsigned char kb_buttons_offset;
+static unsigned char kb_buttons_bytes;
+static unsigned int kb_buttons_mask;
+
+void keyboardInit(unsigned char axes_offset, unsigned char axes_count, unsigned char buttons_offset, unsigned char buttons_count)
+{
+	if (buttons_count > CFG_KEYMAP_SIZE-KEY_BUTTON1)
+		buttons_count = CFG_KEYMAP_SIZE-KEY_BUTTON1;
+
+	kb_axes_offset = axes_offset;
+	kb_axes_count = axes_count;
+	kb_buttons_offset = buttons_offset;
+	kb_buttons_bytes = (buttons_count+7)/8;
+	kb_buttons_mask = (1UL<<buttons_count)-1;
+}
+
+static void keyPress(unsigned char key)
+{
+	unsigned char i;
+
+	if (key >= KEY_MODIFIER_FIRST && key <= KEY_MODIFIER_LAST)
+	{
+		report[0] |= 1<<(key-KEY_MODIFIER_FIRST);
+		return;
+	}
+
+	for (i=KEY_SLOTS; i<KEYBOARD_REPORT_SIZE; i++)
+	{
+		if (report[i] == key)	// Two inputs on the same key
+			return;
+		if (!report[i])
+		{
+			report[i] = key;
+			return;
+		}
+	}
+}
+
+static void keyRelease(unsigned char key)
+{
+	unsigned char i;
+
+	if (key >= KEY_MODIFIER_FIRST && key <= KEY_MODIFIER_LAST)
+	{
+		report[0] &= ~(1<<(key-KEY_MODIFIER_FIRST));
+		return;
+	}
+
+	// Keep the slots packed, some BIOSes stop at the first empty one
+	for (i=KEY_SLOTS; i<KEYBOARD_REPORT_SIZE; i++)
+	{
+		if (report[i] != key)
+			continue;
+		for (; i<KEYBOARD_REPORT_SIZE-1; i++)
+			report[i] = report[i+1];
+		report[i] = 0;
+		return;
+	}
+}
+
+static unsigned char keyHeld(unsigned char key)
+{
+	unsigned char i;
+
+	for (i=0; i<CFG_KEYMAP_SIZE; i++)
+		if ((inputs & (1UL<<i)) && config.keymap[i] == key)
+			return 1;
+
+	return 0;
+}
+
+void keyboardUpdate(unsigned char *r)
+{
+	unsigned long now = 0, delta;
+	unsigned int buttons = 0;
+	unsigned char i, key;
+
+	if (kb_axes_count)
+	{
+		if (r[kb_axes_offset+1] < AXIS_LOW)		now |= 1<<KEY_UP;
+		if (r[kb_axes_offset+1] > AXIS_HIGH)	now |= 1<<KEY_DOWN;
+		if (r[kb_axes_offset] < AXIS_LOW)		now |= 1<<KEY_LEFT;
+		if (r[kb_axes_offset] > AXIS_HIGH)		now |= 1<<KEY_RIGHT;
+	}
+
+	for (i=0; i<kb_buttons_bytes; i++)
+		buttons |= (unsigned int)r[kb_buttons_offset+i] << (8*i);
+	now |= (unsigned long)(buttons & kb_buttons_mask) << KEY_BUTTON1;
+
+	delta = now ^ inputs;
+	inputs = now;
+
+	for (i=0; delta; i++, delta >>= 1)
+	{
+		if (!(delta & 1))
+			continue;
+
+		key = config.keymap[i];
+		if (!key)
+			continue;
+
+		if (now & (1UL<<i))
+			keyPress(key);
+		else if (!keyHeld(key))
+			keyRelease(key);
+		pending = 1;
+	}
+}
+
+void keyboardCompile(void)
+{
+	unsigned char i;
+
+	// Held inputs may have changed keys, press them again
+	memset(report, 0, sizeof(report));
+	for (i=0; i<CFG_KEYMAP_SIZE; i++)
+		if ((inputs & (1UL<<i)) && config.keymap[i])
+			keyPress(config.keymap[i]);
+
+	pending = 1;
+}
+
+void keyboardTask(void)
+{
+	if (pending && usbInterruptIsReady3())
+	{
+		usbSetInterrupt3(report, sizeof(report));
+		pending = 0;
+	}
+}
+
+void keyboardTick(void)
+{
+	if (!idle_rate)
+		return;
+
+	if (idle_count > 4) {
+		idle_count -= 5;	/* 22 ms in units of 4 ms */
+	} else {
+		idle_count = idle_rate;
+		pending = 1;
+	}
+}
+
+unsigned char keyboardSetup(unsigned char data[8])
+{
+	usbRequest_t *rq = (void *)data;
+
+	if ((rq->bmRequestType & USBRQ_TYPE_MASK) != USBRQ_TYPE_CLASS)
+		return 0;
+
+	switch (rq->bRequest)
+	{
+		case USBRQ_HID_GET_REPORT:
+			usbMsgPtr = report;
+			return sizeof(report);
+
+		case USBRQ_HID_GET_IDLE:
+			usbMsgPtr = &idle_rate;
+			return 1;
+
+		case USBRQ_HID_SET_IDLE:
+			idle_rate = rq->wValue.bytes[1];
+			idle_count = idle_rate;
+			break;
+
+		case USBRQ_HID_GET_PROTOCOL:
+			usbMsgPtr = &protocol;
+			return 1;
+
+		case USBRQ_HID_SET_PROTOCOL:
+			protocol = rq->wValue.bytes[0];
+			break;
+
+		/* SET_REPORT carries the LEDs, there are none: returning 0
+		 * lets the driver acknowledge the data and drop it. */
+	}
+
+	return 0;
+}
+
+#endif // USB_CFG_KEYBOARD
@@ -23,9 +23,11 @@
 #include <avr/io.h>
 #include <avr/wdt.h>
 #include <avr/interrupt.h>  /* for sei() */
+#include <avr/sleep.h>
 #include <util/delay.h>     /* for _delay_ms() */
 #include <avr/pgmspace.h>   /* required by usbdrv.h */
 #include "usbdrv.h"
+#include "suspend.h"
 
 #include "../bootloader/fuses.h"
 #include "../bootloader/bootloader.h"
@@ -178,6 +180,17 @@ uchar   usbFunctionWrite(uchar *data, uchar len)
 	return len;
 }
 
+/* Set by the timer 2 interrupt, it wakes the CPU up from the idle sleep of
+ * the main loop and from suspendSleep() */
+static volatile uchar poll_tick;
+
+extern volatile schar usbRxLen;	// usbdrv.c, a packet waiting for usbPoll()
+
+ISR(TIMER2_COMPA_vect, ISR_NOBLOCK)	// Keep V-USB interrupt latency low
+{
+	poll_tick = 1;
+}
+
 /* ------------------------------------------------------------------------- */
 
 __attribute__ ((OS_main)) int main(void)
@@ -192,6 +205,16 @@ __attribute__ ((OS_main)) int main(void)
      */
 	jumptobootloader=0;
 	MacMouseInit();
+	suspendInit();	// The mouse owns PCINT2, it never suspends (suspend.h)
+
+	/* configure timer 2 for a rate of 12M/(1024 * 6) = 1.953kHz (~0.51ms) */
+	/* This is the poll tick of suspendTask() */
+	TCCR2A = (1<<WGM21);
+	TCCR2B =(1<<CS22)|(1<<CS21)|(1<<CS20);
+	OCR2A = 6;  // for 2kHz
+	TIMSK2 |= (1<<OCIE2A);
+	set_sleep_mode(SLEEP_MODE_IDLE);
+
     usbInit();
     usbDeviceDisconnect();  /* enforce re-enumeration, do this while interrupts are disabled! */
     _delay_ms(10);	// 10ms is enough to see the USB disconnection and reconnection
@@ -211,11 +234,36 @@ __attribute__ ((OS_main)) int main(void)
 			for(;;); // Let wdt reset the CPU
 		}
         usbPoll();
+		if(poll_tick)
+		{
+			poll_tick = 0;
+
+			/* No keep-alive for 3ms: the host suspended the bus */
+			if(suspendTask())
+			{
+				suspendSleep();
+				MacMouseInit();	// Moves while we slept are lost, start over from the pins
+				continue;
+			}
+		}
         if(usbInterruptIsReady()){
             /* called after every poll of the interrupt endpoint */
 		   UpdateReportBuffer();
             usbSetInterrupt((void *)&reportBuffer, sizeof(reportBuffer));
         }
+
+		/* Nothing to do until the next poll tick or USB interrupt, both
+		 * wake the CPU up. Interrupts stay off from the test to the sleep
+		 * instruction so that a tick cannot slip in between. */
+		cli();
+		if(!poll_tick && !usbRxLen && !usbInterruptIsReady())
+		{
+			sleep_enable();
+			sei();
+			sleep_cpu();
+			sleep_disable();
+		}
+		sei();
     }
 }
 
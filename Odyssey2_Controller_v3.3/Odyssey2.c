@@ -26,6 +26,7 @@
 #include <string.h>
 #include "usbconfig.h"
 #include "Odyssey2.h"
+#include "debounce.h"
 
 static char Odyssey2Init(void);
 static void Odyssey2Update(void);
@@ -35,6 +36,8 @@ static char Odyssey2BuildReport(unsigned char *reportBuffer, char id);
 static unsigned char last_update_state=0;
 static unsigned char last_reported_state=0;
 
+static Debouncer debouncer;
+
 static char Odyssey2Init(void)
 {
 	/* PIN1 = PB0 = (O,0) GND
@@ -60,12 +63,14 @@ static char Odyssey2Init(void)
 	PORTC &= ~((1<<PC0)|(1<<PC2)|(1<<PC1));
 	PORTC |= ((1<<PC3));
 
+	debounceInit(&debouncer, 0xff);
+
 	return 0;
 }
 
 static void Odyssey2Update(void)
 {
-	last_update_state = ((PINB&((1<<PB1)|(1<<PB2)|(1<<PB3)|(1<<PB4))) | ((PINC&(1<<PC3))>>3));
+	last_update_state = debounce(&debouncer, ((PINB&((1<<PB1)|(1<<PB2)|(1<<PB3)|(1<<PB4))) | ((PINC&(1<<PC3))>>3)));
 }
 
 static char Odyssey2Changed(char id)
@@ -128,7 +133,7 @@ const char Odyssey2_usbHidReportDescriptor[] PROGMEM = {
     0x15, 0x00,                    //     LOGICAL_MINIMUM (0)
     0x26, 0xff, 0x00,              //     LOGICAL_MAXIMUM (255)
     0x75, 0x08,                    //     REPORT_SIZE (8)
-    0x95, 0x01,                    //     REPORT_COUNT (1)
+    0x95, 0x08,                    //     REPORT_COUNT (8)
     0xb2, 0x02, 0x01,              //     FEATURE (Data,Var,Abs,Buf)	
     0xc0,                          //   END_COLLECTION
     0xc0                           // END_COLLECTION
@@ -164,6 +169,10 @@ Gamepad Odyssey2Joy = {
 	.update					=	Odyssey2Update,
 	.changed				=	Odyssey2Changed,
 	.buildReport			=	Odyssey2BuildReport,
+	.buttons_offset			=	2,
+	.buttons_count			=	8,
+	.axes_offset			=	0,
+	.axes_count				=	2,
 };
 
 Gamepad *Odyssey2GetGamepad(void)
@@ -26,6 +26,7 @@
 #include <string.h>
 #include "usbconfig.h"
 #include "RODDR.h"
+#include "debounce.h"
 
 static char DDRDancePadInit(void);
 static void DDRDancePadUpdate(void);
@@ -35,6 +36,8 @@ static char DDRDancePadBuildReport(unsigned char *reportBuffer, char id);
 static unsigned char last_update_state=0;
 static unsigned char last_reported_state=0;
 
+static Debouncer debouncer;
+
 static char DDRDancePadInit(void)
 {
 
@@ -59,12 +62,14 @@ static char DDRDancePadInit(void)
 	PORTC &= ~((1<<PC1)|(1<<PC3)|(1<<PC0)|(1<<PC2));
 	PORTD |= (1<<PD7);
 
+	debounceInit(&debouncer, 0xff);
+
 	return 0;
 }
 
 static void DDRDancePadUpdate(void)
 {
-	last_update_state = ((PINB&0x2F) | ((PIND&0x80)));
+	last_update_state = debounce(&debouncer, ((PINB&0x2F) | ((PIND&0x80))));
 }
 
 static char DDRDancePadChanged(char id)
@@ -112,7 +117,7 @@ const char DDRDancePad_usbHidReportDescriptor[] PROGMEM = {
     0x15, 0x00,                    //     LOGICAL_MINIMUM (0)
     0x26, 0xff, 0x00,              //     LOGICAL_MAXIMUM (255)
     0x75, 0x08,                    //     REPORT_SIZE (8)
-    0x95, 0x01,                    //     REPORT_COUNT (1)
+    0x95, 0x08,                    //     REPORT_COUNT (8)
     0xb2, 0x02, 0x01,              //     FEATURE (Data,Var,Abs,Buf)	
     0xc0,                          //   END_COLLECTION
     0xc0                           // END_COLLECTION
@@ -148,6 +153,8 @@ Gamepad DDRDancePadJoy = {
 	.update					=	DDRDancePadUpdate,
 	.changed				=	DDRDancePadChanged,
 	.buildReport			=	DDRDancePadBuildReport,
+	.buttons_offset			=	0,
+	.buttons_count			=	8,
 };
 
 Gamepad *DDRDancePadGetGamepad(void)
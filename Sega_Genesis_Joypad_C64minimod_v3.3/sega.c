@@ -25,6 +25,7 @@
 #include <string.h>
 #include "usbconfig.h"
 #include "sega.h"
+#include "config.h"
 
 static char SegaInit(void);
 static void SegaUpdate(void);
@@ -127,7 +128,7 @@ static char SegaBuildReport(unsigned char *reportBuffer, char id)
 	
 	if (reportBuffer)
 	{
-		y = x = 0x7f;
+		y = x = config.center;
 
 		tmp = ~last_update_state;
 		
@@ -182,7 +183,7 @@ const char Sega_usbHidReportDescriptor[] PROGMEM = {
     0x15, 0x00,         //          LOGICAL_MINIMUM (0)
     0x26, 0xff, 0x00,   //          LOGICAL_MAXIMUM (255)
     0x75, 0x08,         //          REPORT_SIZE (8)
-    0x95, 0x01,         //          REPORT_COUNT (1)
+    0x95, 0x08,         //          REPORT_COUNT (8)
     0xb2, 0x02, 0x01,   //          FEATURE (Data,Var,Abs,Buf)	
 	0xc0,				//		END_COLLECTION
     0xc0				// END_COLLECTION
@@ -217,6 +218,10 @@ Gamepad SegaJoy = {
 	.update					=	SegaUpdate,
 	.changed				=	SegaChanged,
 	.buildReport			=	SegaBuildReport,
+	.buttons_offset			=	2,
+	.buttons_count			=	16,
+	.axes_offset			=	0,
+	.axes_count				=	2,
 };
 
 Gamepad *SegaGetGamepad(void)
@@ -22,14 +22,17 @@
 #include <avr/io.h>
 #include <util/delay.h>
 #include <avr/pgmspace.h>
+#include <avr/wdt.h>
 #include <string.h>
 #include "usbconfig.h"
 #include "sega.h"
+#include "config.h"
 
 static char SegaInit(void);
 static void SegaUpdate(void);
 static char SegaChanged(char id);
 static char SegaBuildReport(unsigned char *reportBuffer, char id);
+static char SegaPeekReport(unsigned char *reportBuffer, char id);
 
 static unsigned int last_update_state=0;
 static unsigned int last_reported_state=0;
@@ -39,6 +42,52 @@ static unsigned char but3_6=0;
 #define SELECT_HIGH()	PORTB |= (1<<PB5)
 #define SELECT_LOW()	PORTB &= ~(1<<PB5)
 
+/* Besides plain pads, two devices answer a nibble protocol on the same port.
+ * SELECT (TH) low starts a frame, then each nibble is requested by toggling
+ * pin 9 (TR, START/BUTC of a plain pad) and is valid once the device copies
+ * TR on pin 6 (TL, BUTA/BUTB). Both start with two acknowledge nibbles.
+ *
+ * Sega Team Player: 4 nibbles pad type (port A to D), then for each pad
+ * RLDU, SACB, and MXYZ for a 6 buttons pad. All active low. Those nibbles
+ * line up with the last_update_state format below, so a pad read through the
+ * tap is stored and reported like a directly connected one.
+ *
+ * Sega Mega Mouse: flags (Y over, X over, Y sign, X sign), buttons (Start,
+ * Middle, Right, Left, active high), then X and Y, high nibble first.
+ *
+ * The EA 4-Way Play is not supported: it selects the pad through the second
+ * console port, which this single port adapter does not have.
+ */
+#define TR_HIGH()		PORTC |= (1<<PC2)
+#define TR_LOW()		PORTC &= ~(1<<PC2)
+#define TL_STATE()		((PINB>>PB4)&1)
+
+#define MODE_PAD		0
+#define MODE_TAP		1
+#define MODE_MOUSE		2
+
+#define TAP_PADS		4
+#define TAP_FEATURE_ID	(TAP_PADS+1)
+#define TAP_3BUTTON		0x0
+#define TAP_6BUTTON		0x1
+#define TAP_RELEASED	0x0FFF
+#define MOUSE_NIBBLES	8		// After SELECT low, acknowledges included
+#define NIBBLE_SPIN		40		// TL polls per nibble before handing back to the main loop
+#define NIBBLE_STALL	16		// update() calls without progress before dropping the frame
+#define PLUG_CHECKS		200		// Consecutive foreign reads (100ms) before checking with SegaDetect()
+
+static unsigned char mode=MODE_PAD;
+static unsigned int pad_state[TAP_PADS] = { TAP_RELEASED, TAP_RELEASED, TAP_RELEASED, TAP_RELEASED };	// Same format as last_update_state
+static unsigned int pad_reported[TAP_PADS] = { TAP_RELEASED, TAP_RELEASED, TAP_RELEASED, TAP_RELEASED };
+static unsigned char pad_type[TAP_PADS];
+static int mouse_x, mouse_y;					// Motion not reported yet
+static unsigned char mouse_buttons, mouse_reported;
+static unsigned char frame[6+TAP_PADS*3];		// Nibbles of the frame being read
+static unsigned char frame_step=0;				// Next nibble+2, 0 when idle
+static unsigned char frame_last;
+static unsigned char frame_stall;
+static unsigned char plug_count=0;
+
 static char SegaInit(void)
 {
 
@@ -65,9 +114,172 @@ static char SegaInit(void)
 	DDRD |= ((1<<PD7));
 	PORTD &= ~(1<<PD7);
 
+	if(mode != MODE_PAD)	// TR is driven by us
+	{
+		TR_HIGH();
+		DDRC |= (1<<PC2);
+	}
+
 	return 0;
 }
 
+/* The first two nibbles (SELECT high, then low) tell the devices apart:
+ * 0011 1111 for the tap, 0000 1011 for the mouse. A pad never reads LEFT
+ * and RIGHT together, so it cannot produce either.
+ */
+static unsigned char SegaDetect(void)
+{
+	unsigned char id;
+
+	SELECT_HIGH();
+	_delay_us(50);
+	id = (PINB&0x0F)<<4;
+
+	SELECT_LOW();
+	_delay_us(50);
+	id |= (PINB&0x0F);
+
+	SELECT_HIGH();
+	_delay_us(50);
+
+	if (id == 0x3F)
+		return MODE_TAP;
+	if (id == 0x0B)
+		return MODE_MOUSE;
+	return MODE_PAD;
+}
+
+/* The descriptor matches the device attached at boot. When another kind of
+ * device is plugged in, let the watchdog reset us: hardwareInit() forces a
+ * USB reconnection and the new device is enumerated with its own descriptor.
+ */
+static void SegaReplug(void)
+{
+	wdt_enable(WDTO_15MS);
+	for(;;);
+}
+
+static void SegaFrameEnd(char complete)
+{
+	unsigned char i, n;
+	int x, y;
+
+	SELECT_HIGH();
+	TR_HIGH();
+	frame_step = 0;
+
+	if (!complete)
+	{
+		if (SegaDetect() != mode)
+			SegaReplug();
+
+		// Still there but not answering, release everything
+		for (i=0; i<TAP_PADS; i++)
+			pad_state[i] = TAP_RELEASED;
+		mouse_buttons = 0;
+		return;
+	}
+
+	if (mode == MODE_MOUSE)
+	{
+		x = ((frame[4]<<4)|frame[5]);
+		y = ((frame[6]<<4)|frame[7]);
+		if (frame[2]&0x01)
+			x -= 256;
+		if (frame[2]&0x02)
+			y -= 256;
+
+		// Accumulate, nothing is lost when the host polls slower than us.
+		// The mouse counts Y up, HID counts it down.
+		if (mouse_x > -1000 && mouse_x < 1000)
+			mouse_x += x;
+		if (mouse_y > -1000 && mouse_y < 1000)
+			mouse_y -= y;
+		mouse_buttons = frame[3];
+		return;
+	}
+
+	n = 6;
+	for (i=0; i<TAP_PADS; i++)
+	{
+		pad_type[i] = frame[2+i];
+		pad_state[i] = TAP_RELEASED;
+
+		if (pad_type[i] != TAP_3BUTTON && pad_type[i] != TAP_6BUTTON)
+			continue;	// Empty port, or a mouse
+
+		pad_state[i] = (TAP_RELEASED & 0xFF00) | frame[n] | (frame[n+1]<<4);
+		n += 2;
+		if (pad_type[i] == TAP_6BUTTON)
+			pad_state[i] = (pad_state[i] & 0xF0FF) | ((unsigned int)frame[n++]<<8);
+	}
+}
+
+/* Non blocking: reads as many nibbles as the device acknowledges within
+ * NIBBLE_SPIN polls and carries on from there at the next update(), so
+ * usbPoll() keeps running between them. A full 4 pads tap frame is 20
+ * nibbles and normally completes in two calls.
+ */
+static void SegaFrameUpdate(void)
+{
+	unsigned char spin, i, n;
+
+	if (frame_step == 0)	// Start a frame, give the device a poll period to see SELECT
+	{
+		frame_last = (mode == MODE_MOUSE) ? 2+MOUSE_NIBBLES : 0xFF;
+		frame_stall = 0;
+		SELECT_LOW();
+		frame_step = 1;
+		return;
+	}
+
+	if (frame_step == 1)
+	{
+		TR_LOW();
+		frame_step = 2;
+	}
+
+	for (;;)
+	{
+		// Nibble frame_step is valid once TL follows TR
+		for (spin=NIBBLE_SPIN; TL_STATE() != (frame_step&1); spin--)
+		{
+			if (!spin)
+			{
+				if (++frame_stall >= NIBBLE_STALL)
+					SegaFrameEnd(0);
+				return;
+			}
+		}
+		frame_stall = 0;
+		frame[frame_step-2] = PINB&0x0F;
+
+		if (mode == MODE_TAP && frame_step == 7)	// Pad types known, so is the length
+		{
+			n = 0;
+			for (i=0; i<TAP_PADS; i++)
+			{
+				if (frame[2+i] == TAP_3BUTTON)
+					n += 2;
+				else if (frame[2+i] == TAP_6BUTTON)
+					n += 3;
+			}
+			frame_last = 8+n;
+		}
+
+		if (++frame_step >= frame_last)
+		{
+			SegaFrameEnd(1);
+			return;
+		}
+
+		if (frame_step&1)
+			TR_HIGH();
+		else
+			TR_LOW();
+	}
+}
+
 /* last_update state format:
  * 
  * 15 14 13    12   11    10 9 8 7     6    5    4    3     2    1    0
@@ -78,6 +290,12 @@ static void SegaUpdate(void)
 {
 	unsigned int i;
 
+	if(mode != MODE_PAD)
+	{
+		SegaFrameUpdate();
+		return;
+	}
+
 	for(i=0;i<4;i++)
 	{
 		SELECT_HIGH();
@@ -87,6 +305,22 @@ static void SegaUpdate(void)
 		if(i==0)	// Read UP/DOWN/LEFT/RIGHT/BUTB/BUTC
 		{
 			last_update_state = 0x0000 | (unsigned int)(PINB&0x1F) | (unsigned int)((PINC&0x04)<<3);
+
+			/* LEFT and RIGHT together for a while: a tap or a mouse may
+			 * have been plugged in. A worn or pressed hard D-pad can read
+			 * the same, only its ID nibbles tell it apart.
+			 */
+			if ((last_update_state&0x0C) == 0)
+			{
+				if (++plug_count >= PLUG_CHECKS)
+				{
+					plug_count = 0;
+					if (SegaDetect() != MODE_PAD)
+						SegaReplug();
+				}
+			}
+			else
+				plug_count = 0;
 		}
 
 		else if(i==2)	// Read MODE/X/Y/Z
@@ -115,47 +349,114 @@ static void SegaUpdate(void)
 
 static char SegaChanged(char id)
 {
+	if(mode == MODE_TAP)
+		return (pad_state[id-1] != pad_reported[id-1]);
+	if(mode == MODE_MOUSE)
+		return (mouse_buttons != mouse_reported || mouse_x || mouse_y);
+
 	return (last_update_state != last_reported_state);
 }
 
 #define REPORT_SIZE 3
 
-static char SegaBuildReport(unsigned char *reportBuffer, char id)
+static void SegaPadReport(unsigned char *reportBuffer, unsigned int state, char six)
 {
 	int x,y;
 	unsigned int tmp;
 	
-	if (reportBuffer)
+	y = x = config.center;
+
+	tmp = ~state;
+	
+	if (tmp&(1<<PB3)) { x = 0xff; }
+	if (tmp&(1<<PB2)) { x = 0x00; }
+	if (tmp&(1<<PB1)) { y = 0xff; }
+	if (tmp&(1<<PB0)) { y = 0x00; }
+
+	reportBuffer[0] = x;
+	reportBuffer[1] = y;
+	reportBuffer[2] = 0;
+	if (tmp&(1<<6)) reportBuffer[2] |= (1<<0);
+	if (tmp&(1<<4)) reportBuffer[2] |= (1<<1);
+	if (tmp&(1<<5)) reportBuffer[2] |= (1<<2);
+	if (tmp&(1<<7)) reportBuffer[2] |= (1<<3);
+	if(six)	// If it's a 6 buttons controller, populate x,y,z,mode buttons
 	{
-		y = x = 0x80;
+		if (tmp&(1<<10)) reportBuffer[2] |= (1<<4);
+		if (tmp&(1<<9)) reportBuffer[2] |= (1<<5);
+		if (tmp&(1<<8)) reportBuffer[2] |= (1<<6);
+		if (tmp&(1<<11)) reportBuffer[2] |= (1<<7);
+	}
+}
 
-		tmp = ~last_update_state;
-		
-		if (tmp&(1<<PB3)) { x = 0xff; }
-		if (tmp&(1<<PB2)) { x = 0x00; }
-		if (tmp&(1<<PB1)) { y = 0xff; }
-		if (tmp&(1<<PB0)) { y = 0x00; }
-
-		reportBuffer[0] = x;
-		reportBuffer[1] = y;
-		reportBuffer[2] = 0;
-		if (tmp&(1<<6)) reportBuffer[2] |= (1<<0);
-		if (tmp&(1<<4)) reportBuffer[2] |= (1<<1);
-		if (tmp&(1<<5)) reportBuffer[2] |= (1<<2);
-		if (tmp&(1<<7)) reportBuffer[2] |= (1<<3);
-		if(!but3_6)	// If it's a 6 buttons controller, populate x,y,z,mode buttons
+static signed char SegaMouseClip(int v)
+{
+	if (v > 127)
+		return 127;
+	if (v < -127)
+		return -127;
+	return v;
+}
+
+/* consume: mark the state as reported and take the motion reported away */
+static char SegaReport(unsigned char *reportBuffer, char id, char consume)
+{
+	signed char x, y;
+
+	if(mode == MODE_MOUSE)	// [buttons, X, Y], the rest of the motion goes in the next report
+	{
+		if (reportBuffer)
+		{
+			x = SegaMouseClip(mouse_x);
+			y = SegaMouseClip(mouse_y);
+			if (consume)
+			{
+				mouse_x -= x;
+				mouse_y -= y;
+			}
+			reportBuffer[0] = mouse_buttons;
+			reportBuffer[1] = x;
+			reportBuffer[2] = y;
+		}
+		if (consume)
+			mouse_reported = mouse_buttons;
+
+		return REPORT_SIZE;
+	}
+
+	if(mode == MODE_TAP)	// [report ID, X, Y, buttons] for pad id
+	{
+		if (id < 1 || id > TAP_PADS)
+			id = 1;
+		if (reportBuffer)
 		{
-			if (tmp&(1<<10)) reportBuffer[2] |= (1<<4);
-			if (tmp&(1<<9)) reportBuffer[2] |= (1<<5);
-			if (tmp&(1<<8)) reportBuffer[2] |= (1<<6);
-			if (tmp&(1<<11)) reportBuffer[2] |= (1<<7);
+			reportBuffer[0] = id;
+			SegaPadReport(reportBuffer+1, pad_state[id-1], pad_type[id-1] == TAP_6BUTTON);
 		}
+		if (consume)
+			pad_reported[id-1] = pad_state[id-1];
+
+		return REPORT_SIZE+1;
 	}
-	last_reported_state = last_update_state;
+
+	if (reportBuffer)
+		SegaPadReport(reportBuffer, last_update_state, !but3_6);
+	if (consume)
+		last_reported_state = last_update_state;
 
 	return REPORT_SIZE;
 }
 
+static char SegaBuildReport(unsigned char *reportBuffer, char id)
+{
+	return SegaReport(reportBuffer, id, 1);
+}
+
+static char SegaPeekReport(unsigned char *reportBuffer, char id)
+{
+	return SegaReport(reportBuffer, id, 0);
+}
+
 const char Sega_usbHidReportDescriptor[] PROGMEM = {
 	0x05, 0x01,			// USAGE_PAGE (Generic Desktop)
     0x09, 0x04,			// USAGE (Joystick)
@@ -181,12 +482,152 @@ const char Sega_usbHidReportDescriptor[] PROGMEM = {
     0x15, 0x00,         //          LOGICAL_MINIMUM (0)
     0x26, 0xff, 0x00,   //          LOGICAL_MAXIMUM (255)
     0x75, 0x08,         //          REPORT_SIZE (8)
-    0x95, 0x01,         //          REPORT_COUNT (1)
+    0x95, 0x08,         //          REPORT_COUNT (8)
     0xb2, 0x02, 0x01,   //          FEATURE (Data,Var,Abs,Buf)	
 	0xc0,				//		END_COLLECTION
     0xc0,				// END_COLLECTION
 };
 
+/* One joystick per Team Player port, each with its own report ID. The feature
+ * report gets an ID too, as required once report IDs are used.
+ */
+const char SegaTap_usbHidReportDescriptor[] PROGMEM = {
+	0x05, 0x01,			// USAGE_PAGE (Generic Desktop)
+    0x09, 0x04,			// USAGE (Joystick)
+    0xa1, 0x01,			//	COLLECTION (Application)
+    0x85, 1,			//		REPORT_ID (1)
+    0x09, 0x01,			//		USAGE (Pointer)
+    0xa1, 0x00,			//		COLLECTION (Physical)
+	0x09, 0x30,			//			USAGE (X)
+    0x09, 0x31,			//			USAGE (Y)
+    0x15, 0x00,			//			LOGICAL_MINIMUM (0)
+    0x26, 0xff, 0x00,	//			LOGICAL_MAXIMUM (255)
+    0x75, 0x08,			//			REPORT_SIZE (8)
+    0x95, 0x02,			//			REPORT_COUNT (2)
+    0x81, 0x02,			//			INPUT (Data,Var,Abs)
+    0x05, 0x09,			//			USAGE_PAGE (Button)
+    0x19, 1,			//   		USAGE_MINIMUM (Button 1)
+    0x29, 8,			//   		USAGE_MAXIMUM (Button 8)
+    0x15, 0x00,			//   		LOGICAL_MINIMUM (0)
+    0x25, 0x01,			//   		LOGICAL_MAXIMUM (1)
+    0x75, 1,			// 			REPORT_SIZE (1)
+    0x95, 8,			//			REPORT_COUNT (8)
+    0x81, 0x02,			//			INPUT (Data,Var,Abs)
+    0x85, TAP_FEATURE_ID,	//			REPORT_ID (5)
+	0x09, 0x00,         //          USAGE (Undefined) // Used to trig bootloader when SET FEATURE
+    0x15, 0x00,         //          LOGICAL_MINIMUM (0)
+    0x26, 0xff, 0x00,   //          LOGICAL_MAXIMUM (255)
+    0x75, 0x08,         //          REPORT_SIZE (8)
+    0x95, 0x07,         //          REPORT_COUNT (7)
+    0xb2, 0x02, 0x01,   //          FEATURE (Data,Var,Abs,Buf)
+	0xc0,				//		END_COLLECTION
+    0xc0,				// END_COLLECTION
+	0x05, 0x01,			// USAGE_PAGE (Generic Desktop)
+    0x09, 0x04,			// USAGE (Joystick)
+    0xa1, 0x01,			//	COLLECTION (Application)
+    0x85, 2,			//		REPORT_ID (2)
+    0x09, 0x01,			//		USAGE (Pointer)
+    0xa1, 0x00,			//		COLLECTION (Physical)
+	0x09, 0x30,			//			USAGE (X)
+    0x09, 0x31,			//			USAGE (Y)
+    0x15, 0x00,			//			LOGICAL_MINIMUM (0)
+    0x26, 0xff, 0x00,	//			LOGICAL_MAXIMUM (255)
+    0x75, 0x08,			//			REPORT_SIZE (8)
+    0x95, 0x02,			//			REPORT_COUNT (2)
+    0x81, 0x02,			//			INPUT (Data,Var,Abs)
+    0x05, 0x09,			//			USAGE_PAGE (Button)
+    0x19, 1,			//   		USAGE_MINIMUM (Button 1)
+    0x29, 8,			//   		USAGE_MAXIMUM (Button 8)
+    0x15, 0x00,			//   		LOGICAL_MINIMUM (0)
+    0x25, 0x01,			//   		LOGICAL_MAXIMUM (1)
+    0x75, 1,			// 			REPORT_SIZE (1)
+    0x95, 8,			//			REPORT_COUNT (8)
+    0x81, 0x02,			//			INPUT (Data,Var,Abs)
+	0xc0,				//		END_COLLECTION
+    0xc0,				// END_COLLECTION
+	0x05, 0x01,			// USAGE_PAGE (Generic Desktop)
+    0x09, 0x04,			// USAGE (Joystick)
+    0xa1, 0x01,			//	COLLECTION (Application)
+    0x85, 3,			//		REPORT_ID (3)
+    0x09, 0x01,			//		USAGE (Pointer)
+    0xa1, 0x00,			//		COLLECTION (Physical)
+	0x09, 0x30,			//			USAGE (X)
+    0x09, 0x31,			//			USAGE (Y)
+    0x15, 0x00,			//			LOGICAL_MINIMUM (0)
+    0x26, 0xff, 0x00,	//			LOGICAL_MAXIMUM (255)
+    0x75, 0x08,			//			REPORT_SIZE (8)
+    0x95, 0x02,			//			REPORT_COUNT (2)
+    0x81, 0x02,			//			INPUT (Data,Var,Abs)
+    0x05, 0x09,			//			USAGE_PAGE (Button)
+    0x19, 1,			//   		USAGE_MINIMUM (Button 1)
+    0x29, 8,			//   		USAGE_MAXIMUM (Button 8)
+    0x15, 0x00,			//   		LOGICAL_MINIMUM (0)
+    0x25, 0x01,			//   		LOGICAL_MAXIMUM (1)
+    0x75, 1,			// 			REPORT_SIZE (1)
+    0x95, 8,			//			REPORT_COUNT (8)
+    0x81, 0x02,			//			INPUT (Data,Var,Abs)
+	0xc0,				//		END_COLLECTION
+    0xc0,				// END_COLLECTION
+	0x05, 0x01,			// USAGE_PAGE (Generic Desktop)
+    0x09, 0x04,			// USAGE (Joystick)
+    0xa1, 0x01,			//	COLLECTION (Application)
+    0x85, 4,			//		REPORT_ID (4)
+    0x09, 0x01,			//		USAGE (Pointer)
+    0xa1, 0x00,			//		COLLECTION (Physical)
+	0x09, 0x30,			//			USAGE (X)
+    0x09, 0x31,			//			USAGE (Y)
+    0x15, 0x00,			//			LOGICAL_MINIMUM (0)
+    0x26, 0xff, 0x00,	//			LOGICAL_MAXIMUM (255)
+    0x75, 0x08,			//			REPORT_SIZE (8)
+    0x95, 0x02,			//			REPORT_COUNT (2)
+    0x81, 0x02,			//			INPUT (Data,Var,Abs)
+    0x05, 0x09,			//			USAGE_PAGE (Button)
+    0x19, 1,			//   		USAGE_MINIMUM (Button 1)
+    0x29, 8,			//   		USAGE_MAXIMUM (Button 8)
+    0x15, 0x00,			//   		LOGICAL_MINIMUM (0)
+    0x25, 0x01,			//   		LOGICAL_MAXIMUM (1)
+    0x75, 1,			// 			REPORT_SIZE (1)
+    0x95, 8,			//			REPORT_COUNT (8)
+    0x81, 0x02,			//			INPUT (Data,Var,Abs)
+	0xc0,				//		END_COLLECTION
+    0xc0,				// END_COLLECTION
+};
+
+const char SegaMouse_usbHidReportDescriptor[] PROGMEM = {
+    0x05, 0x01,			// USAGE_PAGE (Generic Desktop)
+    0x09, 0x02,			// USAGE (Mouse)
+    0xa1, 0x01,			//	COLLECTION (Application)
+    0x09, 0x01,			//		USAGE (Pointer)
+    0xa1, 0x00,			//		COLLECTION (Physical)
+    0x05, 0x09,			//			USAGE_PAGE (Button)
+    0x19, 0x01,			//			USAGE_MINIMUM (Button 1)
+    0x29, 0x04,			//			USAGE_MAXIMUM (Button 4)
+    0x15, 0x00,			//			LOGICAL_MINIMUM (0)
+    0x25, 0x01,			//			LOGICAL_MAXIMUM (1)
+    0x95, 0x04,			//			REPORT_COUNT (4)
+    0x75, 0x01,			//			REPORT_SIZE (1)
+    0x81, 0x02,			//			INPUT (Data,Var,Abs)
+    0x95, 0x01,			//			REPORT_COUNT (1)
+    0x75, 0x04,			//			REPORT_SIZE (4)
+    0x81, 0x03,			//			INPUT (Const,Var,Abs)
+    0x05, 0x01,			//			USAGE_PAGE (Generic Desktop)
+    0x09, 0x30,			//			USAGE (X)
+    0x09, 0x31,			//			USAGE (Y)
+    0x15, 0x81,			//			LOGICAL_MINIMUM (-127)
+    0x25, 0x7f,			//			LOGICAL_MAXIMUM (127)
+    0x75, 0x08,			//			REPORT_SIZE (8)
+    0x95, 0x02,			//			REPORT_COUNT (2)
+    0x81, 0x06,			//			INPUT (Data,Var,Rel)
+	0x09, 0x00,         //          USAGE (Undefined) // Used to trig bootloader when SET FEATURE
+    0x15, 0x00,         //          LOGICAL_MINIMUM (0)
+    0x26, 0xff, 0x00,   //          LOGICAL_MAXIMUM (255)
+    0x75, 0x08,         //          REPORT_SIZE (8)
+    0x95, 0x08,         //          REPORT_COUNT (8)
+    0xb2, 0x02, 0x01,   //          FEATURE (Data,Var,Abs,Buf)
+	0xc0,				//		END_COLLECTION
+    0xc0,				// END_COLLECTION
+};
+
 #define USBDESCR_DEVICE         1
 
 // This is the same descriptor as in devdesc.c, but the product id is 0x0a99 
@@ -216,6 +657,11 @@ Gamepad SegaJoy = {
 	.update					=	SegaUpdate,
 	.changed				=	SegaChanged,
 	.buildReport			=	SegaBuildReport,
+	.peekReport			=	SegaPeekReport,
+	.buttons_offset			=	2,
+	.buttons_count			=	8,
+	.axes_offset			=	0,
+	.axes_count				=	2,
 };
 
 Gamepad *SegaGetGamepad(void)
@@ -223,6 +669,26 @@ Gamepad *SegaGetGamepad(void)
 	SegaJoy.reportDescriptor = (void*)Sega_usbHidReportDescriptor;
 	SegaJoy.deviceDescriptor = (void*)Sega_usbDescrDevice;
 
+	SegaInit();
+	_delay_ms(10);	// Let the device power up
+	mode = SegaDetect();
+	if(mode == MODE_TAP)
+	{
+		SegaJoy.num_reports = TAP_PADS;
+		SegaJoy.reportDescriptor = (void*)SegaTap_usbHidReportDescriptor;
+		SegaJoy.reportDescriptorSize = sizeof(SegaTap_usbHidReportDescriptor);
+		SegaJoy.buttons_offset = 3;
+		SegaJoy.axes_offset = 1;
+		SegaJoy.feature_report_id = TAP_FEATURE_ID;
+	}
+	else if(mode == MODE_MOUSE)
+	{
+		SegaJoy.reportDescriptor = (void*)SegaMouse_usbHidReportDescriptor;
+		SegaJoy.reportDescriptorSize = sizeof(SegaMouse_usbHidReportDescriptor);
+		SegaJoy.buttons_offset = 0;
+		SegaJoy.axes_count = 0;
+	}
+
 	return &SegaJoy;
 }
 
@@ -26,6 +26,7 @@
 #include <string.h>
 #include "usbconfig.h"
 #include "TI99.h"
+#include "debounce.h"
 
 static char TI99StyleInit(void);
 static void TI99StyleUpdate(void);
@@ -35,6 +36,8 @@ static char TI99StyleBuildReport(unsigned char *reportBuffer, char id);
 volatile unsigned char last_update_state=0;
 volatile unsigned char last_reported_state=0;
 
+static Debouncer debouncer;
+
 static char TI99StyleInit(void)
 {
 
@@ -59,12 +62,14 @@ static char TI99StyleInit(void)
 	DDRC |= ((1<<PC3)|(1<<PC1));
 	PORTC &= ~((1<<PC1)|(1<<PC3));
 
+	debounceInit(&debouncer, 0xff);
+
 	return 0;
 }
 
 static void TI99StyleUpdate(void)
 {
-	last_update_state = ((PINB&0x3c) | (PIND&0x80));
+	last_update_state = debounce(&debouncer, ((PINB&0x3c) | (PIND&0x80)));
 }
 
 static char TI99StyleChanged(char id)
@@ -127,7 +132,7 @@ const char TI99Style_usbHidReportDescriptor[] PROGMEM = {
     0x15, 0x00,                    //     LOGICAL_MINIMUM (0)
     0x26, 0xff, 0x00,              //     LOGICAL_MAXIMUM (255)
     0x75, 0x08,                    //     REPORT_SIZE (8)
-    0x95, 0x01,                    //     REPORT_COUNT (1)
+    0x95, 0x08,                    //     REPORT_COUNT (8)
     0xb2, 0x02, 0x01,              //     FEATURE (Data,Var,Abs,Buf)	
     0xc0,                          //   END_COLLECTION
     0xc0                           // END_COLLECTION
@@ -163,6 +168,10 @@ Gamepad TI99StyleJoy = {
 	.update					=	TI99StyleUpdate,
 	.changed				=	TI99StyleChanged,
 	.buildReport			=	TI99StyleBuildReport,
+	.buttons_offset			=	2,
+	.buttons_count			=	8,
+	.axes_offset			=	0,
+	.axes_count				=	2,
 };
 
 Gamepad *TI99StyleGetGamepad(void)
@@ -0,0 +1,25 @@
+#ifndef _debounce_h__
+#define _debounce_h__
+
+/* Number of consecutive "released" samples (taken at the ~2kHz controller
+ * poll rate) required before a release is accepted. Presses are always
+ * accepted on the first sample. 1 disables debouncing, 4 is the maximum.
+ */
+#ifndef DEBOUNCE_RELEASE_SAMPLES
+#define DEBOUNCE_RELEASE_SAMPLES	4
+#endif
+
+typedef struct {
+	unsigned char state;	// debounced inputs, same polarity as the samples (0 = pressed)
+	unsigned char cnt0;		// vertical counter, bit 0 of each input
+	unsigned char cnt1;		// vertical counter, bit 1 of each input
+} Debouncer;
+
+void debounceInit(Debouncer *db, unsigned char sample);
+
+/* \brief Filter one raw active-low sample, all 8 inputs in parallel.
+ * return The debounced state to store in last_update_state
+ */
+unsigned char debounce(Debouncer *db, unsigned char sample);
+
+#endif // _debounce_h__
@@ -0,0 +1,129 @@
+/* Timer driven autofire
+ * Copyright (C) 2024 Francis-Olivier Gradel, B.Eng.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * The author may be contacted at info@retronicdesign.com
+ *
+ */
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include "config.h"
+#include "turbo.h"
+
+/* The autofire phase is kept by the timer 2 compare B interrupt, at the
+ * same rate as the controller poll (compare A, still polled by main.c).
+ * The cadence is thus independent of how long update() or the USB traffic
+ * keep the main loop busy; the main loop only reads the current phase.
+ */
+static volatile unsigned int phase;
+static volatile unsigned char turbo_on;
+static volatile unsigned char edge;
+static unsigned int period;			// Timer ticks per autofire cycle
+static unsigned int on_ticks;		// Of which the buttons read pressed
+static unsigned char turbo_offset;
+static unsigned char turbo_bytes;
+static unsigned char turbo_held;	// Bit id-1 set while report id holds an autofire button
+
+ISR(TIMER2_COMPB_vect, ISR_NOBLOCK)	// Keep V-USB interrupt latency low
+{
+	if (++phase >= period)
+		phase = 0;
+
+	if (phase == 0) {
+		turbo_on = 1;
+		edge = 1;
+	}
+	else if (phase == on_ticks) {
+		turbo_on = 0;
+		edge = 1;
+	}
+}
+
+void turboInit(unsigned char offset, unsigned char count)
+{
+	turbo_offset = offset;
+	turbo_bytes = (((count < CFG_REMAP_SIZE) ? count : CFG_REMAP_SIZE) + 7) / 8;
+	turbo_on = 1;
+
+	turboCompile();
+
+	if (turbo_bytes)
+	{
+		OCR2B = 0;	// Once per timer 2 cycle
+		TIMSK2 |= (1<<OCIE2B);
+	}
+}
+
+void turboCompile(void)
+{
+	unsigned int tick_hz, p, on;
+	unsigned char rate = config.turbo_rate, duty = config.turbo_duty;
+
+	tick_hz = F_CPU/1024/(OCR2A+1);
+
+	if (rate < 1)
+		rate = 1;
+	if (duty < 1)
+		duty = 1;
+	if (duty > 99)
+		duty = 99;
+
+	p = tick_hz/rate;
+	on = (unsigned long)p*duty/100;
+	if (on < 1)
+		on = 1;
+	if (on >= p)
+		on = p-1;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		period = p;
+		on_ticks = on;
+		phase = 0;
+	}
+}
+
+void turboApply(unsigned char *report, unsigned char id)
+{
+	unsigned char i, held = 0;
+
+	if (id < 1 || id > 8)
+		id = 1;	// As the drivers do
+
+	report += turbo_offset;
+
+	for (i=0; i<turbo_bytes; i++)
+	{
+		held |= report[i] & config.turbo_mask[i];
+		if (!turbo_on)
+			report[i] &= ~config.turbo_mask[i];
+	}
+
+	if (held)
+		turbo_held |= 1<<(id-1);
+	else
+		turbo_held &= ~(1<<(id-1));
+}
+
+unsigned char turboEdge(void)
+{
+	if (!edge)
+		return 0;
+	edge = 0;
+
+	return turbo_held;
+}
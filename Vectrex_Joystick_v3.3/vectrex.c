@@ -25,6 +25,7 @@
 #include <string.h>
 #include "usbconfig.h"
 #include "vectrex.h"
+#include "config.h"
 
 #define SETUPDELAY 100
 
@@ -96,14 +97,14 @@ static char VectrexChanged(char id)
 }
 
 #define REPORT_SIZE 3
-#define GAIN 1.40
+#define GAIN config.gain	// percent, see CFG_DEFAULT_GAIN
 
 static char VectrexBuildReport(unsigned char *reportBuffer, char id)
 {
 	int x,y;
 	
-	x=((channel[AXIS_X]-127)*GAIN)+127;
-	y=(((255-channel[AXIS_Y])-127)*GAIN)+127;
+	x=(((channel[AXIS_X]-127)*GAIN)/100)+127;
+	y=((((255-channel[AXIS_Y])-127)*GAIN)/100)+127;
 	
 	// Clipping
 	if(x>255) x=255;
@@ -151,7 +152,7 @@ const char Vectrex_usbHidReportDescriptor[] PROGMEM = {
     0x15, 0x00,                    //     LOGICAL_MINIMUM (0)
     0x26, 0xff, 0x00,              //     LOGICAL_MAXIMUM (255)
     0x75, 0x08,                    //     REPORT_SIZE (8)
-    0x95, 0x01,                    //     REPORT_COUNT (1)
+    0x95, 0x08,                    //     REPORT_COUNT (8)
     0xb2, 0x02, 0x01,              //     FEATURE (Data,Var,Abs,Buf)	
     0xc0,                          //   END_COLLECTION
     0xc0                           // END_COLLECTION
@@ -187,6 +188,10 @@ Gamepad VectrexJoy = {
 	.update					=	VectrexUpdate,
 	.changed				=	VectrexChanged,
 	.buildReport			=	VectrexBuildReport,
+	.buttons_offset			=	2,
+	.buttons_count			=	8,
+	.axes_offset			=	0,
+	.axes_count				=	2,
 };
 
 Gamepad *VectrexGetGamepad(void)
@@ -25,6 +25,7 @@
 #include <string.h>
 #include "usbconfig.h"
 #include "ZXint2.h"
+#include "debounce.h"
 
 static char ZXint2Init(void);
 static void ZXint2Update(void);
@@ -34,6 +35,8 @@ static char ZXint2BuildReport(unsigned char *reportBuffer, char id);
 static unsigned char last_update_state=0;
 static unsigned char last_reported_state=0;
 
+static Debouncer debouncer;
+
 static char ZXint2Init(void)
 {
 
@@ -58,6 +61,8 @@ static char ZXint2Init(void)
 	PORTC |= ((1<<PC1)|(1<<PC3)|(1<<PC0)|(1<<PC2));
 	PORTD &= ~(1<<PD7);
 
+	debounceInit(&debouncer, 0xff);
+
 	return 0;
 }
 
@@ -69,7 +74,7 @@ static char ZXint2Init(void)
 
 static void ZXint2Update(void)
 {
-	last_update_state = ((PINB&0x38) | ((PINC&0x0C)>>2));
+	last_update_state = debounce(&debouncer, ((PINB&0x38) | ((PINC&0x0C)>>2)));
 }
 
 static char ZXint2Changed(char id)
@@ -132,7 +137,7 @@ const char ZXint2_usbHidReportDescriptor[] PROGMEM = {
     0x15, 0x00,                    //     LOGICAL_MINIMUM (0)
     0x26, 0xff, 0x00,              //     LOGICAL_MAXIMUM (255)
     0x75, 0x08,                    //     REPORT_SIZE (8)
-    0x95, 0x01,                    //     REPORT_COUNT (1)
+    0x95, 0x08,                    //     REPORT_COUNT (8)
     0xb2, 0x02, 0x01,              //     FEATURE (Data,Var,Abs,Buf)	
     0xc0,                          //   END_COLLECTION
     0xc0                           // END_COLLECTION
@@ -168,6 +173,10 @@ Gamepad ZXint2Joy = {
 	.update					=	ZXint2Update,
 	.changed				=	ZXint2Changed,
 	.buildReport			=	ZXint2BuildReport,
+	.buttons_offset			=	2,
+	.buttons_count			=	8,
+	.axes_offset			=	0,
+	.axes_count				=	2,
 };
 
 Gamepad *ZXint2GetGamepad(void)
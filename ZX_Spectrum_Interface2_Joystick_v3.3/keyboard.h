@@ -0,0 +1,54 @@
+#ifndef _keyboard_h__
+#define _keyboard_h__
+
+/* Boot keyboard, built when usbconfig.h sets USB_CFG_KEYBOARD to 1.
+ *
+ * A second HID interface with its own interrupt endpoint (3), for set-top
+ * boxes and front-ends that only understand key events. Its inputs are the
+ * directions and buttons of report ID 1, read from the report main.c builds
+ * for endpoint 1 (after remapping, before autofire): a key leaves with the
+ * joystick report carrying the same press. config.keymap gives the key of
+ * each input.
+ */
+
+#define KEYBOARD_INTERFACE		1	// bInterfaceNumber
+#define KEYBOARD_REPORT_SIZE	8	// Boot protocol: modifiers, reserved, 6 keys
+#define KEYBOARD_REPORT_DESCRIPTOR_LENGTH	63
+
+/* Inputs, index in config.keymap */
+#define KEY_UP			0
+#define KEY_DOWN		1
+#define KEY_LEFT		2
+#define KEY_RIGHT		3
+#define KEY_BUTTON1		4	// Button n is KEY_BUTTON1+n-1, up to CFG_KEYMAP_SIZE
+
+extern const char keyboard_usbHidReportDescriptor[];
+
+/* \brief Set where the inputs are in report ID 1.
+ * \param axes_offset index of the X axis, Y follows
+ * \param axes_count 2, or 0 if the report has no axes
+ * \param buttons_offset index of the first button byte
+ * \param buttons_count number of buttons
+ */
+void keyboardInit(unsigned char axes_offset, unsigned char axes_count, unsigned char buttons_offset, unsigned char buttons_count);
+
+/* \brief Feed report ID 1. Only the inputs that changed since the previous
+ * report press or release keys, the other key slots are left alone. */
+void keyboardUpdate(unsigned char *report);
+
+/* \brief Rebuild the key report from config.keymap, call when it changes. */
+void keyboardCompile(void);
+
+/* \brief Hand the key report to endpoint 3 when it changed and the endpoint
+ * is free. Call from the main loop. */
+void keyboardTask(void);
+
+/* \brief Idle rate countdown, call every 22ms. */
+void keyboardTick(void);
+
+/* \brief Class requests addressed to the keyboard interface.
+ * return As usbFunctionSetup()
+ */
+unsigned char keyboardSetup(unsigned char data[8]);
+
+#endif // _keyboard_h__
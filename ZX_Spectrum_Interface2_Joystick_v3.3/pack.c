@@ -0,0 +1,113 @@
+/* Multitap controllers in one report
+ * Copyright (C) 2024 Francis-Olivier Gradel, B.Eng.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * The author may be contacted at info@retronicdesign.com
+ *
+ */
+#include <avr/pgmspace.h>
+#include <string.h>
+#include "config.h"
+#include "pack.h"
+
+#define AXIS_LOW	0x40	// As keyboard.c, a direction past these
+#define AXIS_HIGH	0xC0
+
+/* Several reports in one transfer cannot be used instead: Windows takes a
+ * report ID in a single top level collection only, and Linux parses the
+ * first report of a transfer and drops the rest. */
+const char pack_usbHidReportDescriptor[] PROGMEM = {
+	0x05, 0x01,			// USAGE_PAGE (Generic Desktop)
+    0x09, 0x04,			// USAGE (Joystick)
+    0xa1, 0x01,			//	COLLECTION (Application)
+    0x09, 0x01,			//		USAGE (Pointer)
+    0xa1, 0x00,			//		COLLECTION (Physical)
+	0x09, 0x30,			//			USAGE (X)			controller 1
+    0x09, 0x31,			//			USAGE (Y)
+	0x09, 0x32,			//			USAGE (Z)			controller 2
+    0x09, 0x33,			//			USAGE (Rx)
+	0x09, 0x34,			//			USAGE (Ry)			controller 3
+    0x09, 0x35,			//			USAGE (Rz)
+	0x09, 0x36,			//			USAGE (Slider)		controller 4
+    0x09, 0x37,			//			USAGE (Dial)
+    0x15, 0xff,			//			LOGICAL_MINIMUM (-1)
+    0x25, 0x01,			//			LOGICAL_MAXIMUM (1)
+    0x75, 0x02,			//			REPORT_SIZE (2)
+    0x95, PACK_PADS*2,	//			REPORT_COUNT (8)
+    0x81, 0x02,			//			INPUT (Data,Var,Abs)
+    0x05, 0x09,			//			USAGE_PAGE (Button)
+    0x19, 1,			//   		USAGE_MINIMUM (Button 1)
+    0x29, PACK_PADS*8,	//   		USAGE_MAXIMUM (Button 32)
+    0x15, 0x00,			//   		LOGICAL_MINIMUM (0)
+    0x25, 0x01,			//   		LOGICAL_MAXIMUM (1)
+    0x75, 1,			// 			REPORT_SIZE (1)
+    0x95, PACK_PADS*8,	//			REPORT_COUNT (32)
+    0x81, 0x02,			//			INPUT (Data,Var,Abs)
+	0x09, 0x00,         //          USAGE (Undefined) // Used to trig bootloader when SET FEATURE
+    0x15, 0x00,         //          LOGICAL_MINIMUM (0)
+    0x26, 0xff, 0x00,   //          LOGICAL_MAXIMUM (255)
+    0x75, 0x08,         //          REPORT_SIZE (8)
+    0x95, CFG_FEATURE_SIZE,	//      REPORT_COUNT (8)
+    0xb2, 0x02, 0x01,   //          FEATURE (Data,Var,Abs,Buf)
+	0xc0,				//		END_COLLECTION
+    0xc0				// END_COLLECTION
+};
+
+// main.c puts the length in the configuration descriptor
+typedef char pack_descriptor_length[(sizeof(pack_usbHidReportDescriptor) == PACK_REPORT_DESCRIPTOR_LENGTH) ? 1 : -1];
+
+static unsigned char axes_offset;
+static unsigned char buttons_offset;
+
+unsigned char packInit(Gamepad *pad)
+{
+	if (!config.pack_reports)
+		return 0;
+
+	// GET_REPORT builds the packed report with peekReport()
+	if (pad->num_reports < 2 || pad->num_reports > PACK_PADS || pad->mouse_report_id || !pad->peekReport)
+		return 0;
+	if (pad->axes_count != 2 || pad->buttons_count > 8)
+		return 0;
+
+	axes_offset = pad->axes_offset;
+	buttons_offset = pad->buttons_offset;
+	return 1;
+}
+
+void packClear(unsigned char *report)
+{
+	memset(report, 0, PACK_REPORT_SIZE);
+}
+
+static unsigned char packAxis(unsigned char value)
+{
+	if (value < AXIS_LOW)
+		return 3;	// -1 in 2 bits
+	if (value > AXIS_HIGH)
+		return 1;
+	return 0;
+}
+
+void packAdd(unsigned char *report, const unsigned char *pad, unsigned char id)
+{
+	unsigned char i = id-1;
+	unsigned char axes;
+
+	axes = packAxis(pad[axes_offset]) | (packAxis(pad[axes_offset+1])<<2);
+	report[i/2] |= axes << ((i&1)*4);
+	report[PACK_PADS/2 + i] = pad[buttons_offset];
+}
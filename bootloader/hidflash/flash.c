@@ -0,0 +1,257 @@
+/* Name: flash.c
+ * Project: AVR bootloader HID, Linux flasher
+ * Author: Francis-Olivier Gradel
+ * Tabsize: 4
+ * License: GNU GPL v2 (see License.txt)
+ */
+
+/* The bootloader side of the protocol, see the report list in
+ * bootloader/main.c. Nothing in here knows about hidraw, it only goes
+ * through the Device functions.
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include "hidflash.h"
+
+static int deviceError(Device *dev, const char *fmt, ...)
+{
+va_list ap;
+
+    va_start(ap, fmt);
+    vsnprintf(dev->error, sizeof(dev->error), fmt, ap);
+    va_end(ap);
+    return -1;
+}
+
+static int setReport(Device *dev, const unsigned char *buf, int len)
+{
+    if(dev->setFeature(dev, buf, len) < 0)
+        return deviceError(dev, "SET_REPORT %d: %s", buf[0], strerror(errno));
+    return 0;
+}
+
+static int getReport(Device *dev, unsigned char id, unsigned char *buf, int len)
+{
+int r;
+
+    memset(buf, 0, len);
+    buf[0] = id;
+    r = dev->getFeature(dev, buf, len);
+    if(r < 0)
+        return deviceError(dev, "GET_REPORT %d: %s", id, strerror(errno));
+    if(r < len)
+        return deviceError(dev, "GET_REPORT %d: %d bytes instead of %d", id, r, len);
+    return 0;
+}
+
+static void putAddress(unsigned char *p, unsigned long address)
+{
+    p[0] = address & 0xff;
+    p[1] = (address >> 8) & 0xff;
+    p[2] = (address >> 16) & 0xff;
+}
+
+static unsigned long getAddress(const unsigned char *p)
+{
+    return p[0] | ((unsigned long)p[1] << 8) | ((unsigned long)p[2] << 16);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int hexByte(const char *s)
+{
+int i, v = 0;
+
+    for(i = 0; i < 2; i++){
+        v <<= 4;
+        if(s[i] >= '0' && s[i] <= '9')
+            v |= s[i] - '0';
+        else if(s[i] >= 'a' && s[i] <= 'f')
+            v |= s[i] - 'a' + 10;
+        else if(s[i] >= 'A' && s[i] <= 'F')
+            v |= s[i] - 'A' + 10;
+        else
+            return -1;
+    }
+    return v;
+}
+
+int imageLoadHex(Image *img, const char *path, char *err, size_t errSize)
+{
+FILE            *fp;
+char            line[600];
+unsigned char   rec[256 + 5];
+unsigned long   base = 0, address;
+int             lineNo = 0, len, i, v, sum;
+
+    memset(img->data, 0xff, sizeof(img->data));
+    memset(img->used, 0, sizeof(img->used));
+    img->size = 0;
+    if((fp = fopen(path, "r")) == NULL){
+        snprintf(err, errSize, "%s: %s", path, strerror(errno));
+        return -1;
+    }
+    while(fgets(line, sizeof(line), fp) != NULL){
+        lineNo++;
+        if(line[0] != ':')
+            continue;
+        len = hexByte(line + 1);
+        for(i = 0, sum = 0; len >= 0 && i < len + 5; i++){
+            if((v = hexByte(line + 1 + 2 * i)) < 0)
+                break;
+            rec[i] = v;
+            sum += v;
+        }
+        if(len < 0 || i < len + 5 || (sum & 0xff)){
+            snprintf(err, errSize, "%s:%d: bad record", path, lineNo);
+            fclose(fp);
+            return -1;
+        }
+        switch(rec[3]){
+        case 0:                         /* data */
+            address = base + ((rec[1] << 8) | rec[2]);
+            if(address + len > IMAGE_MAX){
+                snprintf(err, errSize, "%s:%d: address 0x%lx out of range", path, lineNo, address);
+                fclose(fp);
+                return -1;
+            }
+            for(i = 0; i < len; i++, address++){
+                img->data[address] = rec[4 + i];
+                img->used[address / REPORT_DATA] = 1;
+            }
+            break;
+        case 1:                         /* end of file */
+            goto done;
+        case 2:                         /* extended segment address */
+            base = ((rec[4] << 8) | rec[5]) << 4;
+            break;
+        case 4:                         /* extended linear address */
+            base = (unsigned long)((rec[4] << 8) | rec[5]) << 16;
+            break;
+        }                               /* 3 and 5 are start addresses, nothing to flash */
+    }
+done:
+    fclose(fp);
+    for(i = 0; i < IMAGE_MAX / REPORT_DATA; i++){
+        if(img->used[i])
+            img->size = (unsigned long)(i + 1) * REPORT_DATA;
+    }
+    if(!img->size){
+        snprintf(err, errSize, "%s: no data", path);
+        return -1;
+    }
+    return 0;
+}
+
+unsigned imageClip(Image *img, unsigned long end)
+{
+unsigned    i, dropped = 0;
+
+    for(i = (end + REPORT_DATA - 1) / REPORT_DATA; i < IMAGE_MAX / REPORT_DATA; i++){
+        if(img->used[i]){
+            img->used[i] = 0;
+            dropped++;
+        }
+    }
+    if(end < IMAGE_MAX)
+        memset(&img->data[end], 0xff, IMAGE_MAX - end);
+    img->size = 0;
+    for(i = 0; i < IMAGE_MAX / REPORT_DATA; i++){
+        if(img->used[i])
+            img->size = (unsigned long)(i + 1) * REPORT_DATA;
+    }
+    return dropped;
+}
+
+unsigned long descriptorFeatures(const unsigned char *desc, int len, int *firstId)
+{
+unsigned long   features = 0;
+int             i = 0, size, id = 0;
+
+    *firstId = -1;
+    while(i < len){
+        if(desc[i] == 0xfe){            /* long item */
+            i += 3 + (i + 1 < len ? desc[i + 1] : 0);
+            continue;
+        }
+        size = desc[i] & 3;
+        if(size == 3)
+            size = 4;
+        if((desc[i] & 0xfc) == 0x84 && i + 1 < len)     /* REPORT_ID */
+            id = desc[i + 1];
+        if((desc[i] & 0xfc) == 0xb0){   /* FEATURE */
+            if(*firstId < 0)
+                *firstId = id;
+            if(id < 32)
+                features |= 1UL << id;
+        }
+        i += 1 + size;
+    }
+    if(*firstId < 0)
+        *firstId = 0;
+    return features;
+}
+
+/* ------------------------------------------------------------------------- */
+
+int bootloaderOpen(Device *dev)
+{
+unsigned char   buf[4096];
+int             len, firstId;
+
+    if((len = dev->descriptor(dev, buf, sizeof(buf))) < 0)
+        return deviceError(dev, "report descriptor: %s", strerror(errno));
+    dev->reports = descriptorFeatures(buf, len, &firstId);
+    if(!(dev->reports & (1 << 1)) || !(dev->reports & (1 << 2)))
+        return deviceError(dev, "not a HID bootloader");
+    if(getReport(dev, 1, buf, 7) < 0)
+        return -1;
+    dev->pageSize = buf[1] | (buf[2] << 8);
+    dev->flashSize = getAddress(&buf[3]) | ((unsigned long)buf[6] << 24);
+    if(!dev->pageSize || REPORT_DATA % dev->pageSize)
+        return deviceError(dev, "page size %u not supported", dev->pageSize);
+    return 0;
+}
+
+static int writeBlock(Device *dev, const Image *img, unsigned long address, FlashStats *stats)
+{
+unsigned char   buf[REPORT_SIZE];
+
+    buf[0] = 2;
+    putAddress(&buf[1], address);
+    memcpy(&buf[4], &img->data[address], REPORT_DATA);
+    stats->wire += sizeof(buf);
+    return setReport(dev, buf, sizeof(buf));
+}
+
+int bootloaderFlash(Device *dev, const Image *img, const FlashOptions *opt, FlashStats *stats)
+{
+unsigned long   limit = dev->flashSize;
+int             i;
+
+    memset(stats, 0, sizeof(*stats));
+    if(opt->bootStart && opt->bootStart < limit)
+        limit = opt->bootStart;
+    if(img->size > limit)
+        return deviceError(dev, "image ends at 0x%lx, over the bootloader at 0x%lx", img->size, limit);
+    for(i = 0; i < (int)(img->size / REPORT_DATA); i++){
+        if(!img->used[i])
+            continue;
+        if(writeBlock(dev, img, (unsigned long)i * REPORT_DATA, stats) < 0)
+            return -1;
+        stats->sent++;
+    }
+    return 0;
+}
+
+int bootloaderLeave(Device *dev)
+{
+unsigned char   buf[7];
+
+    memset(buf, 0, sizeof(buf));
+    buf[0] = 1;
+    return setReport(dev, buf, sizeof(buf));
+}
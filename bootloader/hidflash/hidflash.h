@@ -0,0 +1,69 @@
+/* Name: hidflash.h
+ * Project: AVR bootloader HID, Linux flasher
+ * Author: Francis-Olivier Gradel
+ * Tabsize: 4
+ * License: GNU GPL v2 (see License.txt)
+ */
+
+#ifndef __hidflash_h_included__
+#define __hidflash_h_included__
+
+#include <stddef.h>
+
+#define REPORT_DATA     128             /* flash bytes in report 2 */
+#define REPORT_SIZE     (REPORT_DATA + 4)   /* report ID and address before them */
+#define IMAGE_MAX       0x20000         /* 3 byte addresses reach further, no AVR does */
+
+/* A device speaking feature reports. main.c implements it over hidraw, any
+ * other transport (or a simulated bootloader) only has to fill in these
+ * three functions. buf[0] is always the report ID.
+ */
+typedef struct Device Device;
+struct Device {
+    char            name[64];       /* for the messages, e.g. /dev/hidraw3 */
+    int             (*setFeature)(Device *dev, const unsigned char *buf, int len);
+    int             (*getFeature)(Device *dev, unsigned char *buf, int len);
+    int             (*descriptor)(Device *dev, unsigned char *buf, int size);
+    void            *priv;
+    /* filled by bootloaderOpen() */
+    unsigned        pageSize;
+    unsigned long   flashSize;
+    unsigned long   reports;        /* bit n set if the descriptor has feature report n */
+    char            error[128];     /* why the last call failed */
+};
+
+typedef struct {
+    unsigned char   data[IMAGE_MAX];
+    unsigned char   used[IMAGE_MAX / REPORT_DATA];  /* blocks holding data, the rest of a block is 0xff */
+    unsigned long   size;           /* end of the last block holding data */
+} Image;
+
+typedef struct {
+    unsigned long   bootStart;      /* the image must stay below, see imageClip() */
+} FlashOptions;
+
+typedef struct {
+    unsigned        sent;           /* blocks of REPORT_DATA bytes */
+    unsigned long   wire;           /* report bytes sent for the blocks */
+} FlashStats;
+
+/* return 0, or -1 with the reason in err */
+int             imageLoadHex(Image *img, const char *path, char *err, size_t errSize);
+
+/* Drops what lies at or above end, the firmware .hex files also hold the
+ * bootloader for the ISP programmers. return The number of blocks dropped.
+ */
+unsigned        imageClip(Image *img, unsigned long end);
+
+/* Feature reports of a report descriptor, as a bit mask of the report IDs
+ * below 32. *firstId gets the ID of the first one, 0 if the descriptor has
+ * no report IDs at all.
+ */
+unsigned long   descriptorFeatures(const unsigned char *desc, int len, int *firstId);
+
+/* All the following return 0, or -1 with the reason in dev->error */
+int             bootloaderOpen(Device *dev);
+int             bootloaderFlash(Device *dev, const Image *img, const FlashOptions *opt, FlashStats *stats);
+int             bootloaderLeave(Device *dev);
+
+#endif /* __hidflash_h_included__ */
@@ -0,0 +1,342 @@
+/* Name: main.c
+ * Project: AVR bootloader HID, Linux flasher
+ * Author: Francis-Olivier Gradel
+ * Tabsize: 4
+ * License: GNU GPL v2 (see License.txt)
+ */
+
+/* Updates any number of adapters at once, one thread per hidraw node. An
+ * adapter running its firmware is sent the 0x5A feature report, then found
+ * again as the bootloader on the same USB port.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <linux/hidraw.h>
+#include "hidflash.h"
+
+#define BOOT_VID            0x16c0
+#define BOOT_PID            0x05df
+#define CMD_BOOTLOADER      0x5A    /* CFG_CMD_BOOTLOADER in the firmwares' config.h */
+#define FEATURE_SIZE        8       /* CFG_FEATURE_SIZE */
+#define REENUMERATE_TIMEOUT 50      /* 100ms steps */
+#define MAX_JOBS            64
+
+/* What -a looks for: the IDs the firmwares of this repository enumerate
+ * with, and the start of the hidraw name (manufacturer, a space, product).
+ * None of the IDs is ours alone: 0810:e501 is found on generic game pads,
+ * 16c0:27da (the mice) and 16c0:05df (the bootloader) are VOTI's PIDs
+ * shared by V-USB projects. The CD32 A500 mini firmware (1c59:0026) takes
+ * the strings of the THEGamepad too, so it is only updated when its node
+ * is given.
+ */
+typedef struct {
+    unsigned short  vendor;
+    unsigned short  product;
+    const char      *name;
+} AdapterId;
+
+static const AdapterId adapterIds[] = {
+    {0x0810, 0xe501, "retronicdesign.com "},
+    {0x16c0, 0x27da, "retronicdesign.com "},
+    {BOOT_VID, BOOT_PID, "obdev.at HIDBoot"},
+};
+
+typedef struct {
+    Device      dev;
+    char        node[32];
+    char        phys[64];           /* USB port, kept by the bootloader */
+    int         fd;
+    int         failed;
+    int         started;
+    pthread_t   thread;
+} Job;
+
+static Image            image;
+static FlashOptions     options = {0x7000};
+static int              stay;
+static pthread_mutex_t  outputLock = PTHREAD_MUTEX_INITIALIZER;
+
+static void message(Job *job, const char *fmt, ...)
+{
+va_list ap;
+
+    pthread_mutex_lock(&outputLock);
+    fprintf(stderr, "%s: ", job->node);
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+    pthread_mutex_unlock(&outputLock);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int hidrawSetFeature(Device *dev, const unsigned char *buf, int len)
+{
+    return ioctl(((Job *)dev->priv)->fd, HIDIOCSFEATURE(len), buf);
+}
+
+static int hidrawGetFeature(Device *dev, unsigned char *buf, int len)
+{
+    return ioctl(((Job *)dev->priv)->fd, HIDIOCGFEATURE(len), buf);
+}
+
+static int hidrawDescriptor(Device *dev, unsigned char *buf, int size)
+{
+struct hidraw_report_descriptor desc;
+int                             fd = ((Job *)dev->priv)->fd;
+
+    if(ioctl(fd, HIDIOCGRDESCSIZE, &desc.size) < 0)
+        return -1;
+    if(ioctl(fd, HIDIOCGRDESC, &desc) < 0)
+        return -1;
+    if((int)desc.size > size)
+        desc.size = size;
+    memcpy(buf, desc.value, desc.size);
+    return desc.size;
+}
+
+/* return The file descriptor, -1 if node can not be opened */
+static int hidrawOpen(const char *node, struct hidraw_devinfo *info, char *phys, int physSize)
+{
+int fd;
+
+    if((fd = open(node, O_RDWR)) < 0)
+        return -1;
+    memset(phys, 0, physSize);
+    if(ioctl(fd, HIDIOCGRAWINFO, info) < 0 || ioctl(fd, HIDIOCGRAWPHYS(physSize - 1), phys) < 0){
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int isBootloader(const struct hidraw_devinfo *info)
+{
+    return (unsigned short)info->vendor == BOOT_VID && (unsigned short)info->product == BOOT_PID;
+}
+
+static int isAdapter(int fd, const struct hidraw_devinfo *info)
+{
+char        name[128];
+unsigned    i;
+
+    memset(name, 0, sizeof(name));
+    if(ioctl(fd, HIDIOCGRAWNAME(sizeof(name) - 1), name) < 0)
+        return 0;
+    for(i = 0; i < sizeof(adapterIds) / sizeof(adapterIds[0]); i++){
+        if((unsigned short)info->vendor == adapterIds[i].vendor && (unsigned short)info->product == adapterIds[i].product
+            && !strncmp(name, adapterIds[i].name, strlen(adapterIds[i].name)))
+            return 1;
+    }
+    return 0;
+}
+
+/* The physical path ends with the interface ("usb-0000:00:14.0-2/input0"),
+ * the same for the firmware and the bootloader on a given port.
+ */
+static int isFirstInterface(const char *phys)
+{
+const char  *p = strrchr(phys, '/');
+
+    /* The keyboard and diagnostics interfaces (USB_CFG_KEYBOARD,
+     * USB_CFG_DIAGNOSTICS) are another hidraw node of the same adapter */
+    return p == NULL || !strcmp(p, "/input0");
+}
+
+static int findBootloader(Job *job)
+{
+DIR                     *dir;
+struct dirent           *entry;
+struct hidraw_devinfo   info;
+char                    node[32], phys[64];
+int                     fd;
+
+    if((dir = opendir("/dev")) == NULL)
+        return -1;
+    while((entry = readdir(dir)) != NULL){
+        if(strncmp(entry->d_name, "hidraw", 6))
+            continue;
+        snprintf(node, sizeof(node), "/dev/%.24s", entry->d_name);
+        if((fd = hidrawOpen(node, &info, phys, sizeof(phys))) < 0)
+            continue;
+        if(isBootloader(&info) && !strcmp(phys, job->phys)){
+            closedir(dir);
+            job->fd = fd;
+            return 0;
+        }
+        close(fd);
+    }
+    closedir(dir);
+    return -1;
+}
+
+static int enterBootloader(Job *job)
+{
+unsigned char   desc[HID_MAX_DESCRIPTOR_SIZE], buf[FEATURE_SIZE + 1];
+int             id, len, i;
+
+    if((len = hidrawDescriptor(&job->dev, desc, sizeof(desc))) < 0){
+        message(job, "report descriptor: %s", strerror(errno));
+        return -1;
+    }
+    descriptorFeatures(desc, len, &id);
+    /* With a report ID, the ID takes the place of the last payload byte */
+    memset(buf, 0, sizeof(buf));
+    buf[0] = id;
+    buf[1] = CMD_BOOTLOADER;
+    len = id ? FEATURE_SIZE : FEATURE_SIZE + 1;
+    if(ioctl(job->fd, HIDIOCSFEATURE(len), buf) < 0){
+        message(job, "bootloader request: %s", strerror(errno));
+        return -1;
+    }
+    close(job->fd);
+    job->fd = -1;
+    for(i = 0; i < REENUMERATE_TIMEOUT; i++){
+        usleep(100000);
+        if(findBootloader(job) == 0)
+            return 0;
+    }
+    message(job, "the bootloader did not show up on %s", job->phys);
+    return -1;
+}
+
+static void *flashJob(void *arg)
+{
+Job                     *job = arg;
+struct hidraw_devinfo   info;
+FlashStats              stats;
+
+    job->failed = 1;
+    job->dev.setFeature = hidrawSetFeature;
+    job->dev.getFeature = hidrawGetFeature;
+    job->dev.descriptor = hidrawDescriptor;
+    job->dev.priv = job;
+    snprintf(job->dev.name, sizeof(job->dev.name), "%s", job->node);
+    if((job->fd = hidrawOpen(job->node, &info, job->phys, sizeof(job->phys))) < 0){
+        message(job, "%s", strerror(errno));
+        return NULL;
+    }
+    if(!isFirstInterface(job->phys)){
+        message(job, "%s is not the first interface of the adapter", job->phys);
+        goto out;
+    }
+    if(!isBootloader(&info)){
+        if(enterBootloader(job) < 0)
+            goto out;
+    }
+    if(bootloaderOpen(&job->dev) < 0
+        || bootloaderFlash(&job->dev, &image, &options, &stats) < 0){
+        message(job, "%s", job->dev.error);
+        goto out;
+    }
+    job->failed = 0;
+    message(job, "%u blocks written, %lu bytes sent", stats.sent, stats.wire);
+    if(!stay && bootloaderLeave(&job->dev) < 0)
+        message(job, "%s, unplug it to start the firmware", job->dev.error);
+out:
+    if(job->fd >= 0)
+        close(job->fd);
+    return NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int findAdapters(Job *jobs)
+{
+DIR                     *dir;
+struct dirent           *entry;
+struct hidraw_devinfo   info;
+char                    node[32], phys[64];
+int                     fd, n = 0;
+
+    if((dir = opendir("/dev")) == NULL)
+        return 0;
+    while((entry = readdir(dir)) != NULL && n < MAX_JOBS){
+        if(strncmp(entry->d_name, "hidraw", 6))
+            continue;
+        snprintf(node, sizeof(node), "/dev/%.24s", entry->d_name);
+        if((fd = hidrawOpen(node, &info, phys, sizeof(phys))) < 0)
+            continue;
+        if(isAdapter(fd, &info) && isFirstInterface(phys))
+            snprintf(jobs[n++].node, sizeof(jobs[0].node), "%s", node);
+        close(fd);
+    }
+    closedir(dir);
+    return n;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-a] [-s] [-b address] firmware.hex [/dev/hidrawN ...]\n", name);
+    fprintf(stderr, "  -a  update every adapter found, in the firmware or in the bootloader\n");
+    fprintf(stderr, "      (not the CD32 A500 mini, give its node)\n");
+    fprintf(stderr, "  -s  stay in the bootloader\n");
+    fprintf(stderr, "  -b  start of the bootloader, nothing is written from there on (0x%lx)\n", options.bootStart);
+}
+
+int main(int argc, char **argv)
+{
+static Job  jobs[MAX_JOBS];
+char        err[256];
+int         opt, all = 0, n = 0, i, failed = 0;
+
+    while((opt = getopt(argc, argv, "asb:")) != -1){
+        switch(opt){
+        case 'a': all = 1; break;
+        case 's': stay = 1; break;
+        case 'b': options.bootStart = strtoul(optarg, NULL, 0); break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if(optind >= argc || (all && optind + 1 < argc) || (!all && optind + 1 == argc)){
+        usage(argv[0]);
+        return 2;
+    }
+    if(imageLoadHex(&image, argv[optind], err, sizeof(err)) < 0){
+        fprintf(stderr, "%s\n", err);
+        return 1;
+    }
+    if((i = imageClip(&image, options.bootStart)) != 0)
+        fprintf(stderr, "%s: %d blocks from 0x%lx on left out, the bootloader stays\n", argv[optind], i, options.bootStart);
+    if(!image.size){
+        fprintf(stderr, "%s: nothing below 0x%lx\n", argv[optind], options.bootStart);
+        return 1;
+    }
+    if(all){
+        n = findAdapters(jobs);
+    }else{
+        for(i = optind + 1; i < argc && n < MAX_JOBS; i++)
+            snprintf(jobs[n++].node, sizeof(jobs[0].node), "%s", argv[i]);
+    }
+    if(!n){
+        fprintf(stderr, "no adapter found\n");
+        return 1;
+    }
+    for(i = 0; i < n; i++){
+        jobs[i].started = !pthread_create(&jobs[i].thread, NULL, flashJob, &jobs[i]);
+        if(!jobs[i].started){
+            message(&jobs[i], "can not start a thread");
+            jobs[i].failed = 1;
+        }
+    }
+    for(i = 0; i < n; i++){
+        if(jobs[i].started)
+            pthread_join(jobs[i].thread, NULL);
+        failed += jobs[i].failed;
+    }
+    if(n > 1)
+        fprintf(stderr, "%d of %d adapters updated\n", n - failed, n);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,30 @@
+/* Name: boot.h (simulated)
+ * Project: AVR bootloader HID, Linux flasher tests
+ * Author: Francis-Olivier Gradel
+ * Tabsize: 4
+ * License: GNU GPL v2 (see License.txt)
+ */
+
+#ifndef __sim_boot_h_included__
+#define __sim_boot_h_included__
+
+/* The self-programming of simdev.c: the temporary page buffer, erase and
+ * write taking the time the datasheet gives, the RWW section unreadable
+ * from an erase to boot_rww_enable(). Misuse aborts the test.
+ */
+#define SPM_PAGESIZE    128
+
+void            simPageFill(unsigned long address, unsigned word);
+void            simPageErase(unsigned long address);
+void            simPageWrite(unsigned long address);
+void            simRwwEnable(void);
+int             simSpmBusy(void);
+
+#define boot_page_fill(a, w)    simPageFill(a, w)
+#define boot_page_erase(a)      simPageErase(a)
+#define boot_page_write(a)      simPageWrite(a)
+#define boot_rww_enable()       simRwwEnable()
+#define boot_spm_busy()         simSpmBusy()
+#define boot_spm_busy_wait()    do{}while(boot_spm_busy())
+
+#endif
@@ -0,0 +1,15 @@
+/* Name: interrupt.h (simulated)
+ * Project: AVR bootloader HID, Linux flasher tests
+ * Author: Francis-Olivier Gradel
+ * Tabsize: 4
+ * License: GNU GPL v2 (see License.txt)
+ */
+
+#ifndef __sim_interrupt_h_included__
+#define __sim_interrupt_h_included__
+
+/* Nothing interrupts the simulated bootloader, see simdev.c */
+#define cli()
+#define sei()
+
+#endif
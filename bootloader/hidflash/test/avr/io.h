@@ -0,0 +1,39 @@
+/* Name: io.h (simulated)
+ * Project: AVR bootloader HID, Linux flasher tests
+ * Author: Francis-Olivier Gradel
+ * Tabsize: 4
+ * License: GNU GPL v2 (see License.txt)
+ */
+
+/* Just enough of the ATmega328P for bootloader/main.c to build on the host,
+ * see simdev.c. The I/O registers are plain bytes nobody looks at.
+ */
+
+#ifndef __sim_io_h_included__
+#define __sim_io_h_included__
+
+#define FLASHEND        0x7fff
+#define SIM_BOOT_START  0x7000          /* BOOTLOADER_ADDRESS in bootloader/Makefile */
+
+extern unsigned char    simIo[16];
+
+#define PINB            simIo[0]
+#define DDRB            simIo[1]
+#define PORTB           simIo[2]
+#define PINC            simIo[3]
+#define DDRC            simIo[4]
+#define PORTC           simIo[5]
+#define PIND            simIo[6]
+#define DDRD            simIo[7]
+#define PORTD           simIo[8]
+#define MCUCR           simIo[9]
+#define MCUSR           simIo[10]
+#define TCCR0B          simIo[11]
+#define USB_INTR_ENABLE simIo[12]
+#define USB_INTR_CFG    simIo[13]
+
+#define IVSEL           1
+#define IVCE            0
+#define PD7             7
+
+#endif
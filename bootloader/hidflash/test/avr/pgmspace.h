@@ -0,0 +1,24 @@
+/* Name: pgmspace.h (simulated)
+ * Project: AVR bootloader HID, Linux flasher tests
+ * Author: Francis-Olivier Gradel
+ * Tabsize: 4
+ * License: GNU GPL v2 (see License.txt)
+ */
+
+#ifndef __sim_pgmspace_h_included__
+#define __sim_pgmspace_h_included__
+
+/* bootloader/main.c reads the application through pgm_read_byte() and
+ * pgm_read_word() with flash addresses, these go to the simulated flash.
+ * Its own constants are ordinary host data, read with pgm_read_dword().
+ */
+#define PROGMEM
+
+unsigned char   simFlashByte(unsigned long address);
+unsigned        simFlashWord(unsigned long address);
+
+#define pgm_read_byte(a)    simFlashByte(a)
+#define pgm_read_word(a)    simFlashWord(a)
+#define pgm_read_dword(p)   (*(p))
+
+#endif
@@ -0,0 +1,15 @@
+/* Name: wdt.h (simulated)
+ * Project: AVR bootloader HID, Linux flasher tests
+ * Author: Francis-Olivier Gradel
+ * Tabsize: 4
+ * License: GNU GPL v2 (see License.txt)
+ */
+
+#ifndef __sim_wdt_h_included__
+#define __sim_wdt_h_included__
+
+#define WDTO_2S         7
+#define wdt_enable(t)
+#define wdt_reset()
+
+#endif
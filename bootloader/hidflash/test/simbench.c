@@ -0,0 +1,81 @@
+/* Name: simbench.c
+ * Project: AVR bootloader HID, Linux flasher tests
+ * Author: Francis-Olivier Gradel
+ * Tabsize: 4
+ * License: GNU GPL v2 (see License.txt)
+ */
+
+/* Flash time of real firmware images through the simulated bootloader,
+ * every page with report 2 to an erased device. The times run from the
+ * first report to the device leaving the bootloader, with the SPM and bus
+ * figures of simdev.h. The last line is a whole application of random
+ * bytes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "simdev.h"
+
+#define APP_END     0x7000              /* the bootloader starts there */
+
+static Image        image;
+static Device       dev;
+static FlashOptions options;
+static FlashStats   stats;
+
+/* One line of the table for the image loaded. return The time, -1 on error */
+static double benchImage(const char *name)
+{
+double  ms;
+
+    simInit(NULL);
+    simDevice(&dev);
+    memset(&options, 0, sizeof(options));
+    options.bootStart = APP_END;
+    if(bootloaderOpen(&dev) < 0 || bootloaderFlash(&dev, &image, &options, &stats) < 0 || bootloaderLeave(&dev) < 0){
+        fprintf(stderr, "%s: %s\n", name, dev.error);
+        return -1;
+    }
+    if(!simLeft() || memcmp(simFlash, image.data, image.size) != 0){
+        fprintf(stderr, "%s: flash does not match the image\n", name);
+        return -1;
+    }
+    ms = simStats.time / 1000.0;
+    printf("%-40.40s %6lu %9.1f\n", name, image.size, ms);
+    return ms;
+}
+
+int main(int argc, char **argv)
+{
+char            err[256];
+unsigned long   bytes = 0;
+double          ms, total = 0;
+int             i;
+
+    if(argc < 2){
+        fprintf(stderr, "usage: %s firmware.hex ...\n", argv[0]);
+        return 1;
+    }
+    printf("%-40s %6s %9s\n", "image", "bytes", "write ms");
+    for(i = 1; i < argc; i++){
+        if(imageLoadHex(&image, argv[i], err, sizeof(err)) < 0){
+            fprintf(stderr, "%s: %s\n", argv[i], err);
+            return 1;
+        }
+        imageClip(&image, APP_END);
+        if((ms = benchImage(strrchr(argv[i], '/') ? strrchr(argv[i], '/') + 1 : argv[i])) < 0)
+            return 1;
+        bytes += image.size;
+        total += ms;
+    }
+    printf("%-40s %6lu %9.1f\n", "total", bytes, total);
+    srand(1);
+    memset(image.used, 0, sizeof(image.used));
+    for(i = 0; i < APP_END; i++){
+        image.data[i] = rand();
+        image.used[i / REPORT_DATA] = 1;
+    }
+    image.size = APP_END;
+    return benchImage("random") < 0;
+}
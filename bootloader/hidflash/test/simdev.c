@@ -0,0 +1,287 @@
+/* Name: simdev.c
+ * Project: AVR bootloader HID, Linux flasher tests
+ * Author: Francis-Olivier Gradel
+ * Tabsize: 4
+ * License: GNU GPL v2 (see License.txt)
+ */
+
+/* The bootloader's own main.c, its main loop and a host sending control
+ * transfers one transaction at a time. A transaction the device can not
+ * take (a packet still waiting for usbPoll(), or usbDisableAllRequests())
+ * is NAKed and retried in the next bus slot, as the host controller does.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "simdev.h"
+
+#ifndef BOOTLOADER_SRC
+#define BOOTLOADER_SRC  "../../main.c"
+#endif
+
+#define uint    unsigned short          /* as on the AVR, main.c moves words through uint pointers */
+#define main    bootloaderMain          /* never called, the loop is below */
+#include BOOTLOADER_SRC
+#undef main
+
+SimStats        simStats;
+unsigned char   simFlash[SIM_FLASH_SIZE];
+unsigned char   simIo[16];
+unsigned        simPacketUs = 125;      /* ~170 low speed bit times with the handshake */
+
+static unsigned char        spmBuffer[SPM_PAGESIZE];
+static unsigned long long   spmDone;    /* end of the running erase or write */
+static int                  rwwBusy;    /* erased or written, not re-enabled yet */
+static unsigned long long   busTime;    /* the next bus slot */
+static int                  left;
+
+static void simFail(const char *what, unsigned long address)
+{
+    fprintf(stderr, "simulated bootloader: %s at 0x%04lx\n", what, address);
+    abort();
+}
+
+/* ------------------------------- flash ----------------------------------- */
+
+unsigned char simFlashByte(unsigned long address)
+{
+    if(address >= SIM_FLASH_SIZE)
+        simFail("read past the flash", address);
+    if(rwwBusy && address < SIM_BOOT_START)
+        simFail("RWW section read before boot_rww_enable()", address);
+    return simFlash[address];
+}
+
+unsigned simFlashWord(unsigned long address)
+{
+    return simFlashByte(address) | (simFlashByte(address + 1) << 8);
+}
+
+int simSpmBusy(void)
+{
+    simStats.time++;                    /* the polling itself */
+    return simStats.time < spmDone;
+}
+
+static void spmStart(const char *what, unsigned long address)
+{
+    if(simStats.time < spmDone)
+        simFail(what, address);         /* the SPM instruction would be ignored */
+    spmDone = simStats.time + SIM_SPM_US;
+}
+
+void simPageFill(unsigned long address, unsigned word)
+{
+    if(simStats.time < spmDone)
+        simFail("page fill while the SPM is busy", address);
+    spmBuffer[address & (SPM_PAGESIZE - 2)] = word;
+    spmBuffer[(address & (SPM_PAGESIZE - 2)) + 1] = word >> 8;
+}
+
+void simPageErase(unsigned long address)
+{
+    spmStart("page erase while the SPM is busy", address);
+    address &= ~(unsigned long)(SPM_PAGESIZE - 1);
+    if(address < SIM_BOOT_START)        /* the lock bits protect the rest */
+        memset(&simFlash[address], 0xff, SPM_PAGESIZE);
+    rwwBusy = 1;
+    simStats.erases++;
+}
+
+void simPageWrite(unsigned long address)
+{
+int i;
+
+    spmStart("page write while the SPM is busy", address);
+    address &= ~(unsigned long)(SPM_PAGESIZE - 1);
+    if(address < SIM_BOOT_START){
+        for(i = 0; i < SPM_PAGESIZE; i++)
+            simFlash[address + i] &= spmBuffer[i];  /* writing only clears bits */
+    }
+    memset(spmBuffer, 0xff, sizeof(spmBuffer));
+    rwwBusy = 1;
+    simStats.writes++;
+}
+
+void simRwwEnable(void)
+{
+    if(simStats.time < spmDone)
+        simFail("boot_rww_enable() while the SPM is busy", 0);
+    rwwBusy = 0;
+}
+
+void simDelayUs(unsigned long us)
+{
+    simStats.time += us;
+}
+
+/* ------------------------------- device ---------------------------------- */
+
+/* One pass of the main loop in bootloader/main.c */
+static void loopPass(void)
+{
+    if(left)
+        return;
+    usbPoll();
+    if(exitMainloop)
+        left = 1;
+    simStats.time += SIM_LOOP_US;
+}
+
+static void runUntil(unsigned long long t)
+{
+    while(simStats.time < t && !left)
+        loopPass();
+    if(simStats.time < t)
+        simStats.time = t;
+}
+
+void simIdle(unsigned long us)
+{
+    runUntil(simStats.time + us);
+}
+
+void simInit(const unsigned char *flash)
+{
+    if(flash != NULL)
+        memcpy(simFlash, flash, sizeof(simFlash));
+    else
+        memset(simFlash, 0xff, sizeof(simFlash));
+    memset(&simStats, 0, sizeof(simStats));
+    memset(spmBuffer, 0xff, sizeof(spmBuffer));
+    spmDone = busTime = 0;
+    rwwBusy = left = 0;
+    usbInit();
+    exitMainloop = 0;
+}
+
+int simLeft(void)
+{
+    return left;
+}
+
+/* -------------------------------- host ----------------------------------- */
+
+/* Waits for the next bus slot, the device runs meanwhile */
+static void nextSlot(void)
+{
+    runUntil(busTime);
+    if(simStats.time > busTime)         /* the device was busy in a callback */
+        busTime = simStats.time;
+    busTime += simPacketUs;
+}
+
+/* SETUP or OUT data, retried until the device takes it */
+static int hostOut(unsigned char token, const unsigned char *data, int len)
+{
+    for(;;){
+        if(left)
+            return -1;
+        nextSlot();
+        if(usbTxState == SIM_TX_STALL && token != USBPID_SETUP)
+            return -1;
+        if(usbRxLen == 0)
+            break;
+        simStats.naks++;
+    }
+    memcpy(usbRxBuf, data, len);
+    usbRxToken = token;
+    usbRxLen = len;
+    simStats.transactions++;
+    return 0;
+}
+
+/* return The size of the data packet, -1 for a STALL */
+static int hostIn(unsigned char *data)
+{
+    for(;;){
+        if(left)
+            return -1;
+        nextSlot();
+        if(usbTxState == SIM_TX_STALL)
+            return -1;
+        if(usbTxState == SIM_TX_READY)
+            break;
+        simStats.naks++;
+    }
+    memcpy(data, usbTxBuf, usbTxLen);
+    usbTxState = SIM_TX_IDLE;
+    simStats.transactions++;
+    return usbTxLen;
+}
+
+static void transferStart(unsigned char *setup, unsigned char type, unsigned char request, int id, int len)
+{
+    busTime = (busTime + SIM_FRAME_US - 1) / SIM_FRAME_US * SIM_FRAME_US;
+    setup[0] = type;
+    setup[1] = request;
+    setup[2] = id;
+    setup[3] = 3;                       /* feature */
+    setup[4] = setup[5] = 0;
+    setup[6] = len & 0xff;
+    setup[7] = len >> 8;
+}
+
+static int simSetFeature(Device *dev, const unsigned char *buf, int len)
+{
+unsigned char   setup[8], status[8];
+int             i, n;
+
+    transferStart(setup, USBRQ_TYPE_CLASS | USBRQ_DIR_HOST_TO_DEVICE | 1, USBRQ_HID_SET_REPORT, buf[0], len);
+    if(hostOut(USBPID_SETUP, setup, 8) < 0)
+        goto stall;
+    for(i = 0; i < len; i += n){
+        n = len - i > 8 ? 8 : len - i;
+        if(hostOut(USBPID_OUT, buf + i, n) < 0)
+            goto stall;
+    }
+    if(hostIn(status) < 0)              /* status stage */
+        goto stall;
+    return len;
+stall:
+    if(left)                            /* a real device would be gone */
+        return len;
+    errno = EPIPE;
+    return -1;
+}
+
+static int simGetFeature(Device *dev, unsigned char *buf, int len)
+{
+unsigned char   setup[8];
+int             got = 0, n;
+
+    transferStart(setup, USBRQ_TYPE_CLASS | USBRQ_DIR_DEVICE_TO_HOST | 1, USBRQ_HID_GET_REPORT, buf[0], len);
+    if(hostOut(USBPID_SETUP, setup, 8) < 0)
+        goto stall;
+    do{
+        if((n = hostIn(buf + got)) < 0)
+            goto stall;
+        got += n;
+    }while(n == 8 && got < len);
+    nextSlot();                         /* status stage, zero sized: always taken */
+    return got;
+stall:
+    errno = EPIPE;
+    return -1;
+}
+
+static int simDescriptor(Device *dev, unsigned char *buf, int size)
+{
+int len = sizeof(usbHidReportDescriptor);
+
+    if(len > size)
+        len = size;
+    memcpy(buf, usbHidReportDescriptor, len);
+    return len;
+}
+
+void simDevice(Device *dev)
+{
+    memset(dev, 0, sizeof(*dev));
+    snprintf(dev->name, sizeof(dev->name), "simulated");
+    dev->setFeature = simSetFeature;
+    dev->getFeature = simGetFeature;
+    dev->descriptor = simDescriptor;
+}
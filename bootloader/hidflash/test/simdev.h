@@ -0,0 +1,46 @@
+/* Name: simdev.h
+ * Project: AVR bootloader HID, Linux flasher tests
+ * Author: Francis-Olivier Gradel
+ * Tabsize: 4
+ * License: GNU GPL v2 (see License.txt)
+ */
+
+#ifndef __simdev_h_included__
+#define __simdev_h_included__
+
+#include "../hidflash.h"
+
+/* bootloader/main.c built for the host, behind a simulated low speed bus.
+ * Time only exists in the simulation: transactions, main loop passes and
+ * the SPM advance it by the amounts below, nothing else does.
+ */
+#define SIM_FLASH_SIZE  0x8000
+#define SIM_FRAME_US    1000            /* a transfer starts on a frame */
+#define SIM_LOOP_US     15              /* main loop pass, usbPoll() */
+#define SIM_SPM_US      4500            /* page erase or write, datasheet maximum */
+
+typedef struct {
+    unsigned long long  time;           /* us */
+    unsigned long       transactions;   /* SETUP, OUT or IN the device answered */
+    unsigned long       naks;
+    unsigned long       erases;
+    unsigned long       writes;
+} SimStats;
+
+extern SimStats         simStats;
+extern unsigned char    simFlash[SIM_FLASH_SIZE];
+extern unsigned         simPacketUs;    /* bus time of one transaction */
+
+/* Resets the bootloader, with flash as the application (NULL: erased) */
+void    simInit(const unsigned char *flash);
+
+/* A Device going to the simulated bootloader */
+void    simDevice(Device *dev);
+
+/* return != 0 once a SET_REPORT told the bootloader to leave */
+int     simLeft(void);
+
+/* Runs the bootloader's main loop for us microseconds, no host traffic */
+void    simIdle(unsigned long us);
+
+#endif /* __simdev_h_included__ */
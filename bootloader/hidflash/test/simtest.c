@@ -0,0 +1,130 @@
+/* Name: simtest.c
+ * Project: AVR bootloader HID, Linux flasher tests
+ * Author: Francis-Olivier Gradel
+ * Tabsize: 4
+ * License: GNU GPL v2 (see License.txt)
+ */
+
+/* flash.c against the simulated bootloader (simdev.c): every report of
+ * bootloader/main.c.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "simdev.h"
+
+#define APP_END     0x7000              /* the bootloader starts there */
+
+static Image        image;
+static Device       dev;
+static FlashOptions options;
+static FlashStats   stats;
+static int          failures;
+
+#define check(cond) do{ if(!(cond)) fail(__func__, __LINE__, #cond); }while(0)
+
+static void fail(const char *test, int line, const char *cond)
+{
+    fprintf(stderr, "%s:%d: %s failed", test, line, cond);
+    if(dev.error[0])
+        fprintf(stderr, " (%s)", dev.error);
+    fputc('\n', stderr);
+    failures++;
+}
+
+/* A fresh bootloader over flash (NULL: erased) */
+static void start(const unsigned char *flash)
+{
+    simInit(flash);
+    simDevice(&dev);
+    memset(&options, 0, sizeof(options));
+    options.bootStart = APP_END;
+    check(bootloaderOpen(&dev) == 0);
+}
+
+/* Random bytes from address to end, a fixed seed per test */
+static void imageRandom(unsigned long address, unsigned long end, unsigned seed)
+{
+    srand(seed);
+    memset(image.data, 0xff, sizeof(image.data));
+    memset(image.used, 0, sizeof(image.used));
+    for(; address < end; address++){
+        image.data[address] = rand();
+        image.used[address / REPORT_DATA] = 1;
+    }
+    image.size = end;
+}
+
+static int flashMatches(void)
+{
+    return memcmp(simFlash, image.data, image.size) == 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void testOpen(void)
+{
+    start(NULL);
+    check(dev.pageSize == 128);
+    check(dev.flashSize == 0x8000);
+    check((dev.reports & 0x06) == 0x06);    /* reports 1 and 2 */
+}
+
+/* Report 2, the whole application */
+static void testPageWrite(void)
+{
+    imageRandom(0, APP_END, 1);
+    start(NULL);
+    check(bootloaderFlash(&dev, &image, &options, &stats) == 0);
+    simIdle(20000);
+    check(flashMatches());
+    check(stats.sent == APP_END / REPORT_DATA);
+    check(simStats.erases == APP_END / 128);
+}
+
+/* Report 2 off the pages: page boundaries fall within the 8 byte chunks */
+static void testUnalignedWrite(void)
+{
+unsigned char   buf[REPORT_SIZE];
+unsigned long   address;
+
+    imageRandom(0, APP_END, 6);
+    start(NULL);
+    for(address = 0x0040; address < 0x2040; address += REPORT_DATA){
+        buf[0] = 2;
+        buf[1] = address;
+        buf[2] = address >> 8;
+        buf[3] = 0;
+        memcpy(&buf[4], &image.data[address], REPORT_DATA);
+        check(dev.setFeature(&dev, buf, sizeof(buf)) > 0);
+    }
+    check(bootloaderLeave(&dev) == 0);
+    check(memcmp(&simFlash[0x0080], &image.data[0x0080], 0x2000 - 0x0080) == 0);
+}
+
+/* The last report is in flash when the bootloader leaves */
+static void testLeave(void)
+{
+    imageRandom(0x1000, 0x1100, 5);
+    start(NULL);
+    check(bootloaderFlash(&dev, &image, &options, &stats) == 0);
+    check(bootloaderLeave(&dev) == 0);
+    check(simLeft());
+    check(flashMatches());
+}
+
+int main(int argc, char **argv)
+{
+    testOpen();
+    testPageWrite();
+    testUnalignedWrite();
+    testLeave();
+    if(failures){
+        fprintf(stderr, "%d failures\n", failures);
+        return 1;
+    }
+    printf("simulated bootloader: all tests passed\n");
+    return 0;
+}
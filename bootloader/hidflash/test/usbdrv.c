@@ -0,0 +1,92 @@
+/* Name: usbdrv.c (simulated)
+ * Project: AVR bootloader HID, Linux flasher tests
+ * Author: Francis-Olivier Gradel
+ * Tabsize: 4
+ * License: GNU GPL v2 (see License.txt)
+ */
+
+/* usbProcessRx() and usbBuildTxBlock() of V-USB minus the standard
+ * requests, which the simulated host never sends. The interrupt routine's
+ * part, ACK or NAK and taking the packet, is in simdev.c.
+ */
+
+#include <string.h>
+#include "usbdrv.h"
+
+usbMsgPtr_t     usbMsgPtr;
+volatile schar  usbRxLen;
+volatile uchar  usbRxToken;
+uchar           usbRxBuf[8];
+uchar           usbTxBuf[8];
+uchar           usbTxLen;
+uchar           usbTxState;
+
+static usbMsgLen_t  usbMsgLen = USB_NO_MSG;
+static uchar        usbMsgUserRw;   /* usbFunctionSetup() returned USB_NO_MSG */
+
+void usbInit(void)
+{
+    usbRxLen = 0;
+    usbTxState = SIM_TX_IDLE;
+    usbMsgLen = USB_NO_MSG;
+}
+
+static void usbProcessRx(uchar *data, uchar len)
+{
+usbRequest_t    *rq = (void *)data;
+usbMsgLen_t     replyLen;
+uchar           rval;
+
+    if(usbRxToken == USBPID_SETUP){
+        usbTxState = SIM_TX_IDLE;       /* abort pending transmit, clears a STALL */
+        usbMsgUserRw = 0;
+        replyLen = usbFunctionSetup(data);
+        if(replyLen == USB_NO_MSG){
+            if((rq->bmRequestType & USBRQ_DIR_MASK) != USBRQ_DIR_HOST_TO_DEVICE)
+                replyLen = rq->wLength.bytes[0];
+            usbMsgUserRw = 1;
+        }else if(replyLen > rq->wLength.word){
+            replyLen = rq->wLength.word;
+        }
+        usbMsgLen = replyLen;
+    }else if(usbMsgUserRw){             /* data stage of a control write */
+        rval = usbFunctionWrite(data, len);
+        if(rval == 0xff)
+            usbTxState = SIM_TX_STALL;
+        else if(rval != 0)
+            usbMsgLen = 0;              /* status stage: zero sized packet */
+    }
+}
+
+static void usbBuildTxBlock(void)
+{
+uchar   len = usbMsgLen > 8 ? 8 : usbMsgLen;
+
+    usbMsgLen -= len;
+    if(len){
+#if USB_CFG_IMPLEMENT_FN_READ
+        if(usbMsgUserRw){
+            len = usbFunctionRead(usbTxBuf, len);
+        }else
+#endif
+        {
+            memcpy(usbTxBuf, usbMsgPtr, len);
+            usbMsgPtr += len;
+        }
+    }
+    if(len < 8)                         /* a short packet ends the transfer */
+        usbMsgLen = USB_NO_MSG;
+    usbTxLen = len;
+    usbTxState = SIM_TX_READY;
+}
+
+void usbPoll(void)
+{
+    if(usbRxLen > 0){
+        usbProcessRx(usbRxBuf, usbRxLen);
+        if(usbRxLen > 0)                /* only mark as available if not inactivated */
+            usbRxLen = 0;
+    }
+    if(usbTxState == SIM_TX_IDLE && usbMsgLen != USB_NO_MSG)
+        usbBuildTxBlock();
+}
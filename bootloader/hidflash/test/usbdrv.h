@@ -0,0 +1,77 @@
+/* Name: usbdrv.h (simulated)
+ * Project: AVR bootloader HID, Linux flasher tests
+ * Author: Francis-Olivier Gradel
+ * Tabsize: 4
+ * License: GNU GPL v2 (see License.txt)
+ */
+
+/* The part of the V-USB API bootloader/main.c uses, with the same meaning.
+ * usbdrv.c implements the driver side, simdev.c plays the host.
+ */
+
+#ifndef __sim_usbdrv_h_included__
+#define __sim_usbdrv_h_included__
+
+#include "usbconfig.h"                  /* the one next to the bootloader source */
+#undef usbMsgPtr_t                      /* a 16 bit scalar there, a pointer here */
+
+typedef unsigned char   uchar;
+typedef signed char     schar;
+typedef uchar           *usbMsgPtr_t;
+typedef uchar           usbMsgLen_t;
+
+typedef union usbWord{
+    unsigned short  word;
+    uchar           bytes[2];
+}usbWord_t;
+
+typedef struct usbRequest{
+    uchar       bmRequestType;
+    uchar       bRequest;
+    usbWord_t   wValue;
+    usbWord_t   wIndex;
+    usbWord_t   wLength;
+}usbRequest_t;
+
+#define USB_NO_MSG                  ((usbMsgLen_t)-1)
+
+#define USBRQ_DIR_MASK              0x80
+#define USBRQ_DIR_HOST_TO_DEVICE    (0<<7)
+#define USBRQ_DIR_DEVICE_TO_HOST    (1<<7)
+#define USBRQ_TYPE_MASK             0x60
+#define USBRQ_TYPE_CLASS            (1<<5)
+#define USBRQ_HID_GET_REPORT        0x01
+#define USBRQ_HID_SET_REPORT        0x09
+
+#define USBPID_SETUP                0x2d
+#define USBPID_OUT                  0xe1
+
+extern usbMsgPtr_t  usbMsgPtr;
+extern volatile schar usbRxLen;     /* > 0: a packet waits for usbPoll(), < 0: NAK everything */
+extern volatile uchar usbRxToken;
+
+#define usbDisableAllRequests()     usbRxLen = -1
+#define usbEnableAllRequests()      usbRxLen = 0
+#define usbAllRequestsAreDisabled() (usbRxLen < 0)
+
+#define usbDeviceConnect()
+#define usbDeviceDisconnect()
+
+void    usbInit(void);
+void    usbPoll(void);
+
+uchar   usbFunctionSetup(uchar data[8]);
+uchar   usbFunctionWrite(uchar *data, uchar len);
+uchar   usbFunctionRead(uchar *data, uchar len);
+
+/* Host side of the simulated bus, see simdev.c */
+#define SIM_TX_IDLE     0               /* IN tokens get a NAK */
+#define SIM_TX_READY    1
+#define SIM_TX_STALL    2
+
+extern uchar    usbRxBuf[8];
+extern uchar    usbTxBuf[8];
+extern uchar    usbTxLen;               /* bytes in usbTxBuf when SIM_TX_READY */
+extern uchar    usbTxState;
+
+#endif
@@ -0,0 +1,19 @@
+/* Name: crc16.h (simulated)
+ * Project: AVR bootloader HID, Linux flasher tests
+ * Author: Francis-Olivier Gradel
+ * Tabsize: 4
+ * License: GNU GPL v2 (see License.txt)
+ */
+
+#ifndef __sim_crc16_h_included__
+#define __sim_crc16_h_included__
+
+/* The C version avr-libc documents for its assembler one */
+static inline unsigned short _crc_ccitt_update(unsigned short crc, unsigned char data)
+{
+    data ^= crc & 0xff;
+    data ^= data << 4;
+    return ((((unsigned short)data << 8) | (crc >> 8)) ^ (unsigned char)(data >> 4) ^ ((unsigned short)data << 3));
+}
+
+#endif
@@ -0,0 +1,16 @@
+/* Name: delay.h (simulated)
+ * Project: AVR bootloader HID, Linux flasher tests
+ * Author: Francis-Olivier Gradel
+ * Tabsize: 4
+ * License: GNU GPL v2 (see License.txt)
+ */
+
+#ifndef __sim_delay_h_included__
+#define __sim_delay_h_included__
+
+void            simDelayUs(unsigned long us);
+
+#define _delay_ms(ms)   simDelayUs((unsigned long)((ms) * 1000))
+#define _delay_us(us)   simDelayUs((unsigned long)(us))
+
+#endif
@@ -0,0 +1,171 @@
+/* Keypad code filter, chord.c, through the Intellivision driver
+ * Copyright (C) 2024 Francis-Olivier Gradel, B.Eng.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * The author may be contacted at info@retronicdesign.com
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <avr/io.h>
+#include "sim.h"
+#include "intellivision.h"
+#include "chord.h"
+
+/* A trace holds the 8 bit code intellivision.c reads at every poll, in
+ * the format of the debounce traces: "e7*20" repeats a code, '#' starts a
+ * comment and "# expect N" gives the number of report changes. Each trace
+ * is replayed through the driver, so the codes a single control gives are
+ * those of its table. A report change must come exactly
+ * CHORD_STABLE_SAMPLES or CHORD_COMBO_SAMPLES samples into a run of one
+ * code, and once a code is held CHORD_COMBO_SAMPLES the report must be
+ * that of the code held alone.
+ */
+#define TRACE_MAX	4096
+#define REPORT_MAX	8
+
+static unsigned char trace[TRACE_MAX];
+static int trace_len, trace_expect;
+static unsigned char code = 0xff;
+
+/* Code bits 0-5 on PB0-5, bit 6 on PD7, bit 7 on PC2 */
+static unsigned char intellivisionPins(char port)
+{
+	switch (port)
+	{
+		case 'B': return 0xC0 | (code & 0x3F);
+		case 'C': return (code & 0x80) ? 0xff : ~(1<<PC2);
+		case 'D': return (code & 0x40) ? 0xff : ~(1<<PD7);
+	}
+	return 0xff;
+}
+
+static int loadTrace(const char *path)
+{
+	FILE *f = fopen(path, "r");
+	char line[256], *p, *end;
+	unsigned long sample, count;
+
+	if (!f)
+	{
+		perror(path);
+		return -1;
+	}
+	trace_len = 0;
+	trace_expect = -1;
+	while (fgets(line, sizeof(line), f))
+	{
+		if ((p = strchr(line, '#')) != NULL)
+		{
+			sscanf(p, "# expect %d", &trace_expect);
+			*p = 0;
+		}
+		for (p = strtok(line, " \t\r\n"); p; p = strtok(NULL, " \t\r\n"))
+		{
+			sample = strtoul(p, &end, 16);
+			count = 1;
+			if (*end == '*')
+				count = strtoul(end+1, &end, 10);
+			if (*end || sample > 0xff || trace_len + count > TRACE_MAX)
+			{
+				fprintf(stderr, "%s: bad sample \"%s\"\n", path, p);
+				fclose(f);
+				return -1;
+			}
+			while (count--)
+				trace[trace_len++] = sample;
+		}
+	}
+	fclose(f);
+	return trace_len ? 0 : -1;
+}
+
+static void poll(Gamepad *pad, unsigned char c, unsigned char *report)
+{
+	code = c;
+	pad->update();
+	pad->buildReport(report, 1);
+}
+
+static unsigned char steady[256][REPORT_MAX];	// Report of each code held alone
+
+static int replay(const char *path)
+{
+	Gamepad *pad;
+	unsigned char report[REPORT_MAX], last[REPORT_MAX];
+	int i, j, run = 0, size, changes = 0, raw_changes = 0, latency = 0, errors = 0;
+
+	if (loadTrace(path) < 0)
+		return 1;
+
+	simInit(intellivisionPins);
+	pad = intellivisionGetGamepad();
+	size = pad->buildReport(report, 1);
+	for (i = 0; i < trace_len; i++)
+	{
+		pad->init();	// Starts the filter over
+		for (j = 0; j < CHORD_COMBO_SAMPLES; j++)
+			poll(pad, trace[i], steady[trace[i]]);
+	}
+
+	pad->init();
+	for (j = 0; j < CHORD_COMBO_SAMPLES; j++)
+		poll(pad, trace[0], last);
+	for (i = 0; i < trace_len; i++)
+	{
+		if (i && trace[i] != trace[i-1])
+		{
+			raw_changes++;
+			run = 0;
+		}
+		run++;
+		poll(pad, trace[i], report);
+		if (memcmp(report, last, size))
+		{
+			changes++;
+			if (run-1 > latency)
+				latency = run-1;
+			if (run != CHORD_STABLE_SAMPLES && run != CHORD_COMBO_SAMPLES && errors++ < 4)
+				fprintf(stderr, "%s: sample %d: report change %d samples into %02x\n", path, i, run, trace[i]);
+			memcpy(last, report, size);
+		}
+		if (run >= CHORD_COMBO_SAMPLES && memcmp(report, steady[trace[i]], size) && errors++ < 4)
+			fprintf(stderr, "%s: sample %d: %02x held %d samples, not reported\n", path, i, trace[i], run);
+	}
+
+	printf("%-32s %5d samples %4d raw changes %4d reported, %d samples late at most\n",
+		path, trace_len, raw_changes, changes, latency);
+	if (trace_expect >= 0 && changes != trace_expect)
+	{
+		fprintf(stderr, "%s: %d report changes, %d expected\n", path, changes, trace_expect);
+		errors++;
+	}
+	return errors != 0;
+}
+
+int main(int argc, char **argv)
+{
+	int i, failed = 0;
+
+	for (i = 1; i < argc; i++)
+		failed += replay(argv[i]);
+	if (failed)
+	{
+		fprintf(stderr, "chord: %d of %d traces failed\n", failed, argc-1);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,200 @@
+/* Feature report commands of config.c
+ * Copyright (C) 2024 Francis-Olivier Gradel, B.Eng.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * The author may be contacted at info@retronicdesign.com
+ */
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include "sim.h"
+#include "config.h"
+
+#define FIELD(f)	offsetof(Config, f)
+
+/* The EEPROM journal of config.c: slots of 64 bytes, [seq, version, length,
+ * owner (2 bytes), data, CRC (2 bytes)] */
+#define SLOT_SIZE	64
+#define NUM_SLOTS	(SIM_EEPROM_SIZE/SLOT_SIZE)
+#define SLOT_DATA	5
+
+/* CFG_CMD_WRITE of one byte at offset */
+static unsigned char writeByte(unsigned char offset, unsigned char value)
+{
+	unsigned char data[3] = { CFG_CMD_WRITE, offset, value };
+
+	return configFeatureWrite(data, sizeof(data));
+}
+
+static void start(void)
+{
+	simInit(NULL);
+	configInit();
+}
+
+/* CFG_CMD_SAVE, then configTask() for steps EEPROM writes (a whole slot
+ * and more with SLOT_SIZE+1) */
+static void save(int steps)
+{
+	unsigned char cmd = CFG_CMD_SAVE;
+
+	configFeatureWrite(&cmd, 1);
+	while (steps--)
+		configTask();
+}
+
+/* Saves value as center, the power cycles in between are configInit() */
+static void saveCenter(unsigned char value)
+{
+	check(writeByte(FIELD(center), value) == 1);
+	save(SLOT_SIZE+1);
+}
+
+static unsigned char slotCenter(int slot)
+{
+	return simEeprom[slot*SLOT_SIZE + SLOT_DATA + FIELD(center)];
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void testWrite(void)
+{
+	unsigned char data[CFG_FEATURE_SIZE] = { CFG_CMD_WRITE, FIELD(remap), 1, 0, CFG_REMAP_DROP, 3, 4, 5 };
+
+	start();
+	check(configFeatureWrite(data, sizeof(data)) == 1);
+	check(config.remap[0] == 1 && config.remap[1] == 0 && config.remap[2] == CFG_REMAP_DROP);
+
+	check(writeByte(FIELD(turbo_rate), CFG_TURBO_RATE_MAX) == 1);
+	check(writeByte(FIELD(turbo_duty), 99) == 1);
+	check(writeByte(FIELD(keymap), 0x65) == 1);
+	check(writeByte(FIELD(keymap)+1, 0xE7) == 1);
+	check(writeByte(FIELD(keymap)+2, 0) == 1);
+	check(config.turbo_rate == CFG_TURBO_RATE_MAX && config.turbo_duty == 99);
+	check(config.keymap[0] == 0x65 && config.keymap[1] == 0xE7 && config.keymap[2] == 0);
+
+	check(writeByte(FIELD(divider), 0) == 1);	// Made 1, not refused
+	check(config.divider == 1);
+}
+
+/* A refused write leaves the whole RAM copy as it was, the valid bytes of
+ * the same command included
+ */
+static void testRefused(void)
+{
+	unsigned char data[CFG_FEATURE_SIZE] = { CFG_CMD_WRITE, FIELD(remap), 2, 2, 2, 2, 2, CFG_REMAP_SIZE };
+	Config before;
+
+	start();
+	memcpy(&before, &config, sizeof(Config));
+
+	check(configFeatureWrite(data, sizeof(data)) == CFG_WRITE_REFUSED);
+	check(writeByte(FIELD(remap)+3, 0x80) == CFG_WRITE_REFUSED);
+	check(writeByte(FIELD(turbo_rate), 0) == CFG_WRITE_REFUSED);
+	check(writeByte(FIELD(turbo_rate), CFG_TURBO_RATE_MAX+1) == CFG_WRITE_REFUSED);
+	check(writeByte(FIELD(turbo_duty), 0) == CFG_WRITE_REFUSED);
+	check(writeByte(FIELD(turbo_duty), 100) == CFG_WRITE_REFUSED);
+	check(writeByte(FIELD(keymap), 0x66) == CFG_WRITE_REFUSED);
+	check(writeByte(FIELD(keymap)+5, 0xDF) == CFG_WRITE_REFUSED);
+	check(writeByte(FIELD(keymap)+CFG_KEYMAP_SIZE-1, 0xE8) == CFG_WRITE_REFUSED);
+	check(memcmp(&before, &config, sizeof(Config)) == 0);
+}
+
+static void testDefaultsValid(void)
+{
+	unsigned char cmd = CFG_CMD_DEFAULTS;
+
+	start();
+	check(writeByte(FIELD(center), config.center) == 1);	// Checks the whole copy
+	check(configFeatureWrite(&cmd, 1) == 1);
+}
+
+/* The saves go round the slots, past the wrap of the sequence number too,
+ * and the last one is what the next boot loads
+ */
+static void testJournalWrap(void)
+{
+	int i;
+
+	start();
+	for (i=0; i<300; i++)
+		saveCenter(i);
+	check(slotCenter(299 % NUM_SLOTS) == (unsigned char)299);
+	check(slotCenter(300 % NUM_SLOTS) == (unsigned char)(300-NUM_SLOTS));
+
+	configInit();
+	check(config.center == (unsigned char)299);
+}
+
+/* A slot whose CRC does not check is skipped, the one before it is loaded */
+static void testCrcRejected(void)
+{
+	start();
+	saveCenter(1);
+	saveCenter(2);
+	check(slotCenter(0) == 1 && slotCenter(1) == 2);
+
+	simEeprom[1*SLOT_SIZE + SLOT_DATA + FIELD(gain)] ^= 0x01;
+	configInit();
+	check(config.center == 1);
+
+	simEeprom[0*SLOT_SIZE + SLOT_SIZE-1] ^= 0x80;	// The CRC itself
+	configInit();
+	check(config.center == CFG_DEFAULT_CENTER);
+}
+
+/* Power lost in the middle of a save: over an erased slot, and over the
+ * oldest record once the journal has wrapped. The record before is loaded.
+ */
+static void testTornWrite(void)
+{
+	int i;
+
+	start();
+	saveCenter(1);
+	check(writeByte(FIELD(center), 2) == 1);
+	save(SLOT_SIZE/2);
+	configInit();
+	check(config.center == 1);
+
+	start();
+	for (i=1; i<=NUM_SLOTS; i++)
+		saveCenter(i);
+	check(writeByte(FIELD(center), 0x55) == 1);
+	save(SLOT_SIZE-1);	// All but the last byte of the CRC
+	configInit();
+	check(config.center == NUM_SLOTS);
+
+	saveCenter(0x66);	// And the next save goes on from there
+	configInit();
+	check(config.center == 0x66);
+}
+
+int main(void)
+{
+	int failed = 0;
+
+	failed += simRun("testWrite", testWrite);
+	failed += simRun("testRefused", testRefused);
+	failed += simRun("testDefaultsValid", testDefaultsValid);
+	failed += simRun("testJournalWrap", testJournalWrap);
+	failed += simRun("testCrcRejected", testCrcRejected);
+	failed += simRun("testTornWrite", testTornWrite);
+	if (failed)
+		return 1;
+	printf("config: all tests passed\n");
+	return 0;
+}
@@ -0,0 +1,131 @@
+/* Replay of switch bounce traces through debounce.c
+ * Copyright (C) 2024 Francis-Olivier Gradel, B.Eng.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * The author may be contacted at info@retronicdesign.com
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "debounce.h"
+
+/* A trace is the raw port sample of every controller poll (~2kHz), as two
+ * hex digits, active low like the drivers read them. "fe*20" repeats a
+ * sample, '#' starts a comment and "# expect N" gives the number of changes
+ * of the debounced state (debounce.h defaults). Each sample is checked
+ * against a plain per input model: a press goes through at once, a release
+ * after DEBOUNCE_RELEASE_SAMPLES released samples in a row.
+ */
+#define TRACE_MAX	4096
+
+static unsigned char trace[TRACE_MAX];
+static int trace_len, trace_expect;
+
+static int loadTrace(const char *path)
+{
+	FILE *f = fopen(path, "r");
+	char line[256], *p, *end;
+	unsigned long sample, count;
+
+	if (!f)
+	{
+		perror(path);
+		return -1;
+	}
+	trace_len = 0;
+	trace_expect = -1;
+	while (fgets(line, sizeof(line), f))
+	{
+		if ((p = strchr(line, '#')) != NULL)
+		{
+			sscanf(p, "# expect %d", &trace_expect);
+			*p = 0;
+		}
+		for (p = strtok(line, " \t\r\n"); p; p = strtok(NULL, " \t\r\n"))
+		{
+			sample = strtoul(p, &end, 16);
+			count = 1;
+			if (*end == '*')
+				count = strtoul(end+1, &end, 10);
+			if (*end || sample > 0xff || trace_len + count > TRACE_MAX)
+			{
+				fprintf(stderr, "%s: bad sample \"%s\"\n", path, p);
+				fclose(f);
+				return -1;
+			}
+			while (count--)
+				trace[trace_len++] = sample;
+		}
+	}
+	fclose(f);
+	return trace_len ? 0 : -1;
+}
+
+static int replay(const char *path)
+{
+	Debouncer db;
+	unsigned char state, model, run[8];
+	int i, bit, raw_changes = 0, changes = 0, errors = 0;
+
+	if (loadTrace(path) < 0)
+		return 1;
+
+	debounceInit(&db, trace[0]);
+	model = state = trace[0];
+	memset(run, 0, sizeof(run));
+	for (i = 1; i < trace_len; i++)
+	{
+		for (bit = 0; bit < 8; bit++)
+		{
+			if (!(trace[i] & (1<<bit)))
+			{
+				model &= ~(1<<bit);
+				run[bit] = 0;
+			}
+			else if (++run[bit] >= DEBOUNCE_RELEASE_SAMPLES)
+				model |= (1<<bit);
+		}
+		if (trace[i] != trace[i-1])
+			raw_changes++;
+		if (debounce(&db, trace[i]) != state)
+			changes++;
+		state = db.state;
+		if (state != model && errors++ < 4)
+			fprintf(stderr, "%s: sample %d: %02x, %02x expected\n", path, i, state, model);
+	}
+
+	printf("%-32s %5d samples %4d raw changes %4d debounced\n", path, trace_len, raw_changes, changes);
+	if (DEBOUNCE_RELEASE_SAMPLES == 4 && trace_expect >= 0 && changes != trace_expect)
+	{
+		fprintf(stderr, "%s: %d debounced changes, %d expected\n", path, changes, trace_expect);
+		errors++;
+	}
+	return errors != 0;
+}
+
+int main(int argc, char **argv)
+{
+	int i, failed = 0;
+
+	for (i = 1; i < argc; i++)
+		failed += replay(argv[i]);
+	if (failed)
+	{
+		fprintf(stderr, "debounce: %d of %d traces failed\n", failed, argc-1);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,201 @@
+/* Intellivision decode tables against the switch decode of v3.2
+ * Copyright (C) 2024 Francis-Olivier Gradel, B.Eng.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * The author may be contacted at info@retronicdesign.com
+ */
+#include <stdio.h>
+#include <string.h>
+#include <avr/io.h>
+#include "sim.h"
+#include "intellivision.h"
+#include "chord.h"
+
+/* Built once per Intellivision project. With INTELLIVISION_FLASHBACK the
+ * controller is wired as on the Flashback consoles and intellivision.c goes
+ * through its port permutation table first.
+ */
+#ifdef INTELLIVISION_FLASHBACK
+#define VARIANT	"intellivision flashback"
+#else
+#define VARIANT	"intellivision"
+#endif
+
+#define REPORT_SIZE	5
+
+static unsigned char pinb, pinc, pind;
+
+static unsigned char intellivisionPins(char port)
+{
+	switch (port)
+	{
+		case 'B': return pinb;
+		case 'C': return pinc;
+		case 'D': return pind;
+	}
+	return 0xff;
+}
+
+/* intellivisionUpdate() of v3.2, before the chord filter */
+static unsigned char baselineCode(void)
+{
+#ifdef INTELLIVISION_FLASHBACK
+	return (((pinb&(1<<PB0))?(1<<3):0)|
+			((pinb&(1<<PB1))?(1<<4):0)|
+			((pinb&(1<<PB3))?(1<<1):0)|
+			((pinb&(1<<PB4))?(1<<6):0)|
+			((pinb&(1<<PB5))?(1<<5):0)|
+			((pinc&(1<<PC2))?(1<<0):0)|
+			((pind&(1<<PD7))?(1<<2):0)|
+			((pinc&(1<<PC3))?(1<<7):0));
+#else
+	return ((pinb&0x3F) | ((pinc&(1<<PC2))<<5) | ((pind&(1<<PD7))>>1));
+#endif
+}
+
+/* intellivisionBuildReport() of v3.2. but[] has a third byte for the write
+ * of the action button default, which went past the end of the array. */
+static void baselineReport(unsigned char code, unsigned char *reportBuffer)
+{
+	int x,y;
+	unsigned char tmp,but[3];
+
+	tmp = (code ^ 0xff);
+
+	//Scan direction disc first
+	switch(tmp&0x8F)
+	{
+		case 0b00000010: x = 0x80; y = 0x00; but[0]=but[1]=0; break; //D1 Disc N
+		case 0b10000010: x = 0xC0; y = 0x00; but[0]=but[1]=0; break; //D2 Disc NNE
+		case 0b10000110: x = 0xFF; y = 0x00; but[0]=but[1]=0; break; //D3 Disc NE
+		case 0b00000110: x = 0xFF; y = 0x40; but[0]=but[1]=0; break; //D4 Disc ENE
+		case 0b00000100: x = 0xFF; y = 0x80; but[0]=but[1]=0; break; //D5 Disc E
+		case 0b10000100: x = 0xFF; y = 0xC0; but[0]=but[1]=0; break; //D6 Disc ESE
+		case 0b10001100: x = 0xFF; y = 0xFF; but[0]=but[1]=0; break; //D7 Disc SE
+		case 0b00001100: x = 0xC0; y = 0xFF; but[0]=but[1]=0; break; //D8 Disc SSE
+		case 0b00001000: x = 0x80; y = 0xFF; but[0]=but[1]=0; break; //D9 Disc S
+		case 0b10001000: x = 0x40; y = 0xFF; but[0]=but[1]=0; break; //D10 Disc SSW
+		case 0b10001001: x = 0x00; y = 0xFF; but[0]=but[1]=0; break; //D11 Disc SW
+		case 0b00001001: x = 0x00; y = 0xC0; but[0]=but[1]=0; break; //D12 Disc WSW
+		case 0b00000001: x = 0x00; y = 0x80; but[0]=but[1]=0; break; //D13 Disc W
+		case 0b10000001: x = 0x00; y = 0x40; but[0]=but[1]=0; break; //D14 Disc WNW
+		case 0b10000011: x = 0x00; y = 0x00; but[0]=but[1]=0; break; //D15 Disc NW
+		case 0b00000011: x = 0x40; y = 0x00; but[0]=but[1]=0; break; //D16 Disc NNW
+
+		default: y = x = 0x80; //D0 Disc centered
+	}
+
+	//Then scan action buttons (3 buttons)
+	switch(tmp&0x70)
+	{
+		case 0b01010000:  but[1]=0b00000000; but[0]=0b00000001; break; //S1 Button 1
+		case 0b01100000:  but[1]=0b00000000; but[0]=0b00000010; break; //S2 Button 2
+		case 0b00110000:  but[1]=0b00000000; but[0]=0b00000100; break; //S3 Button 3
+
+		default: but[2]=but[1]=but[0]=0; //All buttons depressed
+	}
+
+	//Finally, scan keypad (12 buttons)
+	switch(tmp)
+	{
+		case 0b00011000: x = y = 0x80;  but[1]=0b00000000; but[0]=0b00001000; break; //K1 Keypad 1
+		case 0b00101000: x = y = 0x80;  but[1]=0b00000000; but[0]=0b00010000; break; //K2 Keypad 2
+		case 0b01001000: x = y = 0x80;  but[1]=0b00000000; but[0]=0b00100000; break; //K3 Keypad 3
+		case 0b00010100: x = y = 0x80;  but[1]=0b00000000; but[0]=0b01000000; break; //K4 Keypad 4
+		case 0b00100100: x = y = 0x80;  but[1]=0b00000000; but[0]=0b10000000; break; //K5 Keypad 5
+		case 0b01000100: x = y = 0x80;  but[1]=0b00000001; but[0]=0b00000000; break; //K6 Keypad 6
+		case 0b00010010: x = y = 0x80;  but[1]=0b00000010; but[0]=0b00000000; break; //K7 Keypad 7
+		case 0b00100010: x = y = 0x80;  but[1]=0b00000100; but[0]=0b00000000; break; //K8 Keypad 8
+		case 0b01000010: x = y = 0x80;  but[1]=0b00001000; but[0]=0b00000000; break; //K9 Keypad 9
+		case 0b00010001: x = y = 0x80;  but[1]=0b00010000; but[0]=0b00000000; break; //Clear Keypad Clear
+		case 0b00100001: x = y = 0x80;  but[1]=0b00100000; but[0]=0b00000000; break; //K0 Keypad 0
+		case 0b01000001: x = y = 0x80;  but[1]=0b01000000; but[0]=0b00000000; break; //Enter Keypad Enter
+
+		//Special case, keypad combinations
+		case 0b01011010: x = y = 0x80;  but[1]=0b10000000; but[0]=0b00000000; break; //[K1+K9] to Btn 16 (Pause)
+
+		default: but[1]=0; but[0] &= 0x07; //Keypad depressed
+	}
+
+	reportBuffer[0] = x;
+	reportBuffer[1] = y;
+	reportBuffer[2] = but[0];
+	reportBuffer[3] = but[1];
+	reportBuffer[4] = tmp;
+}
+
+/* Every level of the input pins, each held long enough for the chord filter
+ * to take it whatever it decodes to. The report must be the one of v3.2 for
+ * the same pins. Through the 6 bits of PORTB this reads every entry of the
+ * Flashback permutation table, and through the 8 input bits every one of
+ * the 256 codes of the decode table.
+ */
+static void testPins(void)
+{
+	Gamepad *pad;
+	unsigned char report[REPORT_SIZE], expect[REPORT_SIZE], codes[256/8];
+	int b, cd, i, j, mismatches = 0;
+
+	simInit(intellivisionPins);
+	pad = intellivisionGetGamepad();
+	check(pad->buildReport(report, 1) == REPORT_SIZE);
+	memset(codes, 0, sizeof(codes));
+
+	for (b = 0; b < 64; b++)
+	{
+		for (cd = 0; cd < 8; cd++)
+		{
+			pinb = 0xC0 | b;
+			pinc = ~((1<<PC2)|(1<<PC3)) | ((cd&1) ? (1<<PC2) : 0) | ((cd&2) ? (1<<PC3) : 0);
+			pind = ~(1<<PD7) | ((cd&4) ? (1<<PD7) : 0);
+
+			pad->init();	// Starts the filter over
+			simDDRB &= ~(1<<PB2);	// The Flashback ground, read so that its table entries are too
+			for (j = 0; j < CHORD_COMBO_SAMPLES; j++)
+			{
+				pad->update();
+				pad->buildReport(report, 1);
+			}
+
+			i = baselineCode();
+			codes[i>>3] |= 1<<(i&7);
+			baselineReport(i, expect);
+			if (memcmp(report, expect, REPORT_SIZE))
+			{
+				if (mismatches++ < 4)
+					fprintf(stderr, "PINB %02x PINC %02x PIND %02x: report %02x %02x %02x %02x %02x, v3.2 %02x %02x %02x %02x %02x\n",
+						pinb, pinc, pind, report[0], report[1], report[2], report[3], report[4],
+						expect[0], expect[1], expect[2], expect[3], expect[4]);
+			}
+		}
+	}
+	check(mismatches == 0);
+
+	// The pins gave every code
+	for (i = 0; i < (int)sizeof(codes); i++)
+		check(codes[i] == 0xff);
+}
+
+int main(void)
+{
+	int failed = 0;
+
+	failed += simRun("testPins", testPins);
+	if (failed)
+		return 1;
+	printf(VARIANT ": all tests passed\n");
+	return 0;
+}
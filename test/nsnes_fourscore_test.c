@@ -0,0 +1,196 @@
+/* NES Four Score read through nsnes.c, against a simulated adapter
+ * Copyright (C) 2024 Francis-Olivier Gradel, B.Eng.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * The author may be contacted at info@retronicdesign.com
+ */
+#include <stdio.h>
+#include <avr/io.h>
+#include "sim.h"
+#include "nsnes.h"
+
+/* The shift register of the Four Score, as nsnes.c reads it: LATCH (PB2)
+ * high loads it, bit 0 is then on DATA (PB1) and every rising edge of
+ * CLOCK (PB3) shifts the next one out. Players 1 and 3, 8 bits each, then
+ * the signature, DATA low for a 1. Past the end DATA stays low, as a NES
+ * pad does. The narrowest pulses seen are kept to check the timing.
+ */
+#define PAD_A		(1<<0)
+#define PAD_B		(1<<1)
+#define PAD_SELECT	(1<<2)
+#define PAD_START	(1<<3)
+#define PAD_UP		(1<<4)
+#define PAD_DOWN	(1<<5)
+#define PAD_LEFT	(1<<6)
+#define PAD_RIGHT	(1<<7)
+
+#define SIGNATURE	0x08	// Clock cycles 16-23, 00010000 in read order
+
+#define POLL_US		500
+
+static unsigned char player[2];
+static unsigned char signature = SIGNATURE;
+static unsigned long shift;
+static int bit;
+static int last_latch = -1, last_clock = -1;	// Not seen yet
+static double latch_edge, clock_edge;
+static double latch_min = 1e9, clock_low_min = 1e9, clock_high_min = 1e9;
+
+static unsigned char fourScorePins(char port)
+{
+	int latch = (simPORTB>>PB2)&1;
+	int clock = (simPORTB>>PB3)&1;
+
+	if (latch != last_latch)
+	{
+		if (!latch && last_latch == 1 && simTimeUs - latch_edge < latch_min)
+			latch_min = simTimeUs - latch_edge;
+		last_latch = latch;
+		latch_edge = simTimeUs;
+	}
+	if (latch)
+	{
+		shift = player[0] | (player[1]<<8) | ((unsigned long)signature<<16);
+		bit = 0;
+	}
+	if (clock != last_clock)
+	{
+		if (last_clock >= 0 && clock)
+		{
+			if (simTimeUs - clock_edge < clock_low_min)
+				clock_low_min = simTimeUs - clock_edge;
+			if (!latch)
+				bit++;
+		}
+		else if (last_clock >= 0 && simTimeUs - clock_edge < clock_high_min)
+			clock_high_min = simTimeUs - clock_edge;
+		last_clock = clock;
+		clock_edge = simTimeUs;
+	}
+
+	if (port != 'B')
+		return 0xff;
+	if (bit >= 24 || (shift>>bit)&1)
+		return ~(1<<PB1);
+	return 0xff;
+}
+
+static Gamepad *fourScoreStart(void)
+{
+	simInit(fourScorePins);
+	return nsnesGetGamepad();
+}
+
+static void checkReport(Gamepad *pad, char id, unsigned char x, unsigned char y, unsigned char buttons)
+{
+	unsigned char buf[8];
+
+	check(pad->changed(id));
+	check(pad->buildReport(buf, id) == 4);
+	check(buf[0] == id && buf[1] == x && buf[2] == y && buf[3] == buttons);
+	if (buf[1] != x || buf[2] != y || buf[3] != buttons)
+		fprintf(stderr, "  report %d: %02x %02x %02x, %02x %02x %02x expected\n", id, buf[1], buf[2], buf[3], x, y, buttons);
+	check(!pad->changed(id));
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void testDetect(void)
+{
+	Gamepad *pad;
+
+	pad = fourScoreStart();
+	check(pad->num_reports == 2);
+	check(pad->feature_report_id == 3);
+	check(pad->buttons_offset == 3 && pad->axes_offset == 1);
+}
+
+static void testPads(void)
+{
+	Gamepad *pad;
+
+	pad = fourScoreStart();
+	player[0] = PAD_A|PAD_UP|PAD_RIGHT;
+	player[1] = PAD_START|PAD_DOWN;
+	pad->update();
+	checkReport(pad, 1, 0xff, 0x00, 0x01);
+	checkReport(pad, 2, 0x80, 0xff, 0x08);
+
+	player[1] = 0;
+	pad->update();
+	check(!pad->changed(1));
+	checkReport(pad, 2, 0x80, 0x80, 0x00);
+}
+
+/* The whole read must fit between two polls of the controller timer. The
+ * simulation counts the delays and the pin reads, not the loop: nsnes.c
+ * budgets about 8 cycles per bit for it.
+ */
+static void testTiming(void)
+{
+	Gamepad *pad;
+	double start, read_us;
+
+	pad = fourScoreStart();
+	start = simTimeUs;
+	pad->update();
+	read_us = simTimeUs - start;
+	printf("four score read: %.1f us in delays and pin reads, about %.0f us with the loop\n",
+		read_us, read_us + 24*8/12.0);
+	check(read_us + 24*8/12.0 < POLL_US/2);
+	check(latch_min >= 12);
+	check(clock_low_min >= 0.5 && clock_high_min >= 0.5);
+	if (clock_low_min < 0.5 || clock_high_min < 0.5)
+		fprintf(stderr, "  clock low %.2f us, high %.2f us\n", clock_low_min, clock_high_min);
+}
+
+/* The Four Score replaced by a plain NES pad: the watchdog resets the
+ * adapter so the host gets the single pad descriptor
+ */
+static void testUnplug(void)
+{
+	Gamepad *pad;
+	int i;
+
+	pad = fourScoreStart();
+	pad->update();
+	if (setjmp(simReset))
+	{
+		check(simResets == 1);
+		return;
+	}
+	signature = 0xFF;
+	for (i=0; i<8; i++)
+	{
+		pad->update();
+		simDelayUs(POLL_US);
+	}
+	check(0);	// Not reached
+}
+
+int main(void)
+{
+	int failed = 0;
+
+	failed += simRun("testDetect", testDetect);
+	failed += simRun("testPads", testPads);
+	failed += simRun("testTiming", testTiming);
+	failed += simRun("testUnplug", testUnplug);
+	if (failed)
+		return 1;
+	printf("nsnes four score: all tests passed\n");
+	return 0;
+}
@@ -0,0 +1,306 @@
+/* SNES pads and the SNES mouse on the Famiclone driver, nsnes.c
+ * Copyright (C) 2024 Francis-Olivier Gradel, B.Eng.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * The author may be contacted at info@retronicdesign.com
+ */
+#include <stdio.h>
+#include <avr/io.h>
+#include "sim.h"
+#include "nsnes.h"
+
+/* The shift register of an SNES pad, an SNES mouse or a NES pad, as
+ * nsnes.c reads it: LATCH (PB2) high loads it, bit 0 is then on DATA (PB1)
+ * and every rising edge of CLOCK (PB3) shifts the next one out, DATA low
+ * for a 1. A NES pad keeps DATA low after its 8 bits. A clock pulse
+ * inside the latch pulse steps the mouse to its next sensitivity. The
+ * pins are only seen at the delays and reads, so the pulse counts when
+ * CLOCK was seen going low with LATCH high.
+ */
+#define DEV_SNES	0
+#define DEV_NES		1
+#define DEV_MOUSE	2
+
+#define SNES_B		(1<<0)
+#define SNES_Y		(1<<1)
+#define SNES_START	(1<<3)
+#define SNES_UP		(1<<4)
+#define SNES_RIGHT	(1<<7)
+#define SNES_A		(1<<8)
+#define SNES_X		(1<<9)
+#define SNES_L		(1<<10)
+#define SNES_R		(1<<11)
+
+#define MOUSE_RIGHT	(1<<8)
+#define MOUSE_LEFT	(1<<9)
+#define MOUSE_ID	(1<<15)		// ID 0001 on clock cycles 12-15
+
+#define POLL_US		500
+
+static int device;
+static unsigned int pressed;	// Bits 0-11 as clocked out
+static int speed;				// Mouse sensitivity, 0 to 2
+static int speed_steps;
+static int move_x, move_y;		// Mouse motion for the next latch
+static unsigned long shift;
+static int bit;
+static int last_latch = -1, last_clock = -1;	// Not seen yet
+static int latched_low;			// CLOCK went low with LATCH high
+static double clock_edge, clock_low_min = 1e9, clock_high_min = 1e9;
+
+/* Sign (1 = up or left) then the magnitude MSB first, in clock order */
+static unsigned char motion(int v)
+{
+	unsigned char m = v < 0 ? -v : v, bits = v < 0 ? 1 : 0;
+	int i;
+
+	for (i=1; i<8; i++)
+		if (m & (1<<(7-i)))
+			bits |= 1<<i;
+	return bits;
+}
+
+static void load(void)
+{
+	switch (device)
+	{
+		case DEV_SNES:
+			shift = pressed & 0x0FFF;
+			break;
+		case DEV_NES:
+			shift = (pressed & 0xFF) | 0xFFFFFF00UL;
+			break;
+		case DEV_MOUSE:
+			shift = (pressed & (MOUSE_LEFT|MOUSE_RIGHT)) | MOUSE_ID;
+			shift |= ((speed>>1)&1)<<10 | (speed&1)<<11;
+			shift |= (unsigned long)motion(move_y)<<16 | (unsigned long)motion(move_x)<<24;
+			move_x = move_y = 0;
+			break;
+	}
+	bit = 0;
+}
+
+static unsigned char snesPins(char port)
+{
+	int latch = (simPORTB>>PB2)&1;
+	int clock = (simPORTB>>PB3)&1;
+
+	if (latch != last_latch)
+	{
+		if (latch)
+			load();
+		last_latch = latch;
+	}
+	if (clock != last_clock)
+	{
+		if (last_clock >= 0 && clock)
+		{
+			if (simTimeUs - clock_edge < clock_low_min)
+				clock_low_min = simTimeUs - clock_edge;
+			if (latch && latched_low && device == DEV_MOUSE)
+			{
+				speed = (speed+1) % 3;
+				speed_steps++;
+			}
+			else if (!latch)
+				bit++;
+		}
+		else if (last_clock >= 0)
+		{
+			if (simTimeUs - clock_edge < clock_high_min)
+				clock_high_min = simTimeUs - clock_edge;
+			latched_low = latch;
+		}
+		last_clock = clock;
+		clock_edge = simTimeUs;
+	}
+
+	if (port != 'B')
+		return 0xff;
+	if (bit < 32 && (shift>>bit)&1)
+		return ~(1<<PB1);
+	if (bit >= 32 && device == DEV_NES)
+		return ~(1<<PB1);
+	return 0xff;
+}
+
+static Gamepad *snesStart(int dev)
+{
+	device = dev;
+	simInit(snesPins);
+	return nsnesGetGamepad();
+}
+
+/* update() as the controller timer calls it */
+static void poll(Gamepad *pad)
+{
+	pad->update();
+	simDelayUs(POLL_US);
+}
+
+static void checkReport(Gamepad *pad, unsigned char a, unsigned char b, unsigned char c)
+{
+	unsigned char buf[8];
+
+	check(pad->changed(1));
+	check(pad->buildReport(buf, 1) == 3);
+	check(buf[0] == a && buf[1] == b && buf[2] == c);
+	if (buf[0] != a || buf[1] != b || buf[2] != c)
+		fprintf(stderr, "  report %02x %02x %02x, %02x %02x %02x expected\n", buf[0], buf[1], buf[2], a, b, c);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void testSnesPad(void)
+{
+	Gamepad *pad;
+
+	pad = snesStart(DEV_SNES);
+	check(pad->num_reports == 1);
+	check(pad->axes_count == 2 && pad->buttons_count == 8);
+
+	pressed = SNES_B|SNES_START|SNES_UP|SNES_RIGHT|SNES_A|SNES_R;
+	poll(pad);
+	checkReport(pad, 0xff, 0x00, 0x01|0x08|0x10|0x80);
+	pressed = SNES_Y|SNES_X|SNES_L;
+	poll(pad);
+	checkReport(pad, 0x80, 0x80, 0x02|0x20|0x40);
+}
+
+/* The NES pad reads 1111 as its ID, the bits past 8 are not buttons */
+static void testNesPad(void)
+{
+	Gamepad *pad;
+
+	pad = snesStart(DEV_NES);
+	check(pad->num_reports == 1 && pad->axes_count == 2);
+
+	pressed = SNES_B|SNES_UP;
+	poll(pad);
+	checkReport(pad, 0x80, 0x00, 0x01);
+}
+
+static void testMouse(void)
+{
+	Gamepad *pad;
+
+	speed = 1;
+	pad = snesStart(DEV_MOUSE);
+	check(pad->axes_count == 0);
+	check(pad->buttons_offset == 0);
+
+	pressed = MOUSE_LEFT;
+	move_x = 5;
+	move_y = -3;
+	poll(pad);
+	checkReport(pad, 0x01, 5, (unsigned char)-3);
+	check(!pad->changed(1));
+
+	// Motion adds up between two reports, and goes out clipped
+	pressed = 0;
+	move_x = -100;
+	poll(pad);
+	move_x = -100;
+	poll(pad);
+	checkReport(pad, 0x00, (unsigned char)-127, 0);
+	checkReport(pad, 0x00, (unsigned char)-73, 0);
+}
+
+/* The mouse powers up slow, it is stepped once per read until it is at
+ * NSNES_MOUSE_SPEED (1), then left alone
+ */
+static void testSpeedStep(void)
+{
+	Gamepad *pad;
+	int i;
+
+	speed = 0;
+	pad = snesStart(DEV_MOUSE);
+	poll(pad);
+	check(speed == 1 && speed_steps == 1);
+	for (i=0; i<4; i++)
+		poll(pad);
+	check(speed == 1 && speed_steps == 1);
+
+	// Unplugged and plugged back, it is slow again
+	speed = 0;
+	poll(pad);
+	poll(pad);
+	check(speed == 1 && speed_steps == 2);
+
+	// A step that misses goes round 2 then 0
+	speed = 2;
+	for (i=0; i<3; i++)
+		poll(pad);
+	check(speed == 1 && speed_steps == 4);
+}
+
+/* The 32 bits of the mouse, the longest read, in well under 100us. The
+ * simulation counts the delays and the pin reads, not the loop: nsnes.c
+ * budgets about 8 cycles per bit for it.
+ */
+static void testMouseTiming(void)
+{
+	Gamepad *pad;
+	double start, read_us;
+
+	speed = 1;
+	pad = snesStart(DEV_MOUSE);
+	start = simTimeUs;
+	pad->update();
+	read_us = simTimeUs - start;
+	printf("mouse read: %.1f us in delays and pin reads, about %.0f us with the loop\n",
+		read_us, read_us + 32*8/12.0);
+	check(read_us + 32*8/12.0 < 100);
+	check(clock_low_min >= 0.5 && clock_high_min >= 0.5);
+}
+
+/* A mouse in place of the pad: the watchdog resets the adapter so the
+ * host gets the mouse descriptor
+ */
+static void testPadToMouse(void)
+{
+	Gamepad *pad;
+	int i;
+
+	pad = snesStart(DEV_SNES);
+	poll(pad);
+	if (setjmp(simReset))
+	{
+		check(simResets == 1);
+		return;
+	}
+	device = DEV_MOUSE;
+	for (i=0; i<8; i++)
+		poll(pad);
+	check(0);	// Not reached
+}
+
+int main(void)
+{
+	int failed = 0;
+
+	failed += simRun("testSnesPad", testSnesPad);
+	failed += simRun("testNesPad", testNesPad);
+	failed += simRun("testMouse", testMouse);
+	failed += simRun("testSpeedStep", testSpeedStep);
+	failed += simRun("testMouseTiming", testMouseTiming);
+	failed += simRun("testPadToMouse", testPadToMouse);
+	if (failed)
+		return 1;
+	printf("nsnes snes: all tests passed\n");
+	return 0;
+}
@@ -0,0 +1,150 @@
+/* Multitap controllers in one report, pack.c
+ * Copyright (C) 2024 Francis-Olivier Gradel, B.Eng.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * The author may be contacted at info@retronicdesign.com
+ */
+#include <stdio.h>
+#include <string.h>
+#include "sim.h"
+#include "config.h"
+#include "pack.h"
+
+Config config;	// pack.c only reads pack_reports
+
+static char peek(unsigned char *buf, char id)
+{
+	return 0;
+}
+
+/* As the Sega Team Player and the Four Score: report [ID, X, Y, buttons] */
+static Gamepad tap = {
+	.num_reports = 4,
+	.peekReport = peek,
+	.buttons_offset = 3,
+	.buttons_count = 8,
+	.axes_offset = 1,
+	.axes_count = 2,
+};
+
+static void testInit(void)
+{
+	Gamepad g;
+
+	config.pack_reports = 0;
+	check(!packInit(&tap));
+	config.pack_reports = 1;
+	check(packInit(&tap));
+
+	g = tap;
+	g.num_reports = 1;	// A single controller has nothing to pack
+	check(!packInit(&g));
+	g = tap;
+	g.num_reports = PACK_PADS+1;
+	check(!packInit(&g));
+	g = tap;
+	g.mouse_report_id = 4;	// As the 3DO chain
+	check(!packInit(&g));
+	g = tap;
+	g.buttons_count = 16;
+	check(!packInit(&g));
+	g = tap;
+	g.axes_count = 0;
+	check(!packInit(&g));
+	g = tap;
+	g.peekReport = NULL;
+	check(!packInit(&g));
+}
+
+static void testReport(void)
+{
+	unsigned char report[PACK_REPORT_SIZE];
+	unsigned char pads[PACK_PADS][4] = {
+		{ 1, 0x80, 0x80, 0x01 },	// Centered, button 1
+		{ 2, 0x00, 0xff, 0x80 },	// Left and down, button 8
+		{ 3, 0xff, 0x00, 0x00 },	// Right and up
+		{ 4, 0x3f, 0xc1, 0xff },	// Past the thresholds, all the buttons
+	};
+	unsigned char expect[PACK_REPORT_SIZE] = {
+		0x00 | (0x3|0x1<<2)<<4,
+		(0x1|0x3<<2) | (0x3|0x1<<2)<<4,
+		0x01, 0x80, 0x00, 0xff
+	};
+	int i;
+
+	config.pack_reports = 1;
+	check(packInit(&tap));
+
+	memset(report, 0x55, sizeof(report));
+	packClear(report);
+	for (i=0; i<PACK_PADS; i++)
+		packAdd(report, pads[i], i+1);
+	check(memcmp(report, expect, sizeof(expect)) == 0);
+
+	// Axes between the thresholds are centered
+	packClear(report);
+	pads[0][1] = 0x40;
+	pads[0][2] = 0xc0;
+	packAdd(report, pads[0], 1);
+	check((report[0] & 0xf) == 0);
+}
+
+/* The descriptor declares the report packAdd() writes, and the feature
+ * report of every other descriptor */
+static void testDescriptor(void)
+{
+	const unsigned char *d = (const unsigned char *)pack_usbHidReportDescriptor;
+	int i = 0, size = 0, count = 0, input = 0, feature = 0, depth = 0;
+
+	while (i < PACK_REPORT_DESCRIPTOR_LENGTH)
+	{
+		unsigned char item = d[i] & 0xfc;
+		int len = d[i] & 3;
+		int value = len ? d[i+1] : 0;
+
+		if (len == 2)
+			value |= d[i+2]<<8;
+		check(d[i] != 0x85);	// No report ID
+		switch (item)
+		{
+			case 0x74: size = value; break;
+			case 0x94: count = value; break;
+			case 0x80: input += size*count; break;
+			case 0xb0: feature += size*count; break;
+			case 0xa0: depth++; break;
+			case 0xc0: depth--; break;
+		}
+		i += 1+len;
+	}
+	check(i == PACK_REPORT_DESCRIPTOR_LENGTH);
+	check(depth == 0);
+	check(input == PACK_REPORT_SIZE*8);
+	check(feature == CFG_FEATURE_SIZE*8);
+	check(PACK_REPORT_SIZE <= 8);	// One low speed transfer
+}
+
+int main(void)
+{
+	int failed = 0;
+
+	failed += simRun("testInit", testInit);
+	failed += simRun("testReport", testReport);
+	failed += simRun("testDescriptor", testDescriptor);
+	if (failed)
+		return 1;
+	printf("pack: all tests passed\n");
+	return 0;
+}
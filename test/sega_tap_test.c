@@ -0,0 +1,333 @@
+/* Sega Team Player read through sega.c, against a simulated tap
+ * Copyright (C) 2024 Francis-Olivier Gradel, B.Eng.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * The author may be contacted at info@retronicdesign.com
+ */
+#include <stdio.h>
+#include <string.h>
+#include <avr/io.h>
+#include "sim.h"
+#include "sega.h"
+#include "config.h"
+
+Config config;
+
+/* The tap, as sega.c expects it: TH (PB5) high reads 0011 on the data
+ * lines, TH low 1111. With TH low every TR (PC2) edge puts the next nibble
+ * on PB0-3 and copies TR on TL (PB4), tap_latency us later. The nibbles
+ * are two acknowledges, the 4 port types, then RLDU, SACB and for a 6
+ * buttons pad MXYZ, all active low.
+ */
+#define PAD_NONE	0xF
+#define PAD_3		0x0
+#define PAD_6		0x1
+
+// Pad buttons, in the bit order of sega.c's last_update_state
+#define UP		(1<<0)
+#define DOWN	(1<<1)
+#define LEFT	(1<<2)
+#define RIGHT	(1<<3)
+#define BUT_B	(1<<4)
+#define BUT_C	(1<<5)
+#define BUT_A	(1<<6)
+#define START	(1<<7)
+#define BUT_Z	(1<<8)
+#define BUT_Y	(1<<9)
+#define BUT_X	(1<<10)
+#define MODE	(1<<11)
+
+#define POLL_US	500		// update() period of the main loop
+
+static unsigned char tap_type[4];
+static unsigned int tap_pressed[4];
+static double tap_latency = 2;
+static int tap_plugged = 1;
+static int tap_frozen;					// Stops answering TR
+static int pad_left_right;				// The plain pad reads LEFT and RIGHT held
+static unsigned char nibbles[6+4*3];
+static int nibble_count, nibble_next;
+static int last_th = 1, last_tr = 1, tl = 1, data = 0x3;
+static int pending;
+static double pending_time;
+
+static void tapFrame(void)
+{
+	int i;
+
+	nibble_count = 0;
+	nibbles[nibble_count++] = 0x0;
+	nibbles[nibble_count++] = 0x0;
+	for (i=0; i<4; i++)
+		nibbles[nibble_count++] = tap_type[i];
+	for (i=0; i<4; i++)
+	{
+		if (tap_type[i] == PAD_NONE)
+			continue;
+		nibbles[nibble_count++] = ~tap_pressed[i] & 0xF;
+		nibbles[nibble_count++] = (~tap_pressed[i]>>4) & 0xF;
+		if (tap_type[i] == PAD_6)
+			nibbles[nibble_count++] = (~tap_pressed[i]>>8) & 0xF;
+	}
+}
+
+static unsigned char tapPins(char port)
+{
+	int th = (simPORTB>>PB5)&1;
+	int tr = (simDDRC & (1<<PC2)) ? (simPORTC>>PC2)&1 : 1;
+
+	if (!tap_plugged)
+		return 0xff;
+
+	if (th != last_th)	// TR is high when TH changes, it may have moved since
+	{
+		last_th = th;
+		last_tr = 1;
+		pending = 0;
+		tl = 1;
+		data = th ? 0x3 : 0xF;
+		if (!th)
+		{
+			tapFrame();
+			nibble_next = 0;
+		}
+	}
+	if (!th && tr != last_tr && !tap_frozen)
+	{
+		last_tr = tr;
+		pending = 1;
+		pending_time = simTimeUs + tap_latency;
+	}
+
+	if (pending && simTimeUs >= pending_time)
+	{
+		pending = 0;
+		data = nibble_next < nibble_count ? nibbles[nibble_next++] : 0xF;
+		tl = last_tr;
+	}
+	if (port != 'B')
+		return 0xff;
+	return 0xE0 | (tl<<4) | data;
+}
+
+/* A plain 3 buttons pad with nothing pressed: TH high RLDU, TH low
+ * with LEFT and RIGHT low as the pad ID
+ */
+static unsigned char padPins(char port)
+{
+	if (port != 'B')
+		return 0xff;
+	if (simPORTB & (1<<PB5))
+		return pad_left_right ? 0xf3 : 0xff;
+	return 0xf3;
+}
+
+static Gamepad *tapStart(void)
+{
+	Gamepad *pad;
+
+	config.center = 0x80;
+	simInit(tapPins);
+	pad = SegaGetGamepad();
+	pad->init();
+	return pad;
+}
+
+static void run(Gamepad *pad, int polls)
+{
+	while (polls--)
+	{
+		pad->update();
+		simDelayUs(POLL_US);
+	}
+}
+
+static void checkReport(Gamepad *pad, char id, unsigned char x, unsigned char y, unsigned char buttons)
+{
+	unsigned char buf[8];
+
+	check(pad->changed(id));
+	check(pad->buildReport(buf, id) == 4);
+	check(buf[0] == id && buf[1] == x && buf[2] == y && buf[3] == buttons);
+	if (buf[1] != x || buf[2] != y || buf[3] != buttons)
+		fprintf(stderr, "  report %d: %02x %02x %02x, %02x %02x %02x expected\n", id, buf[1], buf[2], buf[3], x, y, buttons);
+	check(!pad->changed(id));
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void testDetect(void)
+{
+	Gamepad *pad;
+
+	tap_type[0] = tap_type[1] = tap_type[2] = tap_type[3] = PAD_NONE;
+	pad = tapStart();
+	check(pad->num_reports == 4);
+	check(pad->feature_report_id == 5);
+	check(pad->buttons_offset == 3 && pad->axes_offset == 1);
+	check(pad->reportDescriptorSize > 4*40);	// One joystick collection per port
+}
+
+static void testPads(void)
+{
+	Gamepad *pad;
+
+	tap_type[0] = PAD_6;	tap_pressed[0] = BUT_A|START|UP|MODE;
+	tap_type[1] = PAD_3;	tap_pressed[1] = RIGHT|BUT_C;
+	tap_type[2] = PAD_NONE;
+	tap_type[3] = PAD_6;	tap_pressed[3] = BUT_X|BUT_Z|DOWN|LEFT;
+	pad = tapStart();
+	run(pad, 4);
+
+	checkReport(pad, 1, 0x80, 0x00, 0x89);
+	checkReport(pad, 2, 0xff, 0x80, 0x04);
+	check(!pad->changed(3));	// Empty port, released as at boot
+	checkReport(pad, 4, 0x00, 0xff, 0x50);
+
+	tap_pressed[1] = BUT_B;		// A change on one port only
+	run(pad, 4);
+	check(!pad->changed(1) && !pad->changed(4));
+	checkReport(pad, 2, 0x80, 0x80, 0x02);
+
+	tap_type[1] = PAD_NONE;		// Unplugged from the tap
+	run(pad, 4);
+	checkReport(pad, 2, 0x80, 0x80, 0x00);
+}
+
+/* A tap slower than NIBBLE_SPIN polls of TL: update() hands back to the
+ * main loop and the frame goes on at the next call
+ */
+static void testSlowTap(void)
+{
+	Gamepad *pad;
+	double start, longest = 0;
+	int i;
+
+	tap_type[0] = PAD_3;	tap_pressed[0] = BUT_A;
+	tap_type[1] = tap_type[2] = PAD_NONE;
+	tap_type[3] = PAD_6;	tap_pressed[3] = MODE;
+	tap_latency = 30;
+	pad = tapStart();
+	for (i=0; i<40; i++)
+	{
+		start = simTimeUs;
+		pad->update();
+		if (simTimeUs - start > longest)
+			longest = simTimeUs - start;
+		simDelayUs(POLL_US);
+	}
+	check(longest < 20);
+	checkReport(pad, 1, 0x80, 0x80, 0x01);
+	checkReport(pad, 4, 0x80, 0x80, 0x80);
+}
+
+/* The tap stops answering in the middle of a frame: the frame is dropped
+ * and every pad released
+ */
+static void testStall(void)
+{
+	Gamepad *pad;
+
+	tap_type[0] = PAD_3;	tap_pressed[0] = START;
+	tap_type[1] = tap_type[2] = tap_type[3] = PAD_NONE;
+	pad = tapStart();
+	run(pad, 4);
+	checkReport(pad, 1, 0x80, 0x80, 0x08);
+
+	tap_frozen = 1;
+	run(pad, 40);
+	checkReport(pad, 1, 0x80, 0x80, 0x00);
+	check(simResets == 0);
+
+	tap_frozen = 0;
+	run(pad, 4);
+	checkReport(pad, 1, 0x80, 0x80, 0x08);
+}
+
+/* Unplugged, the port reads as a plain pad: the watchdog resets the
+ * adapter so the host gets the single joystick descriptor
+ */
+static void testUnplug(void)
+{
+	Gamepad *pad;
+
+	tap_type[0] = tap_type[1] = tap_type[2] = tap_type[3] = PAD_NONE;
+	pad = tapStart();
+	run(pad, 4);
+	if (setjmp(simReset))
+	{
+		check(simResets == 1);
+		return;
+	}
+	tap_plugged = 0;
+	run(pad, 40);
+	check(0);	// Not reached
+}
+
+/* A pad reading LEFT and RIGHT together, worn or pressed hard, is not
+ * taken for a tap: SegaDetect() confirms before the adapter resets
+ */
+static void testPadLeftRight(void)
+{
+	Gamepad *pad;
+
+	config.center = 0x80;
+	simInit(padPins);
+	pad = SegaGetGamepad();
+	pad->init();
+	pad_left_right = 1;
+	run(pad, 2000);
+	check(simResets == 0);
+}
+
+/* A tap plugged in place of a pad is seen after PLUG_CHECKS reads */
+static void testPlugTap(void)
+{
+	Gamepad *pad;
+
+	config.center = 0x80;
+	simInit(padPins);
+	pad = SegaGetGamepad();
+	pad->init();
+	check(pad->num_reports == 1);
+	run(pad, 20);
+	check(simResets == 0);
+	if (setjmp(simReset))
+	{
+		check(simResets == 1);
+		return;
+	}
+	simDevice = tapPins;
+	run(pad, 200);
+	check(0);
+}
+
+int main(void)
+{
+	int failed = 0;
+
+	failed += simRun("testDetect", testDetect);
+	failed += simRun("testPads", testPads);
+	failed += simRun("testSlowTap", testSlowTap);
+	failed += simRun("testStall", testStall);
+	failed += simRun("testUnplug", testUnplug);
+	failed += simRun("testPadLeftRight", testPadLeftRight);
+	failed += simRun("testPlugTap", testPlugTap);
+	if (failed)
+		return 1;
+	printf("sega tap: all tests passed\n");
+	return 0;
+}
@@ -0,0 +1,22 @@
+/* Stand-in for the avr-libc header, see sim.h
+ * Copyright (C) 2024 Francis-Olivier Gradel, B.Eng.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef _sim_avr_eeprom_h__
+#define _sim_avr_eeprom_h__
+
+#include <stdint.h>
+#include <string.h>
+#include "sim.h"
+
+#define eeprom_is_ready()	1
+#define eeprom_busy_wait()
+#define eeprom_read_byte(p)	(simEeprom[(uintptr_t)(p)])
+#define eeprom_update_byte(p, v)	(simEeprom[(uintptr_t)(p)] = (v))
+#define eeprom_read_block(d, p, n)	memcpy(d, simEeprom+(uintptr_t)(p), n)
+
+#endif // _sim_avr_eeprom_h__
@@ -0,0 +1,20 @@
+/* Stand-in for the avr-libc header, see sim.h
+ * Copyright (C) 2024 Francis-Olivier Gradel, B.Eng.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef _sim_avr_interrupt_h__
+#define _sim_avr_interrupt_h__
+
+// The tests call the handlers themselves, when the hardware would
+#define ISR(vector, ...)	void vector(void)
+#define ISR_NOBLOCK
+#define ISR_NAKED
+#define reti()
+#define sei()
+#define cli()
+
+#endif // _sim_avr_interrupt_h__
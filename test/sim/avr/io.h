@@ -0,0 +1,102 @@
+/* Stand-in for the avr-libc header, see sim.h
+ * Copyright (C) 2024 Francis-Olivier Gradel, B.Eng.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef _sim_avr_io_h__
+#define _sim_avr_io_h__
+
+#include "sim.h"
+
+#define PINB	simPin('B')
+#define PINC	simPin('C')
+#define PIND	simPin('D')
+#define PORTB	simPORTB
+#define PORTC	simPORTC
+#define PORTD	simPORTD
+#define DDRB	simDDRB
+#define DDRC	simDDRC
+#define DDRD	simDDRD
+
+#define PB0	0
+#define PB1	1
+#define PB2	2
+#define PB3	3
+#define PB4	4
+#define PB5	5
+#define PB6	6
+#define PB7	7
+#define PC0	0
+#define PC1	1
+#define PC2	2
+#define PC3	3
+#define PC4	4
+#define PC5	5
+#define PD0	0
+#define PD1	1
+#define PD2	2
+#define PD3	3
+#define PD4	4
+#define PD5	5
+#define PD6	6
+#define PD7	7
+
+#define E2END	(SIM_EEPROM_SIZE-1)
+
+#define MCUSR	simMCUSR
+#define PORF	0
+
+// Timer1, it only keeps what is written
+#define TCCR1A	simTCCR1A
+#define TCCR1B	simTCCR1B
+#define TCNT1	simTCNT1
+#define OCR1A	simOCR1A
+#define TIMSK1	simTIMSK1
+#define TIFR1	simTIFR1
+#define CS10	0
+#define CS11	1
+#define CS12	2
+#define WGM12	3
+#define TOV1	0
+#define OCIE1A	1
+#define OCF1A	1
+
+/* Pin change interrupts. The flag registers keep what is written, a 1
+ * there is a flag the code cleared. Only the tests set or clear them. */
+#define PCICR	simPCICR
+#define PCIFR	simPCIFR
+#define PCMSK0	simPCMSK0
+#define PCMSK1	simPCMSK1
+#define PCMSK2	simPCMSK2
+#define PCIE0	0
+#define PCIE1	1
+#define PCIE2	2
+#define PCIF0	0
+#define PCIF1	1
+#define PCIF2	2
+#define PCINT5	5
+#define PCINT10	2
+#define PCINT16	0
+#define PCINT18	2
+#define PCINT22	6
+
+// INT0, the V-USB interrupt
+#define GIFR	simGIFR
+#define EIMSK	simEIMSK
+#define INTF0	0
+#define INT0	0
+
+// Timer 2, the poll tick of the main loop
+#define TIMSK2	simTIMSK2
+#define TIFR2	simTIFR2
+#define OCR2A	simOCR2A
+#define OCIE2A	1
+#define OCF2A	1
+
+// System clock prescaler, avr/power.h sets it
+#define CLKPR	simCLKPR
+
+#endif // _sim_avr_io_h__
@@ -0,0 +1,16 @@
+/* Stand-in for the avr-libc header, see sim.h
+ * Copyright (C) 2024 Francis-Olivier Gradel, B.Eng.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef _sim_avr_pgmspace_h__
+#define _sim_avr_pgmspace_h__
+
+#define PROGMEM
+#define pgm_read_byte(p)	(*(const unsigned char *)(p))
+#define memcpy_P(d, s, n)	memcpy(d, s, n)
+
+#endif // _sim_avr_pgmspace_h__
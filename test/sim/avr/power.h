@@ -0,0 +1,20 @@
+/* Stand-in for the avr-libc header, see sim.h
+ * Copyright (C) 2024 Francis-Olivier Gradel, B.Eng.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef _sim_avr_power_h__
+#define _sim_avr_power_h__
+
+#include "sim.h"
+
+#define clock_div_1		0
+#define clock_div_256	8
+
+#define clock_prescale_set(div)	(simCLKPR = (div))
+#define clock_prescale_get()	(simCLKPR)
+
+#endif // _sim_avr_power_h__
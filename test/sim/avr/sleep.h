@@ -0,0 +1,22 @@
+/* Stand-in for the avr-libc header, see sim.h
+ * Copyright (C) 2024 Francis-Olivier Gradel, B.Eng.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef _sim_avr_sleep_h__
+#define _sim_avr_sleep_h__
+
+#include "sim.h"
+
+#define SLEEP_MODE_IDLE		0
+#define SLEEP_MODE_PWR_DOWN	2
+
+#define set_sleep_mode(mode)	(simSleepMode = (mode))
+#define sleep_enable()
+#define sleep_disable()
+#define sleep_cpu()	simSleep()
+
+#endif // _sim_avr_sleep_h__
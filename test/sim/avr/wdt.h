@@ -0,0 +1,21 @@
+/* Stand-in for the avr-libc header, see sim.h
+ * Copyright (C) 2024 Francis-Olivier Gradel, B.Eng.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef _sim_avr_wdt_h__
+#define _sim_avr_wdt_h__
+
+#include "sim.h"
+
+#define WDTO_15MS	0
+#define WDTO_2S		7
+
+#define wdt_enable(timeout)	simWatchdog(timeout)
+#define wdt_disable()		// WDTON (fuses.h): the watchdog cannot be stopped
+#define wdt_reset()		simWatchdogReset()
+
+#endif // _sim_avr_wdt_h__
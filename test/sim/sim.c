@@ -0,0 +1,149 @@
+/* Host stand-ins for the AVR ports, Timer1 and delays
+ * Copyright (C) 2024 Francis-Olivier Gradel, B.Eng.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * The author may be contacted at info@retronicdesign.com
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <avr/wdt.h>
+#include "sim.h"
+
+unsigned char simPORTB, simPORTC, simPORTD;
+unsigned char simDDRB, simDDRC, simDDRD;
+unsigned char simTCCR1A, simTCCR1B, simTIMSK1, simTIFR1;
+unsigned short simTCNT1, simOCR1A;
+unsigned char simPCICR, simPCIFR, simPCMSK0, simPCMSK1, simPCMSK2, simGIFR, simEIMSK;
+unsigned char simTIMSK2, simTIFR2, simOCR2A, simCLKPR;
+unsigned char simMCUSR;
+
+double simTimeUs;
+unsigned char simEeprom[SIM_EEPROM_SIZE];
+unsigned char (*simDevice)(char port);
+jmp_buf simReset;
+int simResets;
+unsigned char simSleepMode;
+int simSleeps;
+void (*simWake)(void);
+
+static int failures;
+static double wdt_timeout_us, wdt_reset_us;	// Stopped at 0
+
+unsigned char simPin(char port)
+{
+	unsigned char ddr, out, in;
+
+	simTimeUs += SIM_READ_US;
+	in = simDevice ? simDevice(port) : 0xff;
+	switch (port)
+	{
+		case 'B':	ddr = simDDRB; out = simPORTB; break;
+		case 'C':	ddr = simDDRC; out = simPORTC; break;
+		default:	ddr = simDDRD; out = simPORTD; break;
+	}
+	return (out & ddr) | (in & ~ddr);
+}
+
+static void watchdogReset(void)
+{
+	simResets++;
+	longjmp(simReset, 1);
+}
+
+static void watchdogCheck(void)
+{
+	if (wdt_timeout_us && simTimeUs - wdt_reset_us > wdt_timeout_us)
+		watchdogReset();
+}
+
+void simDelayUs(double us)
+{
+	if (simDevice)	// Outputs may have moved since the last read
+		simDevice(0);
+	simTimeUs += us;
+	watchdogCheck();
+}
+
+void simWatchdog(unsigned char timeout)
+{
+	if (timeout == WDTO_15MS)
+		watchdogReset();
+	wdt_timeout_us = 2000000;	// WDTO_2S, the only other one used
+	wdt_reset_us = simTimeUs;
+}
+
+void simWatchdogReset(void)
+{
+	wdt_reset_us = simTimeUs;
+}
+
+void simSleep(void)
+{
+	simSleeps++;
+	if (simWake)
+		simWake();
+	watchdogCheck();
+}
+
+void simInit(unsigned char (*device)(char port))
+{
+	simPORTB = simPORTC = simPORTD = 0;
+	simDDRB = simDDRC = simDDRD = 0;
+	simTCCR1A = simTCCR1B = simTIMSK1 = simTIFR1 = 0;
+	simTCNT1 = simOCR1A = 0;
+	simPCICR = simPCIFR = simPCMSK0 = simPCMSK1 = simPCMSK2 = simGIFR = simEIMSK = 0;
+	simTIMSK2 = simTIFR2 = simOCR2A = simCLKPR = 0;
+	wdt_timeout_us = wdt_reset_us = 0;
+	simSleepMode = 0;
+	simSleeps = 0;
+	simWake = NULL;
+	simTimeUs = 0;
+	simResets = 0;
+	memset(simEeprom, 0xff, sizeof(simEeprom));
+	simDevice = device;
+}
+
+void simFail(const char *file, int line, const char *cond)
+{
+	fprintf(stderr, "%s:%d: %s failed\n", file, line, cond);
+	failures++;
+}
+
+int simRun(const char *name, void (*test)(void))
+{
+	pid_t pid;
+	int status;
+
+	fflush(stdout);
+	if ((pid = fork()) < 0)
+	{
+		perror("fork");
+		exit(1);
+	}
+	if (pid == 0)
+	{
+		test();
+		exit(failures != 0);
+	}
+	waitpid(pid, &status, 0);
+	if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+		return 0;
+	fprintf(stderr, "%s failed\n", name);
+	return 1;
+}
@@ -0,0 +1,85 @@
+/* Host stand-ins for the AVR ports, Timer1 and delays
+ * Copyright (C) 2024 Francis-Olivier Gradel, B.Eng.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * The author may be contacted at info@retronicdesign.com
+ */
+#ifndef _sim_h__
+#define _sim_h__
+
+#include <setjmp.h>
+
+/* A driver runs unchanged against the avr/ and util/ headers of this
+ * directory. The port and Timer1 registers are plain variables, reading a
+ * PINx register asks the simulated controller (simDevice) what the pins
+ * are. Time only moves with the delays and the pin reads, a read takes
+ * SIM_READ_US, about the 2 cycles of an IN at 12MHz.
+ */
+#define SIM_READ_US		0.17
+
+extern unsigned char simPORTB, simPORTC, simPORTD;
+extern unsigned char simDDRB, simDDRC, simDDRD;
+extern unsigned char simTCCR1A, simTCCR1B, simTIMSK1, simTIFR1;
+extern unsigned short simTCNT1, simOCR1A;
+extern unsigned char simPCICR, simPCIFR, simPCMSK0, simPCMSK1, simPCMSK2, simGIFR, simEIMSK;
+extern unsigned char simTIMSK2, simTIFR2, simOCR2A, simCLKPR;
+extern unsigned char simMCUSR;
+
+extern double simTimeUs;
+
+/* EEPROM contents, writes are immediate. Erased, it reads 0xff. */
+#define SIM_EEPROM_SIZE	1024	// ATmega328P
+extern unsigned char simEeprom[SIM_EEPROM_SIZE];
+
+/* Pin levels of a port ('B', 'C' or 'D') as the controller drives them,
+ * the outputs are taken from PORTx by simPin(). Port 0 only lets the
+ * controller see the outputs, simDelayUs() does it before the time moves.
+ */
+extern unsigned char (*simDevice)(char port);
+
+/* A watchdog reset goes back to this setjmp(). The drivers reset the
+ * adapter with a 15ms timeout and a loop, that one resets at once. A
+ * longer timeout starts the watchdog: as WDTON (fuses.h) has it, nothing
+ * stops it, the time and sleep that go by without a wdt_reset() for
+ * longer than its timeout reset the adapter.
+ */
+extern jmp_buf simReset;
+extern int simResets;
+
+/* sleep_cpu() calls simWake, which changes the pins as what wakes the CPU
+ * up would, then raises the pin change flags itself */
+extern unsigned char simSleepMode;
+extern int simSleeps;
+extern void (*simWake)(void);
+
+unsigned char simPin(char port);
+void simDelayUs(double us);
+void simWatchdog(unsigned char timeout);
+void simWatchdogReset(void);
+void simSleep(void);
+
+/* Drives every register back to its reset value */
+void simInit(unsigned char (*device)(char port));
+
+/* Runs test in a child process, so the driver's static variables start
+ * from their initial values each time. return 1 if a check failed
+ */
+int simRun(const char *name, void (*test)(void));
+
+#define check(cond)	do { if (!(cond)) simFail(__FILE__, __LINE__, #cond); } while (0)
+void simFail(const char *file, int line, const char *cond);
+
+#endif // _sim_h__
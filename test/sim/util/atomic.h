@@ -0,0 +1,17 @@
+/* Stand-in for the avr-libc header, see sim.h
+ * Copyright (C) 2024 Francis-Olivier Gradel, B.Eng.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef _sim_util_atomic_h__
+#define _sim_util_atomic_h__
+
+// Nothing interrupts the simulation, the block runs once as it is
+#define ATOMIC_BLOCK(type)	for (int _done = 0; !_done; _done = 1)
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_FORCEON
+
+#endif // _sim_util_atomic_h__
@@ -0,0 +1,17 @@
+/* Stand-in for the avr-libc header, see sim.h
+ * Copyright (C) 2024 Francis-Olivier Gradel, B.Eng.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#ifndef _sim_util_delay_h__
+#define _sim_util_delay_h__
+
+#include "sim.h"
+
+#define _delay_us(us)	simDelayUs(us)
+#define _delay_ms(ms)	simDelayUs((ms)*1000.0)
+
+#endif // _sim_util_delay_h__
@@ -0,0 +1,345 @@
+/* USB suspend and remote wakeup of suspend.c, against a simulated bus
+ * Copyright (C) 2024 Francis-Olivier Gradel, B.Eng.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * The author may be contacted at info@retronicdesign.com
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/sleep.h>
+#include <avr/wdt.h>
+#include <avr/power.h>
+#include "sim.h"
+#include "usbdrv/usbdrv.h"
+#include "suspend.h"
+
+uchar usbConfiguration;
+uchar usbRxToken;
+
+/* The bus idles in J (D- PD0 high, D+ PD2 low), the host resumes with K.
+ * A button sits on PB0 with its pull-up. While the CPU sleeps, events are
+ * played until one changes a pin with its pin change interrupt enabled:
+ * that one wakes the CPU up. A wait lets the time go by, timer 2 wakes the
+ * CPU up meanwhile. The K state the adapter drives is timed.
+ */
+#define BUS_J		(1<<PD0)
+#define BUS_K		(1<<PD2)
+#define BUS_MASK	((1<<PD0)|(1<<PD2))
+#define BUTTON		(1<<PB0)
+
+#define WAIT_US		1000000.0
+#define POLL_OCR2A	6		// main.c, the poll tick
+#define CPU_MHZ		12
+#define TIMER2_US	((OCR2A+1) * 1024.0 * (1<<CLKPR) / CPU_MHZ)	// 1024 prescaler
+
+enum { EV_END, EV_PRESS, EV_GLITCH, EV_HOST_RESUME, EV_WAIT };
+
+static unsigned char bus = BUS_J, buttons = 0xff;
+static const unsigned char *events;
+static double k_start, k_us, waited;
+static int driving, timer_wakes;
+
+static unsigned char busPins(char port)
+{
+	int drive = (simDDRD & BUS_MASK) == BUS_MASK && (simPORTD & BUS_MASK) == BUS_K;
+
+	if (drive && !driving)
+		k_start = simTimeUs;
+	if (!drive && driving)
+		k_us += simTimeUs - k_start;
+	driving = drive;
+
+	if (port == 'B')
+		return buttons;
+	if (port == 'D')
+		return (0xff & ~BUS_MASK) | bus;
+	return 0xff;
+}
+
+static void busWake(void)
+{
+	unsigned char before;
+
+	check(simSleepMode == SLEEP_MODE_IDLE);
+	check(CLKPR == clock_div_256);
+	check(!(EIMSK & (1<<INT0)));
+	for (;;)
+	{
+		switch (*events)
+		{
+			case EV_END:	// Would sleep for ever
+				simFail(__FILE__, __LINE__, "woken up");
+				exit(1);
+
+			case EV_PRESS:
+				before = buttons;
+				buttons &= ~BUTTON;
+				events++;
+				if ((simPCICR & (1<<PCIE0)) && (simPCMSK0 & (before ^ buttons)))
+					return;
+				break;
+
+			case EV_GLITCH:	// Wakes the CPU, gone before it looks
+				events++;
+				if ((simPCICR & (1<<PCIE0)) && (simPCMSK0 & BUTTON))
+					return;
+				break;
+
+			case EV_HOST_RESUME:
+				bus = BUS_K;
+				events++;
+				if ((simPCICR & (1<<PCIE2)) && (simPCMSK2 & (1<<PCINT18)))
+					return;
+				break;
+
+			case EV_WAIT:
+				if (!(TIMSK2 & (1<<OCIE2A)))
+				{
+					simTimeUs += WAIT_US - waited;
+					waited = 0;
+					events++;
+					break;
+				}
+				simTimeUs += TIMER2_US;
+				waited += TIMER2_US;
+				if (waited >= WAIT_US)
+				{
+					waited = 0;
+					events++;
+				}
+				timer_wakes++;
+				return;
+		}
+	}
+}
+
+static void start(void)
+{
+	simInit(busPins);
+	simWake = busWake;
+	DDRB = 0;
+	PORTB = BUTTON;		// Pull-up, a button
+	usbConfiguration = 1;
+	OCR2A = POLL_OCR2A;		// As hardwareInit() leaves them
+	TIMSK2 = 0;
+	EIMSK = (1<<INT0);
+	wdt_enable(WDTO_2S);
+	suspendInit();
+	PCIFR = 0;	// Cleared by suspendInit()
+}
+
+// Built as a usbRequest_t, its words are not 16 bits on the PC
+static void standardRequest(unsigned char request, unsigned char value)
+{
+	usbRequest_t rq;
+
+	memset(&rq, 0, sizeof(rq));
+	rq.bRequest = request;
+	rq.wValue.bytes[0] = value;
+	usbRxToken = USBPID_SETUP;
+	suspendRxHook((unsigned char *)&rq);
+}
+
+static void sleepThrough(const unsigned char *list)
+{
+	events = list;
+	suspendSleep();
+	busPins(0);		// Closes a K state still driven
+	check(*events == EV_END);
+	check(simSleepMode == SLEEP_MODE_IDLE);
+	check(CLKPR == clock_div_1);
+	check(TIMSK2 == 0);
+	check(EIMSK == (1<<INT0));
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void testIdle(void)
+{
+	int i;
+
+	start();
+	for (i=1; i<SUSPEND_IDLE_TICKS; i++)
+		check(!suspendTask());
+	check(suspendTask());
+
+	PCIFR = (1<<PCIF2);		// A keep-alive
+	check(!suspendTask());
+	PCIFR = 0;
+	for (i=1; i<SUSPEND_IDLE_TICKS; i++)
+		check(!suspendTask());
+	check(suspendTask());
+
+	usbConfiguration = 0;	// Not configured yet, not suspended
+	check(!suspendTask());
+}
+
+/* A driver using PCINT2 leaves us without a way to see the keep-alives */
+static void testDisabled(void)
+{
+	int i;
+
+	simInit(busPins);
+	PCICR = (1<<PCIE2);
+	usbConfiguration = 1;
+	suspendInit();
+	for (i=0; i<4*SUSPEND_IDLE_TICKS; i++)
+		check(!suspendTask());
+}
+
+/* The Apple II pots: PCINT2 is the driver's, its handler passes D- on */
+static void testShared(void)
+{
+	int i;
+
+	simInit(busPins);
+	suspendSharePCINT2();
+	PCMSK2 = (1<<PCINT22);
+	PCICR = (1<<PCIE2);
+	usbConfiguration = 1;
+	suspendInit();
+	PCIFR = 0;
+	check(PCMSK2 == ((1<<PCINT22)|(1<<PCINT16)));
+
+	for (i=1; i<SUSPEND_IDLE_TICKS; i++)
+		check(!suspendTask());
+	suspendBusEdge();		// A keep-alive, through the driver's handler
+	check(!suspendTask());
+	PCIFR = 0;
+	for (i=1; i<SUSPEND_IDLE_TICKS; i++)
+		check(!suspendTask());
+	check(suspendTask());
+}
+
+/* A roller on the button pin (ColecoVision): its edges neither wake the
+ * CPU nor the host, and the driver gets its pin change back on resume */
+static void testDriverPinsMasked(void)
+{
+	static const unsigned char list[] = { EV_PRESS, EV_HOST_RESUME, EV_END };
+
+	start();
+	PCMSK0 = BUTTON;
+	PCICR = (1<<PCIE0);
+	sleepThrough(list);
+	check(simSleeps == 1);
+	check(PCMSK0 == BUTTON && PCICR == (1<<PCIE0));
+
+	start();
+	buttons = 0xff;
+	bus = BUS_J;
+	PCMSK0 = BUTTON;
+	PCICR = (1<<PCIE0);
+	standardRequest(USBRQ_SET_FEATURE, USB_FEATURE_REMOTE_WAKEUP);
+	sleepThrough(list);
+	check(simSleeps == 1);
+	check(k_us == 0);
+}
+
+/* Without DEVICE_REMOTE_WAKEUP a button does not even wake the CPU */
+static void testHostResume(void)
+{
+	static const unsigned char list[] = { EV_PRESS, EV_HOST_RESUME, EV_END };
+
+	start();
+	sleepThrough(list);
+	check(simSleeps == 1);
+	check(k_us == 0);
+}
+
+static void testRemoteWakeup(void)
+{
+	static const unsigned char list[] = { EV_PRESS, EV_END };
+
+	start();
+	standardRequest(USBRQ_SET_FEATURE, USB_FEATURE_REMOTE_WAKEUP);
+	sleepThrough(list);
+	check(simSleeps == 1);
+	check(k_us >= 1000 && k_us <= 15000);	// USB spec 7.1.7.7
+	check((DDRD & BUS_MASK) == 0 && (PORTD & BUS_MASK) == 0);
+	check(GIFR & (1<<INTF0));	// Our own edge cleared, not taken for a packet
+	printf("remote wakeup: K driven for %.1f ms\n", k_us/1000);
+}
+
+/* A change gone by the time the CPU looks goes back to sleep */
+static void testGlitch(void)
+{
+	static const unsigned char list[] = { EV_GLITCH, EV_HOST_RESUME, EV_END };
+
+	start();
+	standardRequest(USBRQ_SET_FEATURE, USB_FEATURE_REMOTE_WAKEUP);
+	sleepThrough(list);
+	check(simSleeps == 2);
+	check(k_us == 0);
+}
+
+/* WDTON: the watchdog runs while asleep, timer 2 wakes the CPU up to reset it */
+static void testLongSuspend(void)
+{
+	static const unsigned char list[] = { EV_WAIT, EV_WAIT, EV_WAIT, EV_HOST_RESUME, EV_END };
+
+	start();
+	if (setjmp(simReset))
+	{
+		simFail(__FILE__, __LINE__, "no watchdog reset");
+		exit(1);
+	}
+	sleepThrough(list);
+	check(simResets == 0);
+	check(simTimeUs >= 3*WAIT_US);
+	check(timer_wakes >= 3*WAIT_US/((POLL_OCR2A+1) * 1024.0 * 256 / CPU_MHZ));
+	printf("suspended %.1f s: timer 2 woke the CPU %d times\n", simTimeUs/1000000, timer_wakes);
+}
+
+/* CLEAR_FEATURE and a bus reset (SET_ADDRESS follows it) take it away */
+static void testWakeupCleared(void)
+{
+	static const unsigned char list[] = { EV_PRESS, EV_HOST_RESUME, EV_END };
+
+	start();
+	standardRequest(USBRQ_SET_FEATURE, USB_FEATURE_REMOTE_WAKEUP);
+	standardRequest(USBRQ_CLEAR_FEATURE, USB_FEATURE_REMOTE_WAKEUP);
+	sleepThrough(list);
+	check(k_us == 0);
+
+	start();
+	buttons = 0xff;
+	bus = BUS_J;
+	standardRequest(USBRQ_SET_FEATURE, USB_FEATURE_REMOTE_WAKEUP);
+	standardRequest(USBRQ_SET_ADDRESS, 3);
+	sleepThrough(list);
+	check(k_us == 0);
+}
+
+int main(void)
+{
+	int failed = 0;
+
+	failed += simRun("testIdle", testIdle);
+	failed += simRun("testDisabled", testDisabled);
+	failed += simRun("testShared", testShared);
+	failed += simRun("testDriverPinsMasked", testDriverPinsMasked);
+	failed += simRun("testHostResume", testHostResume);
+	failed += simRun("testRemoteWakeup", testRemoteWakeup);
+	failed += simRun("testGlitch", testGlitch);
+	failed += simRun("testLongSuspend", testLongSuspend);
+	failed += simRun("testWakeupCleared", testWakeupCleared);
+	if (failed)
+		return 1;
+	printf("suspend: all tests passed\n");
+	return 0;
+}
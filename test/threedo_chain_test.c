@@ -0,0 +1,237 @@
+/* 3DO controller chain read through 3DO.c, against simulated bit streams
+ * Copyright (C) 2024 Francis-Olivier Gradel, B.Eng.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ * The author may be contacted at info@retronicdesign.com
+ */
+#include <stdio.h>
+#include <string.h>
+#include <avr/io.h>
+#include "sim.h"
+#include "3DO.h"
+
+void TIMER1_COMPA_vect(void);
+
+/* The chain, as 3DO.c reads it: while P/S (PB4) is high it is reset, once
+ * low the first bit is on DATA (PC2) and every falling edge of CLK (PB5)
+ * shifts the next one out, MSB first. Past the end DATA stays low.
+ *
+ * A stream is written as the bits go out on DATA, spaces only for reading.
+ * Laid out from the protocol, field by field (see the top of 3DO.c).
+ */
+#define STREAM_BITS	(40*8)
+
+// Left and Shift, dY -5, dX +12
+#define MOUSE		"01001001 1001 1111111011 0000001100"
+// Right, no motion
+#define MOUSE_STILL	"01001001 0010 0000000000 0000000000"
+// No button, dY +300, dX -300
+#define MOUSE_MOVE	"01001001 0000 0100101100 1011010100"
+// X 0x3FF, Y 0x200, Z 0x155, Fire and Left, P and R
+#define STICK		"00000001 01111011 00001000 1111111111 1000000000 0101010101 00" \
+					"10000001 10010000"
+// Up and A, then B and L
+#define PAD			"100 0 1 0 0 1 1 0 0 0 0 1 0 0"
+
+#define POLL_US		500
+
+static unsigned char stream[STREAM_BITS];
+static int stream_len, bit;
+static int last_clock = 1;
+
+static void setStream(const char *s)
+{
+	stream_len = 0;
+	for (; *s; s++)
+	{
+		if (*s == ' ')
+			continue;
+		stream[stream_len++] = *s == '1';
+	}
+}
+
+static unsigned char chainPins(char port)
+{
+	int ps = (simPORTB>>PB4)&1;
+	int clock = (simPORTB>>PB5)&1;
+
+	if (ps)
+		bit = 0;
+	else if (last_clock && !clock)
+		bit++;
+	last_clock = clock;
+
+	if (port != 'C')
+		return 0;
+	if (!ps && bit < stream_len && stream[bit])
+		return (1<<PC2);
+	return 0;
+}
+
+static Gamepad *chainStart(const char *s)
+{
+	setStream(s);
+	simInit(chainPins);
+	return ThreeDOGetGamepad();
+}
+
+/* update() as the main loop calls it, the chain read in the background by
+ * the timer interrupt
+ */
+static void run(Gamepad *pad, int polls)
+{
+	while (polls--)
+	{
+		pad->update();
+		while (TIMSK1 & (1<<OCIE1A))
+		{
+			simDelayUs(10);
+			TIMER1_COMPA_vect();
+		}
+		simDelayUs(POLL_US);
+	}
+}
+
+static void checkReport(Gamepad *pad, char id, int len, const unsigned char *expected)
+{
+	unsigned char buf[8];
+	int i;
+
+	check(pad->changed(id));
+	check(pad->buildReport(buf, id) == len);
+	check(memcmp(buf, expected, len) == 0);
+	if (memcmp(buf, expected, len))
+	{
+		fprintf(stderr, "  report %d:", id);
+		for (i=0; i<len; i++)
+			fprintf(stderr, " %02x", buf[i]);
+		fprintf(stderr, ", expected");
+		for (i=0; i<len; i++)
+			fprintf(stderr, " %02x", expected[i]);
+		fprintf(stderr, "\n");
+	}
+	check(!pad->changed(id));
+}
+
+/* ------------------------------------------------------------------------- */
+
+static void testStick(void)
+{
+	static const unsigned char report[] = { 1, 0xff, 0x80, 0x55, 0x81, 0x09 };
+	static const unsigned char released[] = { 2, 0x80, 0x80, 0x80, 0, 0 };
+	Gamepad *pad;
+
+	pad = chainStart(STICK);
+	check(pad->num_reports == 5 && pad->feature_report_id == 6);
+	check(pad->mouse_report_id == 5);
+	pad->init();
+	checkReport(pad, 1, sizeof(report), report);
+	checkReport(pad, 2, sizeof(released), released);
+	check(!pad->changed(5));
+
+	run(pad, 8);
+	check(!pad->changed(1) && !pad->changed(2) && !pad->changed(5));
+}
+
+/* The mouse report has no game pad buttons: main.c leaves it to the driver */
+static void testMouseInChain(void)
+{
+	static const unsigned char pad_report[] = { 1, 0x80, 0x00, 0x80, 0x43, 0x00 };
+	static const unsigned char report[] = { 5, 0x09, 12, 0xfb };
+	static const unsigned char still[] = { 5, 0x02, 0, 0 };
+	Gamepad *pad;
+
+	pad = chainStart(PAD MOUSE);
+	check(pad->num_reports == 5 && pad->mouse_report_id == 5);
+	check(pad->buttons_offset >= sizeof(report));
+	pad->init();
+	checkReport(pad, 1, sizeof(pad_report), pad_report);
+	checkReport(pad, 5, sizeof(report), report);
+
+	setStream(PAD MOUSE_STILL STICK MOUSE);	// Only the first mouse counts
+	run(pad, 8);
+	check(!pad->changed(1));
+	checkReport(pad, 5, sizeof(still), still);
+	check(pad->changed(2));		// The flightstick, after the mouse
+}
+
+/* A lone mouse gets a mouse descriptor, not four empty game pads */
+static void testMouseAlone(void)
+{
+	static const unsigned char report[] = { 0x09, 12, 0xfb };
+	Gamepad *pad;
+
+	pad = chainStart(MOUSE);
+	check(pad->num_reports == 1);
+	check(pad->feature_report_id == 0 && pad->mouse_report_id == 0);
+	check(pad->buttons_offset == 0 && pad->axes_count == 0);
+	pad->init();
+	checkReport(pad, 1, sizeof(report), report);
+}
+
+/* Motion left over goes out in the next reports, 127 at most at a time */
+static void testMouseMotion(void)
+{
+	static const signed char x[] = { -127, -127, -46 };
+	static const signed char y[] = { 127, 127, 46 };
+	unsigned char buf[8];
+	Gamepad *pad;
+	int i;
+
+	pad = chainStart(MOUSE_MOVE);	// dX -300, dY 300 read at boot
+	pad->init();
+	for (i=0; i<3; i++)
+	{
+		check(pad->changed(1));
+		check(pad->buildReport(buf, 1) == 3);
+		check(buf[0] == 0 && (signed char)buf[1] == x[i] && (signed char)buf[2] == y[i]);
+	}
+	check(!pad->changed(1));
+}
+
+/* A joypad plugged in front of the lone mouse changes the descriptor */
+static void testPlugPad(void)
+{
+	Gamepad *pad;
+
+	pad = chainStart(MOUSE);
+	pad->init();
+	run(pad, 8);
+	check(simResets == 0);
+	if (setjmp(simReset))
+	{
+		check(simResets == 1);
+		return;
+	}
+	setStream(PAD MOUSE);
+	run(pad, 8*8);
+	check(0);	// Not reached
+}
+
+int main(void)
+{
+	int failed = 0;
+
+	failed += simRun("testStick", testStick);
+	failed += simRun("testMouseInChain", testMouseInChain);
+	failed += simRun("testMouseAlone", testMouseAlone);
+	failed += simRun("testMouseMotion", testMouseMotion);
+	failed += simRun("testPlugPad", testPlugPad);
+	if (failed)
+		return 1;
+	printf("3DO chain: all tests passed\n");
+	return 0;
+}